@@ -0,0 +1,1346 @@
+#include "Benchmark.h"
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <iomanip>
+#include <cmath>
+#include <omp.h>
+
+//Renders are checked against direct iteration on a sampleSide x
+//sampleSide grid of pixels spread over the view
+static const int sampleSide = 16;
+
+//Progressive renders are a few % off one pass, less than the noise of a
+//single go, so each is timed as the fastest of this many, taken in turn
+//with one pass so both see the same machine
+static const int progressiveRuns = 5;
+
+//Deep zooms with and without BLA are timed as the fastest of this many
+//goes each, taken in turn, so views where it changes little are not
+//read as a loss
+static const int deepZoomRuns = 3;
+
+Benchmark::Benchmark() : m_pool(std::thread::hardware_concurrency())
+{
+	m_threads = std::thread::hardware_concurrency();
+
+	//Standard locations, from the home view down to slow boundary regions
+	m_views.push_back({ "Home", -0.75, 0.0, 4.6, 500 });
+	m_views.push_back({ "Seahorse valley", -0.7453, 0.1127, 0.01, 1000 });
+	m_views.push_back({ "Elephant valley", 0.2925, 0.0149, 0.01, 1000 });
+	m_views.push_back({ "Period 3 minibrot", -1.7548, 0.0, 0.05, 2000 });
+	m_views.push_back({ "Spiral", -0.761574, -0.0847596, 0.0002, 2000 });
+	m_views.push_back({ "Cardioid cusp", 0.2501, 0.0, 0.001, 2000 });
+}
+
+Benchmark::~Benchmark()
+{
+}
+
+/** Runs every comparison and returns the report*/
+string Benchmark::run()
+{
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(1);
+	ss << "Mandelbrot benchmark, " << VIEW_WIDTH << "x" << VIEW_HEIGHT << ", " << m_threads << " threads, kernel " << m_kernel.getIsaName() << "\n\n";
+
+	compareInteriorChecks(ss);
+	comparePrecision(ss);
+	compareDeepZoom(ss);
+	compareResume(ss);
+	compareFill(ss);
+	compareScheduling(ss);
+	compareFrameStore(ss);
+	compareCompactMu(ss);
+	compareColouring(ss);
+	compareHistogram(ss);
+	compareCycling(ss);
+	compareCancellation(ss);
+	compareProgressive(ss);
+	compareCostMap(ss);
+	compareTilePipeline(ss);
+
+	return ss.str();
+}
+
+/** Renders one view row by row into mu[y * width + x] and returns the time
+	taken in ms. With states, pixels carry on from an earlier render of
+	the view*/
+double Benchmark::renderView(const BenchmarkView& view, int width, int height, vector<double>& mu, PixelState* states)
+{
+	double pixelSize = view.width / (double)width;
+	DoubleDouble left = DoubleDouble(view.centreRe) - DoubleDouble(view.width / 2.0);
+	DoubleDouble top = DoubleDouble(view.centreIm) - DoubleDouble(pixelSize * height / 2.0);
+
+	mu.resize(width * height);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+#pragma omp parallel for schedule(dynamic) num_threads(m_threads)
+	for (int y = 0; y < height; ++y)
+	{
+		KernelRun run;
+		run.reBase = left;
+		run.reStep = pixelSize;
+		run.imBase = top + DoubleDouble((y + 0.5f) * pixelSize);
+		run.imStep = 0.0;
+		run.first = 0;
+		run.count = width;
+
+		m_kernel.computeRun(run, view.maxIterations, &mu[y * width], states ? &states[y * width] : nullptr);
+	}
+
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** Times each view with and without the interior fast path and checks
+	that both classify every pixel the same way*/
+void Benchmark::compareInteriorChecks(std::stringstream& ss)
+{
+	vector<double> plain, checked;
+
+	ss << "Interior fast path (cardioid/bulb test and periodicity checking)\n";
+	ss << std::left << std::setw(20) << "View" << std::right << std::setw(10) << "Off ms" << std::setw(10) << "On ms" << std::setw(10) << "Speedup" << std::setw(10) << "Inside %" << std::setw(12) << "Mismatches" << "\n";
+
+	for (const BenchmarkView& view : m_views)
+	{
+		m_kernel.setInteriorChecks(false);
+		double plainTime = renderView(view, VIEW_WIDTH, VIEW_HEIGHT, plain, nullptr);
+
+		m_kernel.setInteriorChecks(true);
+		double checkedTime = renderView(view, VIEW_WIDTH, VIEW_HEIGHT, checked, nullptr);
+
+		//Black/coloured classification must not change
+		int inside = 0;
+		int mismatches = 0;
+		for (size_t i = 0; i < plain.size(); ++i)
+		{
+			bool plainInside = plain[i] == view.maxIterations;
+			bool checkedInside = checked[i] == view.maxIterations;
+
+			inside += plainInside ? 1 : 0;
+			mismatches += plainInside != checkedInside ? 1 : 0;
+		}
+
+		ss << std::left << std::setw(20) << view.name << std::right << std::setw(10) << plainTime << std::setw(10) << checkedTime
+		   << std::setw(9) << plainTime / checkedTime << "x" << std::setw(10) << 100.0 * inside / plain.size() << std::setw(12) << mismatches << "\n";
+	}
+	ss << "\n";
+}
+
+/** Percentage of pixels more than one iteration band away from the
+	reference, or on the other side of the set boundary*/
+static double wrongPercent(const vector<double>& mu, const vector<double>& reference, int maxIterations)
+{
+	int wrong = 0;
+	for (size_t i = 0; i < mu.size(); ++i)
+	{
+		bool inside = mu[i] == maxIterations;
+		bool referenceInside = reference[i] == maxIterations;
+		wrong += inside != referenceInside || std::abs(mu[i] - reference[i]) > 1.0 ? 1 : 0;
+	}
+	return 100.0 * wrong / mu.size();
+}
+
+/** Renders a view by perturbation and returns the time taken in ms,
+	reference orbits included. With states, pixels carry on from an
+	earlier render of the view*/
+double Benchmark::renderPerturbation(const BigFixed& centreRe, const BigFixed& centreIm, FloatExp viewWidth, long long maxIterations,
+									 int width, int height, vector<double>& mu, PixelState* states)
+{
+	FloatExp pixelSize = viewWidth / FloatExp((double)width);
+
+	mu.resize(width * height);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	m_perturbation.render(centreRe, centreIm, pixelSize, pixelSize, width, height, maxIterations, m_threads, mu.data(), states, width);
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** Iterates one point directly at the precision it is given in, the
+	slow but sure answer perturbation is checked against*/
+double Benchmark::iterateExact(const BigFixed& re, const BigFixed& im, int maxIterations)
+{
+	BigFixed zr(0.0, re.getFractionLimbs());
+	BigFixed zi(0.0, re.getFractionLimbs());
+
+	for (int n = 0; n < maxIterations; ++n)
+	{
+		double x = zr.toDouble();
+		double y = zi.toDouble();
+		if (x * x + y * y >= 4.0)
+		{
+			return n - (std::log(2) / std::log(std::sqrt(x * x + y * y)));
+		}
+
+		BigFixed zr2 = zr * zr;
+		BigFixed zi2 = zi * zi;
+		BigFixed zri = zr * zi;
+		zi = zri + zri + im;
+		zr = zr2 - zi2 + re;
+	}
+	return maxIterations;
+}
+
+/** Works out the pixels of a grid spread over a width x height view by
+	iterateExact. Gives each one's index in the view and its mu*/
+void Benchmark::iterateSamples(const BigFixed& centreRe, const BigFixed& centreIm, FloatExp viewWidth, int maxIterations, int width, int height,
+							   vector<int>& pixels, vector<double>& exact)
+{
+	const int samples = sampleSide * sampleSide;
+	FloatExp pixelSize = viewWidth / FloatExp((double)width);
+	int limbs = BigFixed::limbsForBits(64 - pixelSize.e);
+	pixels.resize(samples);
+	exact.resize(samples);
+
+#pragma omp parallel for schedule(dynamic) num_threads(m_threads)
+	for (int i = 0; i < samples; ++i)
+	{
+		int x = (int)((i % sampleSide + 0.5) * width / sampleSide);
+		int y = (int)((i / sampleSide + 0.5) * height / sampleSide);
+		BigFixed re = centreRe + BigFixed(FloatExp(x + 0.5 - width / 2.0) * pixelSize, limbs);
+		BigFixed im = centreIm + BigFixed(FloatExp(y + 0.5 - height / 2.0) * pixelSize, limbs);
+		pixels[i] = y * width + x;
+		exact[i] = iterateExact(re, im, maxIterations);
+	}
+}
+
+/** Percentage of the sampled pixels more than one iteration band away
+	from direct iteration, or on the other side of the set boundary*/
+static double wrongSamples(const vector<double>& mu, const vector<int>& pixels, const vector<double>& exact, int maxIterations)
+{
+	int wrong = 0;
+	for (size_t i = 0; i < pixels.size(); ++i)
+	{
+		double value = mu[pixels[i]];
+		bool inside = value == maxIterations;
+		bool exactInside = exact[i] == maxIterations;
+		wrong += inside != exactInside || std::abs(value - exact[i]) > 1.0 ? 1 : 0;
+	}
+	return 100.0 * wrong / pixels.size();
+}
+
+/** Zooms towards one point and renders each step in every precision tier
+	and by perturbation. A grid of pixels from each step is checked against
+	direct iteration, and ones more than one iteration band away count as
+	wrong, which shows where each tier stops being usable and so where
+	choosePrecision should switch*/
+void Benchmark::comparePrecision(std::stringstream& ss)
+{
+	const int width = 128;
+	const int height = 64;
+	const KernelPrecision tiers[] = { KernelPrecision::Float, KernelPrecision::Double, KernelPrecision::LongDouble, KernelPrecision::DoubleDouble };
+
+	vector<double> mu, exact;
+	vector<int> pixels;
+
+	ss << "Precision tiers, " << width << "x" << height << " towards -0.743643887037151+0.131825904205330i, % of "
+	   << sampleSide * sampleSide << " pixels wrong against direct iteration and ms\n";
+	ss << std::left << std::setw(10) << "Width" << std::right << std::setw(10) << "Inside %";
+	for (KernelPrecision tier : tiers)
+	{
+		ss << std::setw(22) << Kernel::getPrecisionName(tier);
+	}
+	ss << std::setw(22) << "perturbation" << std::setw(16) << "Auto picks" << "\n";
+
+	//The target is only known to 15 digits, so deeper frames are flat
+	for (int exponent = 0; exponent <= 16; exponent += 2)
+	{
+		//Deeper views need more iterations before anything escapes
+		BenchmarkView view = { "", -0.743643887037151, 0.131825904205330, std::pow(10.0, -exponent), 500 + 500 * exponent };
+
+		iterateSamples(BigFixed(view.centreRe), BigFixed(view.centreIm), FloatExp(view.width), view.maxIterations, width, height, pixels, exact);
+
+		//A frame that is all inside says nothing about the tiers
+		int inside = 0;
+		for (double value : exact)
+		{
+			inside += value == view.maxIterations ? 1 : 0;
+		}
+
+		ss << std::left << std::setw(10) << ("1e-" + std::to_string(exponent)) << std::right << std::setw(10) << std::fixed << std::setprecision(1) << 100.0 * inside / exact.size();
+		for (KernelPrecision tier : tiers)
+		{
+			if (tier == KernelPrecision::LongDouble && !Kernel::hasExtendedLongDouble())
+			{
+				ss << std::setw(22) << "n/a";
+				continue;
+			}
+
+			m_kernel.setPrecision(tier);
+			double time = renderView(view, width, height, mu, nullptr);
+
+			std::stringstream cell;
+			cell << std::fixed << std::setprecision(1) << wrongSamples(mu, pixels, exact, view.maxIterations) << "% " << time;
+			ss << std::setw(22) << cell.str();
+		}
+
+		double time = renderPerturbation(BigFixed(view.centreRe), BigFixed(view.centreIm), FloatExp(view.width), view.maxIterations, width, height, mu, nullptr);
+		std::stringstream cell;
+		cell << std::fixed << std::setprecision(1) << wrongSamples(mu, pixels, exact, view.maxIterations) << "% " << time;
+		ss << std::setw(22) << cell.str();
+
+		//The viewer goes to perturbation wherever a double is not enough
+		KernelPrecision pick = Kernel::choosePrecision(view.width / width, std::abs(view.centreRe), view.maxIterations);
+		ss << std::setw(16) << (pick > KernelPrecision::Double ? "perturbation" : Kernel::getPrecisionName(pick)) << "\n";
+	}
+	ss << "\n";
+
+	m_kernel.setPrecision(KernelPrecision::Double);
+}
+
+/** Renders deep views by perturbation with and without the bilinear
+	approximation, keeping the fastest go of each. The Misiurewicz point c = i has detail at every depth.
+	A grid of pixels from each view is checked against iterateExact, and
+	every pixel with the approximation against every pixel without*/
+void Benchmark::compareDeepZoom(std::stringstream& ss)
+{
+	struct DeepView
+	{
+		const char* name;
+		const char* centreRe;
+		const char* centreIm;
+		int exponent;
+		int maxIterations;
+	};
+
+	const DeepView views[] = {
+		{ "Seahorse valley", "-0.743643887037151", "0.131825904205330", 14, 7500 },
+		{ "c = i", "0", "1", 50, 5000 },
+		{ "c = i", "0", "1", 100, 5000 },
+		{ "c = i", "0", "1", 300, 5000 },
+		{ "c = i", "0", "1", 1000, 5000 }
+	};
+	const int width = 256;
+	const int height = 128;
+
+	vector<double> plain, approximated, exact;
+	vector<int> pixels;
+
+	ss << "Deep zoom by perturbation, " << width << "x" << height << ", % of " << sampleSide * sampleSide
+	   << " pixels per view wrong against direct iteration, and % of all pixels changed by BLA\n";
+	ss << std::left << std::setw(26) << "View" << std::right << std::setw(10) << "BLA off" << std::setw(10) << "BLA on" << std::setw(10) << "Speedup"
+	   << std::setw(12) << "References" << std::setw(10) << "Glitches" << std::setw(8) << "Levels" << std::setw(10) << "Range"
+	   << std::setw(10) << "Off wrong" << std::setw(10) << "On wrong" << std::setw(10) << "Changed" << "\n";
+
+	for (const DeepView& view : views)
+	{
+		BigFixed centreRe = BigFixed(std::string(view.centreRe));
+		BigFixed centreIm = BigFixed(std::string(view.centreIm));
+		FloatExp viewWidth = BigFixed("1e-" + std::to_string(view.exponent)).toFloatExp();
+
+		double plainTime = 0.0;
+		double time = 0.0;
+		for (int run = 0; run < deepZoomRuns; ++run)
+		{
+			m_perturbation.setBla(false);
+			double taken = renderPerturbation(centreRe, centreIm, viewWidth, view.maxIterations, width, height, plain, nullptr);
+			plainTime = run == 0 ? taken : std::min(plainTime, taken);
+
+			m_perturbation.setBla(true);
+			taken = renderPerturbation(centreRe, centreIm, viewWidth, view.maxIterations, width, height, approximated, nullptr);
+			time = run == 0 ? taken : std::min(time, taken);
+		}
+
+		//Spot checks pixels spread over the view at full precision
+		iterateSamples(centreRe, centreIm, viewWidth, view.maxIterations, width, height, pixels, exact);
+
+		std::string name = std::string(view.name) + " 1e-" + std::to_string(view.exponent);
+		ss << std::left << std::setw(26) << name << std::right << std::setw(10) << plainTime << std::setw(10) << time << std::setw(9) << plainTime / time << "x"
+		   << std::setw(12) << m_perturbation.getReferences() << std::setw(10) << m_perturbation.getGlitches() << std::setw(8) << m_perturbation.getBlaLevels()
+		   << std::setw(10) << (m_perturbation.getExtendedRange() ? "floatexp" : "double") << std::setw(9) << wrongSamples(plain, pixels, exact, view.maxIterations) << "%"
+		   << std::setw(9) << wrongSamples(approximated, pixels, exact, view.maxIterations) << "%" << std::setw(9) << wrongPercent(approximated, plain, view.maxIterations) << "%\n";
+	}
+	ss << "\n";
+}
+
+/** Renders views at one iteration limit, raises it and times carrying on
+	from the saved pixel states against starting again, then drops back to
+	the first limit, which should only need reclassifying. Resuming must
+	give the same picture as starting again*/
+void Benchmark::compareResume(std::stringstream& ss)
+{
+	struct ResumeView
+	{
+		const char* name;
+		const char* centreRe;
+		const char* centreIm;
+		double width;
+		bool perturbation;
+		long long fromIterations;
+		long long toIterations;
+	};
+
+	const ResumeView views[] = {
+		{ "Spiral", "-0.761574", "-0.0847596", 0.0002, false, 2000, 8000 },
+		{ "Period 3 minibrot", "-1.7548", "0.0", 0.05, false, 2000, 8000 },
+		{ "Seahorse 1e-12", "-0.743643887037151", "0.131825904205330", 1e-12, true, 4000, 16000 },
+		{ "c = i 1e-100", "0", "1", 1e-100, true, 1000, 4000 }
+	};
+	const int width = 512;
+	const int height = 256;
+
+	vector<double> full, resumed;
+	vector<PixelState> states;
+
+	ss << "Raising the iteration limit on the same view, " << width << "x" << height << ", resumed from saved pixel states against starting again\n";
+	ss << std::left << std::setw(20) << "View" << std::right << std::setw(16) << "Limit" << std::setw(10) << "Full ms" << std::setw(11) << "Resume ms"
+	   << std::setw(10) << "Speedup" << std::setw(11) << "Iterated" << std::setw(11) << "Lower ms" << std::setw(12) << "Mismatches" << "\n";
+
+	for (const ResumeView& view : views)
+	{
+		BigFixed centreRe = BigFixed(std::string(view.centreRe));
+		BigFixed centreIm = BigFixed(std::string(view.centreIm));
+		BenchmarkView kernelView = { view.name, centreRe.toDouble(), centreIm.toDouble(), view.width, 0 };
+		states.assign(width * height, PixelState());
+		double fullTime, resumeTime, lowerTime;
+
+		if (view.perturbation)
+		{
+			renderPerturbation(centreRe, centreIm, FloatExp(view.width), view.fromIterations, width, height, resumed, states.data());
+		}
+		else
+		{
+			kernelView.maxIterations = (int)view.fromIterations;
+			renderView(kernelView, width, height, resumed, states.data());
+		}
+
+		//Pixels the raised limit has to carry on
+		int iterated = 0;
+		for (const PixelState& state : states)
+		{
+			iterated += state.needsWork(view.toIterations) ? 1 : 0;
+		}
+
+		if (view.perturbation)
+		{
+			FloatExp viewWidth(view.width);
+			fullTime = renderPerturbation(centreRe, centreIm, viewWidth, view.toIterations, width, height, full, nullptr);
+			resumeTime = renderPerturbation(centreRe, centreIm, viewWidth, view.toIterations, width, height, resumed, states.data());
+		}
+		else
+		{
+			kernelView.maxIterations = (int)view.toIterations;
+			fullTime = renderView(kernelView, width, height, full, nullptr);
+			resumeTime = renderView(kernelView, width, height, resumed, states.data());
+		}
+
+		//The kernels give the same values either way. Perturbation's
+		//approximation steps are cut short at the old limit and so land
+		//differently after it, which moves slow escapers by a fraction of a
+		//band, so pixels only count if they are a band out as elsewhere
+		int mismatches = 0;
+		for (size_t i = 0; i < full.size(); ++i)
+		{
+			bool inside = full[i] == view.toIterations;
+			bool resumedInside = resumed[i] == view.toIterations;
+			mismatches += inside != resumedInside || std::abs(full[i] - resumed[i]) > 1.0 ? 1 : 0;
+		}
+
+		if (view.perturbation)
+		{
+			lowerTime = renderPerturbation(centreRe, centreIm, FloatExp(view.width), view.fromIterations, width, height, resumed, states.data());
+		}
+		else
+		{
+			kernelView.maxIterations = (int)view.fromIterations;
+			lowerTime = renderView(kernelView, width, height, resumed, states.data());
+		}
+
+		ss << std::left << std::setw(20) << view.name << std::right << std::setw(16) << (std::to_string(view.fromIterations) + " to " + std::to_string(view.toIterations))
+		   << std::setw(10) << fullTime << std::setw(11) << resumeTime << std::setw(9) << fullTime / resumeTime << "x" << std::setw(10) << 100.0 * iterated / states.size() << "%"
+		   << std::setw(11) << lowerTime << std::setw(12) << mismatches << "\n";
+	}
+	ss << "\n";
+}
+
+/** Renders one view with a fill strategy and returns the time taken in ms*/
+double Benchmark::renderFill(FillMode mode, const BenchmarkView& view, int width, int height, vector<double>& mu)
+{
+	double pixelSize = view.width / (double)width;
+	DoubleDouble left = DoubleDouble(view.centreRe) - DoubleDouble(view.width / 2.0);
+	DoubleDouble top = DoubleDouble(view.centreIm) - DoubleDouble(pixelSize * height / 2.0);
+
+	FrameBuffer frame;
+	frame.create(width, height);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	PixelRenderer pixels;
+	pixels.setOutput(&frame, 0, height, view.maxIterations);
+	pixels.setKernel(&m_kernel, left, top, pixelSize, pixelSize);
+
+	if (mode == FillMode::Subdivision)
+	{
+		m_subdivision.render(pixels, m_threads);
+	}
+	else if (mode == FillMode::BoundaryTrace)
+	{
+		m_boundaryTrace.render(pixels, m_threads);
+	}
+	else
+	{
+#pragma omp parallel for schedule(dynamic) num_threads(m_threads)
+		for (int x = 0; x < width; ++x)
+		{
+			pixels.computeLine(x, 0, height, true);
+		}
+	}
+
+	double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	mu.resize(frame.getWidth() * frame.getHeight());
+	for (int i = 0; i < (int)mu.size(); ++i)
+	{
+		mu[i] = frame.getMu(i);
+	}
+	return time;
+}
+
+/** Times each fill strategy against iterating every pixel on the standard
+	views, and counts the pixels it got wrong*/
+void Benchmark::compareFill(std::stringstream& ss)
+{
+	vector<double> every, filled;
+
+	ss << "Fill strategies against every pixel, " << VIEW_WIDTH << "x" << VIEW_HEIGHT << ", ms, % of pixels filled and wrong pixels\n";
+	ss << std::left << std::setw(20) << "View" << std::right << std::setw(12) << "Every pixel" << std::setw(24) << "subdivision" << std::setw(24) << "boundary trace" << "\n";
+
+	for (const BenchmarkView& view : m_views)
+	{
+		double everyTime = renderFill(FillMode::BruteForce, view, VIEW_WIDTH, VIEW_HEIGHT, every);
+		ss << std::left << std::setw(20) << view.name << std::right << std::setw(12) << everyTime;
+
+		FillMode modes[2] = { FillMode::Subdivision, FillMode::BoundaryTrace };
+		for (FillMode mode : modes)
+		{
+			double time = renderFill(mode, view, VIEW_WIDTH, VIEW_HEIGHT, filled);
+			double skipped = mode == FillMode::Subdivision ? m_subdivision.getSkipped() : m_boundaryTrace.getSkipped();
+
+			std::stringstream cell;
+			cell << std::fixed << std::setprecision(1) << time << " " << 100.0 * skipped << "% " << std::setprecision(2) << wrongPercent(filled, every, view.maxIterations) << "%";
+			ss << std::setw(24) << cell.str();
+		}
+		ss << "\n";
+	}
+	ss << "\n";
+}
+
+/** Renders one view every pixel with threads threads, either a column at
+	a time through OpenMP or a tile at a time on the pool, and returns the
+	time taken in ms*/
+double Benchmark::renderScheduled(bool tiled, const BenchmarkView& view, int threads, vector<double>& mu)
+{
+	double pixelSize = view.width / (double)VIEW_WIDTH;
+	DoubleDouble left = DoubleDouble(view.centreRe) - DoubleDouble(view.width / 2.0);
+	DoubleDouble top = DoubleDouble(view.centreIm) - DoubleDouble(pixelSize * VIEW_HEIGHT / 2.0);
+
+	FrameBuffer frame;
+	frame.create(VIEW_WIDTH, VIEW_HEIGHT);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	PixelRenderer pixels;
+	pixels.setOutput(&frame, 0, VIEW_HEIGHT, view.maxIterations);
+	pixels.setKernel(&m_kernel, left, top, pixelSize, pixelSize);
+
+	if (tiled)
+	{
+		pixels.computeTiles(m_pool, threads, nullptr);
+	}
+	else
+	{
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+		for (int x = 0; x < VIEW_WIDTH; ++x)
+		{
+			pixels.computeLine(x, 0, VIEW_HEIGHT, true);
+		}
+	}
+
+	double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	mu.resize(frame.getWidth() * frame.getHeight());
+	for (int i = 0; i < (int)mu.size(); ++i)
+	{
+		mu[i] = frame.getMu(i);
+	}
+	return time;
+}
+
+/** Times the column-wise OpenMP loop against the tiled work stealing pool
+	as the thread count doubles, with how busy the pool's threads were*/
+void Benchmark::compareScheduling(std::stringstream& ss)
+{
+	vector<double> mu;
+
+	vector<int> counts;
+	for (int threads = 1; threads < m_threads; threads *= 2)
+	{
+		counts.push_back(threads);
+	}
+	counts.push_back(std::max(1, m_threads));
+
+	ss << "Scheduling every pixel, " << VIEW_WIDTH << "x" << VIEW_HEIGHT << ", columns by OpenMP against tiles on the pool, ms\n";
+	ss << std::left << std::setw(20) << "View" << std::right << std::setw(10) << "Threads" << std::setw(10) << "Columns" << std::setw(10) << "Tiles"
+	   << std::setw(10) << "Speedup" << std::setw(10) << "Busy %" << std::setw(10) << "Least %" << std::setw(10) << "Steals" << "\n";
+
+	for (const BenchmarkView& view : m_views)
+	{
+		double single = 0.0;
+		for (int threads : counts)
+		{
+			double columnTime = renderScheduled(false, view, threads, mu);
+			m_pool.resetStats();
+			double tileTime = renderScheduled(true, view, threads, mu);
+			single = threads == 1 ? tileTime : single;
+
+			//Busy share of each thread over the tiled render
+			double total = 0.0;
+			double least = 1.0;
+			int steals = 0;
+			for (int i = 0; i < threads; ++i)
+			{
+				ThreadStats stats = m_pool.getStats(i);
+				double busy = stats.busy + stats.idle > 0.0 ? stats.busy / (stats.busy + stats.idle) : 0.0;
+				total += busy;
+				least = std::min(least, busy);
+				steals += stats.steals;
+			}
+
+			ss << std::left << std::setw(20) << view.name << std::right << std::setw(10) << threads << std::setw(10) << columnTime << std::setw(10) << tileTime
+			   << std::setw(9) << single / tileTime << "x" << std::setw(10) << 100.0 * total / threads << std::setw(10) << 100.0 * least << std::setw(10) << steals << "\n";
+		}
+	}
+	ss << "\n";
+}
+
+/** Compares the old per-column buffers, with a separate image to upload,
+	against one frame of row-major planes at 4K and 8K. Memory is what each
+	holds per frame, time is a colour pass over every pixel, column by
+	column through the old buffers and a tile at a time through the frame*/
+void Benchmark::compareFrameStore(std::stringstream& ss)
+{
+	const int sizes[2][2] = { { 3840, 2160 }, { 7680, 4320 } };
+	const double maxIterations = 1000.0;
+
+	ss << "Frame storage, per-column buffers and an image against flat planes, MB and ms to colour every pixel\n";
+	ss << std::left << std::setw(20) << "Size" << std::right << std::setw(12) << "Columns MB" << std::setw(10) << "Flat MB"
+	   << std::setw(12) << "Columns ms" << std::setw(10) << "Flat ms" << std::setw(10) << "Speedup" << "\n";
+
+	for (const int* size : sizes)
+	{
+		const int width = size[0];
+		const int height = size[1];
+
+		//Mu is the same made up pattern in both, with some pixels inside
+		vector<vector<double>> columnMu(width, vector<double>(height));
+		vector<vector<PixelState>> columnStates(width, vector<PixelState>(height));
+		vector<uint8_t> image((size_t)width * height * 4);
+
+		FrameBuffer frame;
+		frame.create(width, height);
+		const uint32_t* bands = frame.getIterations();
+		const uint16_t* fractions = frame.getFractions();
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				int band = (x * 7 + y * 13) % 1100 + 1;
+				columnMu[x][y] = band > maxIterations ? maxIterations : band - 0.37;
+				frame.setMu((size_t)y * width + x, band > maxIterations ? (uint32_t)maxIterations : band, columnMu[x][y]);
+			}
+		}
+
+		double columnBytes = width * (sizeof(vector<double>) + sizeof(vector<PixelState>)) + (double)width * height * (sizeof(double) + sizeof(PixelState)) + image.size();
+
+		//The old pass, each thread down whole columns of the view
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#pragma omp parallel for schedule(dynamic) num_threads(m_threads)
+		for (int x = 0; x < width; ++x)
+		{
+			for (int y = 0; y < height; ++y)
+			{
+				uint8_t* rgba = &image[((size_t)y * width + x) * 4];
+				double value = columnMu[x][y];
+				rgba[0] = value == maxIterations ? 0 : (uint8_t)(sin(0.1 * value) * 127 + 128);
+				rgba[1] = value == maxIterations ? 0 : (uint8_t)(sin(0.1 * value + 4) * 127 + 128);
+				rgba[2] = value == maxIterations ? 0 : (uint8_t)(sin(0.1 * value + 2) * 127 + 128);
+				rgba[3] = 255;
+			}
+		}
+		double columnTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		//Tiles along the rows of the frame
+		start = std::chrono::steady_clock::now();
+		m_pool.run(ThreadPool::countTiles(width, height), m_threads, [&](int index)
+		{
+			FrameTile tile = ThreadPool::getTile(index, width, height);
+			for (int y = tile.top; y < tile.bottom; ++y)
+			{
+				//The planes are walked by pointer along the row rather than
+				//indexed through the frame a pixel at a time
+				size_t first = (size_t)y * width + tile.left;
+				const uint32_t* band = bands + first;
+				const uint16_t* fraction = fractions + first;
+				uint8_t* rgba = frame.getRgba() + first * 4;
+				for (int x = tile.left; x < tile.right; ++x, ++band, ++fraction, rgba += 4)
+				{
+					if (*band == maxIterations)
+					{
+						rgba[0] = rgba[1] = rgba[2] = 0;
+						continue;
+					}
+					double value = *band - *fraction * (1.0 / fractionSteps);
+					rgba[0] = (uint8_t)(sin(0.1 * value) * 127 + 128);
+					rgba[1] = (uint8_t)(sin(0.1 * value + 4) * 127 + 128);
+					rgba[2] = (uint8_t)(sin(0.1 * value + 2) * 127 + 128);
+				}
+			}
+		});
+		double flatTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		ss << std::left << std::setw(20) << (std::to_string(width) + "x" + std::to_string(height)) << std::right << std::setw(12) << columnBytes / (1024.0 * 1024.0)
+		   << std::setw(10) << frame.getBytes() / (1024.0 * 1024.0) << std::setw(12) << columnTime << std::setw(10) << flatTime << std::setw(9) << columnTime / flatTime << "x\n";
+	}
+	ss << "\n";
+}
+
+/** Colours mu the way the view does at the default frequencies, black
+	inside the set*/
+static void colourMu(double mu, bool inside, uint8_t* rgba)
+{
+	rgba[0] = inside ? 0 : (uint8_t)(sin(0.3 * mu + 0) * 127 + 128);
+	rgba[1] = inside ? 0 : (uint8_t)(sin(0.3 * mu + 4) * 127 + 128);
+	rgba[2] = inside ? 0 : (uint8_t)(sin(0.3 * mu + 2) * 127 + 128);
+}
+
+/** Renders every pixel of one view into a frame of the view's size*/
+void Benchmark::renderFrame(const BenchmarkView& view, FrameBuffer& frame)
+{
+	double pixelSize = view.width / (double)VIEW_WIDTH;
+	DoubleDouble left = DoubleDouble(view.centreRe) - DoubleDouble(view.width / 2.0);
+	DoubleDouble top = DoubleDouble(view.centreIm) - DoubleDouble(pixelSize * VIEW_HEIGHT / 2.0);
+
+	frame.create(VIEW_WIDTH, VIEW_HEIGHT);
+	frame.keepStates(true);
+	PixelRenderer pixels;
+	pixels.setOutput(&frame, 0, VIEW_HEIGHT, view.maxIterations);
+	pixels.setKernel(&m_kernel, left, top, pixelSize, pixelSize);
+	pixels.computeTiles(m_pool, m_threads, nullptr);
+}
+
+/** Checks the compact band and fraction mu of the frame against the
+	double the pixel states hold, as mu and as colour, on every standard
+	view. Then times colouring 4K from a double mu buffer against
+	colouring it from the compact planes, and the memory each needs*/
+void Benchmark::compareCompactMu(std::stringstream& ss)
+{
+	ss << "Compact mu, a 32 bit band and 16 bit fraction against a double, " << VIEW_WIDTH << "x" << VIEW_HEIGHT
+	   << ", largest mu error, largest colour error and % of pixels with any colour change\n";
+	ss << "Bound at frequency f: |mu error| <= 1/131070 so |colour error| <= 127 * f / 131070 + 1 from rounding to a byte\n";
+	ss << std::left << std::setw(20) << "View" << std::right << std::setw(14) << "Mu error" << std::setw(14) << "Colour error" << std::setw(12) << "Changed %" << "\n";
+
+	for (const BenchmarkView& view : m_views)
+	{
+		FrameBuffer frame;
+		renderFrame(view, frame);
+
+		double muError = 0.0;
+		int colourError = 0;
+		int changed = 0;
+		for (int i = 0; i < VIEW_WIDTH * VIEW_HEIGHT; ++i)
+		{
+			double exact = frame.getStates()[i].valueAt(view.maxIterations);
+			bool inside = frame.getIterations()[i] == (uint32_t)view.maxIterations;
+			muError = std::max(muError, std::abs(frame.getMu(i) - exact));
+
+			uint8_t expected[4], compact[4];
+			colourMu(exact, exact == view.maxIterations, expected);
+			colourMu(frame.getMu(i), inside, compact);
+			int error = 0;
+			for (int channel = 0; channel < 3; ++channel)
+			{
+				error = std::max(error, std::abs(expected[channel] - compact[channel]));
+			}
+			colourError = std::max(colourError, error);
+			changed += error > 0 ? 1 : 0;
+		}
+
+		ss << std::left << std::setw(20) << view.name << std::right << std::setw(14) << std::scientific << std::setprecision(2) << muError
+		   << std::fixed << std::setw(14) << colourError << std::setprecision(3) << std::setw(12) << 100.0 * changed / (VIEW_WIDTH * VIEW_HEIGHT) << std::setprecision(1) << "\n";
+	}
+
+	//Colouring throughput at 4K from each layout
+	const int width = 3840;
+	const int height = 2160;
+	const double maxIterations = 1000.0;
+	vector<double> mu((size_t)width * height);
+	FrameBuffer frame;
+	frame.create(width, height);
+	for (size_t i = 0; i < mu.size(); ++i)
+	{
+		int band = (int)(i * 7 % 1100) + 1;
+		mu[i] = band > maxIterations ? maxIterations : band - 0.37;
+		frame.setMu(i, band > maxIterations ? (uint32_t)maxIterations : band, mu[i]);
+	}
+
+	double times[2];
+	for (int compact = 0; compact < 2; ++compact)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		m_pool.run(ThreadPool::countTiles(width, height), m_threads, [&](int index)
+		{
+			FrameTile tile = ThreadPool::getTile(index, width, height);
+			for (int y = tile.top; y < tile.bottom; ++y)
+			{
+				for (size_t i = (size_t)y * width + tile.left; i < (size_t)y * width + tile.right; ++i)
+				{
+					if (compact)
+					{
+						colourMu(frame.getMu(i), frame.getIterations()[i] == maxIterations, frame.getRgba() + i * 4);
+					}
+					else
+					{
+						colourMu(mu[i], mu[i] == maxIterations, frame.getRgba() + i * 4);
+					}
+				}
+			}
+		});
+		times[compact] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double pixels = (double)width * height;
+	ss << "3840x2160 colour pass, double mu " << times[0] << " ms (" << pixels * sizeof(double) / (1024.0 * 1024.0) << " MB), band and fraction "
+	   << times[1] << " ms (" << pixels * (sizeof(uint32_t) + sizeof(uint16_t)) / (1024.0 * 1024.0) << " MB, the band plane is needed by the fill modes either way)\n";
+	ss << "\n";
+}
+
+/** Times recolouring each standard view the way a frequency change does,
+	three sines per pixel against the palette's tables, and counts the
+	colours the tables get wrong*/
+void Benchmark::compareColouring(std::stringstream& ss)
+{
+	Palette palette;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	palette.build(0.3, 0.3, 0.3);
+	double buildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	ss << "Recolouring, " << VIEW_WIDTH << "x" << VIEW_HEIGHT << ", sines against a " << paletteSize << " entry palette, ms, largest colour error and % of pixels changed\n";
+	ss << "Palette rebuild " << std::setprecision(3) << buildTime << std::setprecision(1) << " ms\n";
+	ss << std::left << std::setw(20) << "View" << std::right << std::setw(10) << "Sines" << std::setw(10) << "Palette" << std::setw(10) << "Speedup"
+	   << std::setw(14) << "Colour error" << std::setw(12) << "Changed %" << "\n";
+
+	vector<uint8_t> expected(VIEW_WIDTH * VIEW_HEIGHT * 4);
+	for (const BenchmarkView& view : m_views)
+	{
+		FrameBuffer frame;
+		renderFrame(view, frame);
+		const uint32_t* bands = frame.getIterations();
+		const uint32_t maxIterations = (uint32_t)view.maxIterations;
+
+		start = std::chrono::steady_clock::now();
+		m_pool.run(VIEW_HEIGHT, m_threads, [&](int y)
+		{
+			for (int i = y * VIEW_WIDTH; i < (y + 1) * VIEW_WIDTH; ++i)
+			{
+				colourMu(frame.getMu(i), bands[i] == maxIterations, &expected[i * 4]);
+			}
+		});
+		double sineTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		m_pool.run(VIEW_HEIGHT, m_threads, [&](int y)
+		{
+			palette.colourPixels(bands + y * VIEW_WIDTH, frame.getFractions() + y * VIEW_WIDTH, VIEW_WIDTH, maxIterations, frame.getRgba() + y * VIEW_WIDTH * 4);
+		});
+		double paletteTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		int colourError = 0;
+		int changed = 0;
+		for (int i = 0; i < VIEW_WIDTH * VIEW_HEIGHT; ++i)
+		{
+			int error = 0;
+			for (int channel = 0; channel < 3; ++channel)
+			{
+				error = std::max(error, std::abs(expected[i * 4 + channel] - frame.getRgba()[i * 4 + channel]));
+			}
+			colourError = std::max(colourError, error);
+			changed += error > 0 ? 1 : 0;
+		}
+
+		ss << std::left << std::setw(20) << view.name << std::right << std::setw(10) << sineTime << std::setw(10) << paletteTime << std::setw(9) << sineTime / paletteTime << "x"
+		   << std::setw(14) << colourError << std::setw(12) << 100.0 * changed / (VIEW_WIDTH * VIEW_HEIGHT) << "\n";
+	}
+	ss << "\n";
+}
+
+/** Times histogram colouring against the plain palette on each standard
+	view: counting the histogram once a render, and colouring through it,
+	as a share of the time to work the frame out*/
+void Benchmark::compareHistogram(std::stringstream& ss)
+{
+	Palette palette;
+	Histogram histogram;
+
+	ss << "Histogram colouring, " << VIEW_WIDTH << "x" << VIEW_HEIGHT << ", ms to work out, count, colour by palette and colour by histogram\n";
+	ss << std::left << std::setw(20) << "View" << std::right << std::setw(10) << "Compute" << std::setw(10) << "Count" << std::setw(10) << "Palette"
+	   << std::setw(12) << "Histogram" << std::setw(12) << "Overhead" << "\n";
+
+	for (const BenchmarkView& view : m_views)
+	{
+		FrameBuffer frame;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		renderFrame(view, frame);
+		double computeTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		const uint32_t* bands = frame.getIterations();
+		const uint32_t maxIterations = (uint32_t)view.maxIterations;
+
+		start = std::chrono::steady_clock::now();
+		histogram.count(m_pool, m_threads, bands, VIEW_WIDTH, VIEW_HEIGHT, maxIterations);
+		double countTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		double times[2];
+		for (int equalised = 0; equalised < 2; ++equalised)
+		{
+			start = std::chrono::steady_clock::now();
+			m_pool.run(VIEW_HEIGHT, m_threads, [&](int y)
+			{
+				int row = y * VIEW_WIDTH;
+				if (equalised)
+				{
+					palette.colourEqualised(bands + row, frame.getFractions() + row, VIEW_WIDTH, maxIterations, histogram, frame.getRgba() + row * 4);
+				}
+				else
+				{
+					palette.colourPixels(bands + row, frame.getFractions() + row, VIEW_WIDTH, maxIterations, frame.getRgba() + row * 4);
+				}
+			});
+			times[equalised] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		double overhead = (countTime + times[1] - times[0]) / computeTime;
+		ss << std::left << std::setw(20) << view.name << std::right << std::setw(10) << computeTime << std::setw(10) << countTime << std::setw(10) << times[0]
+		   << std::setw(12) << times[1] << std::setw(11) << 100.0 * overhead << "%\n";
+	}
+	ss << "\n";
+}
+
+/** Times one step of colour cycling on a single thread at 4K and at the
+	view's size: rotating the loop of colours and looking every pixel up
+	from its slot, against recolouring from mu through the palette and
+	from mu through three sines*/
+void Benchmark::compareCycling(std::stringstream& ss)
+{
+	const int sizes[2][2] = { { VIEW_WIDTH, VIEW_HEIGHT }, { 3840, 2160 } };
+	const uint32_t maxIterations = 1000;
+	const int steps = 20;
+	Palette palette;
+
+	ss << "Colour cycling on one thread, ms per animated frame, slot lookups against recolouring by palette and by sines\n";
+	ss << std::left << std::setw(20) << "Size" << std::right << std::setw(10) << "Index" << std::setw(10) << "Cycle" << std::setw(10) << "Palette"
+	   << std::setw(10) << "Sines" << std::setw(12) << "Cycle fps" << "\n";
+
+	for (const int* size : sizes)
+	{
+		const int width = size[0];
+		const int height = size[1];
+		FrameBuffer frame;
+		frame.create(width, height);
+		for (size_t i = 0; i < (size_t)width * height; ++i)
+		{
+			uint32_t band = (uint32_t)(i * 7 % 1100) + 1;
+			frame.setMu(i, std::min(band, maxIterations), band - 0.37);
+		}
+		const uint32_t* bands = frame.getIterations();
+		const uint16_t* fractions = frame.getFractions();
+
+		//Slots are given once, when cycling starts
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		m_pool.run(height, 1, [&](int y)
+		{
+			palette.indexPixels(bands + (size_t)y * width, fractions + (size_t)y * width, width, maxIterations, nullptr, frame.getSlots() + (size_t)y * width);
+		});
+		double indexTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		for (int step = 0; step < steps; ++step)
+		{
+			palette.buildCycle(step * 0.5);
+			m_pool.run(height, 1, [&](int y)
+			{
+				palette.expandCycle(frame.getSlots() + (size_t)y * width, width, frame.getRgba() + (size_t)y * width * 4);
+			});
+		}
+		double cycleTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / steps;
+
+		start = std::chrono::steady_clock::now();
+		for (int step = 0; step < steps; ++step)
+		{
+			palette.build(0.3 + step * 0.01, 0.3, 0.3);
+			m_pool.run(height, 1, [&](int y)
+			{
+				palette.colourPixels(bands + (size_t)y * width, fractions + (size_t)y * width, width, maxIterations, frame.getRgba() + (size_t)y * width * 4);
+			});
+		}
+		double paletteTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / steps;
+
+		start = std::chrono::steady_clock::now();
+		m_pool.run(height, 1, [&](int y)
+		{
+			for (size_t i = (size_t)y * width; i < (size_t)(y + 1) * width; ++i)
+			{
+				colourMu(frame.getMu(i), bands[i] == maxIterations, frame.getRgba() + i * 4);
+			}
+		});
+		double sineTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		ss << std::left << std::setw(20) << (std::to_string(width) + "x" + std::to_string(height)) << std::right << std::setw(10) << indexTime << std::setw(10) << cycleTime
+		   << std::setw(10) << paletteTime << std::setw(10) << sineTime << std::setw(12) << 1000.0 / cycleTime << "\n";
+	}
+	ss << "\n";
+}
+
+/** Starts slow renders on another thread, the way the viewer runs them,
+	cancels them part way and times how long they take to stop. The kernel
+	is cancelled while iterating, perturbation while iterating its
+	reference and while iterating pixels*/
+void Benchmark::compareCancellation(std::stringstream& ss)
+{
+	struct CancelView
+	{
+		const char* name;
+		const char* centreRe;
+		const char* centreIm;
+		int exponent;
+		int maxIterations;
+		bool perturbation;
+	};
+
+	const CancelView views[] = {
+		{ "Kernel, seahorse", "-0.743643887037151", "0.131825904205330", 9, 10000000, false },
+		{ "Perturbation, c = i", "0", "1", 100, 10000000, true },
+		{ "Perturbation, seahorse", "-0.743643887037151", "0.131825904205330", 14, 200000, true }
+	};
+	const int delays[] = { 50, 200 };
+	std::atomic<bool> cancel(false);
+	m_kernel.setCancel(&cancel);
+	m_perturbation.setCancel(&cancel);
+
+	ss << "Cancelling renders part way, ms from the cancel until the render thread is free\n";
+	ss << std::left << std::setw(30) << "View" << std::right << std::setw(10) << "Limit" << std::setw(10) << "After" << std::setw(10) << "Stopped" << "\n";
+
+	for (const CancelView& view : views)
+	{
+		BigFixed centreRe = BigFixed(std::string(view.centreRe));
+		BigFixed centreIm = BigFixed(std::string(view.centreIm));
+		FloatExp viewWidth = BigFixed("1e-" + std::to_string(view.exponent)).toFloatExp();
+		BenchmarkView kernelView = { view.name, centreRe.toDouble(), centreIm.toDouble(), viewWidth.toDouble(), view.maxIterations };
+
+		for (int delay : delays)
+		{
+			FrameBuffer frame;
+			vector<double> mu;
+			cancel = false;
+			std::atomic<bool> finished(false);
+			std::thread render([&]()
+			{
+				if (view.perturbation)
+				{
+					renderPerturbation(centreRe, centreIm, viewWidth, view.maxIterations, VIEW_WIDTH, VIEW_HEIGHT, mu, nullptr);
+				}
+				else
+				{
+					renderFrame(kernelView, frame);
+				}
+				finished = true;
+			});
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+			bool early = finished;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			cancel = true;
+			render.join();
+			double stopTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			ss << std::left << std::setw(30) << view.name << std::right << std::setw(10) << view.maxIterations << std::setw(8) << delay << "ms";
+			if (early)
+			{
+				ss << std::setw(10) << "finished" << "\n";
+			}
+			else
+			{
+				ss << std::setw(10) << stopTime << "\n";
+			}
+		}
+	}
+	ss << "\n";
+
+	m_kernel.setCancel(nullptr);
+	m_perturbation.setCancel(nullptr);
+}
+
+/** Renders every pixel of each view at the view's size in one go and in
+	progressive passes from the centre, timing each pass as a thread
+	watching it would see it finish, and keeps the fastest go of each.
+	Both must give the same bands*/
+void Benchmark::compareProgressive(std::stringstream& ss)
+{
+	vector<BenchmarkView> views = m_views;
+	views.push_back({ "Seahorse 1e-9", -0.743643887037151, 0.131825904205330, 1e-9, 20000 });
+	Progressive progressive;
+
+	ss << "Progressive rendering at " << VIEW_WIDTH << "x" << VIEW_HEIGHT << ", ms until each pass is ready against one pass over every pixel\n";
+	ss << std::left << std::setw(20) << "View" << std::right << std::setw(10) << "One pass" << std::setw(10) << "1/16"
+	   << std::setw(10) << "Full" << std::setw(10) << "Extra" << std::setw(10) << "Differ" << "\n";
+
+	for (const BenchmarkView& view : views)
+	{
+		double pixelSize = view.width / (double)VIEW_WIDTH;
+		DoubleDouble left = DoubleDouble(view.centreRe) - DoubleDouble(view.width / 2.0);
+		DoubleDouble top = DoubleDouble(view.centreIm) - DoubleDouble(pixelSize * VIEW_HEIGHT / 2.0);
+
+		FrameBuffer whole, passes;
+		whole.create(VIEW_WIDTH, VIEW_HEIGHT);
+		passes.create(VIEW_WIDTH, VIEW_HEIGHT);
+
+		PixelRenderer pixels;
+		pixels.setKernel(&m_kernel, left, top, pixelSize, pixelSize);
+		double wholeTime = 0.0;
+		double passesTime = 0.0;
+		double passTimes[2] = { 0.0, 0.0 };
+		for (int run = 0; run < progressiveRuns; ++run)
+		{
+			pixels.setOutput(&whole, 0, VIEW_HEIGHT, view.maxIterations);
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			pixels.computeTiles(m_pool, m_threads, nullptr);
+			double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			wholeTime = run == 0 ? time : std::min(wholeTime, time);
+
+			//Watches the passes finish from another thread, as the view
+			//does, sleeping between looks so as not to take time from the
+			//render
+			double times[2] = { 0.0, 0.0 };
+			std::atomic<bool> done(false);
+			pixels.setOutput(&passes, 0, VIEW_HEIGHT, view.maxIterations);
+			progressive.begin(VIEW_WIDTH, VIEW_HEIGHT, VIEW_WIDTH / 2, VIEW_HEIGHT / 2);
+			start = std::chrono::steady_clock::now();
+			std::thread watcher([&]()
+			{
+				int seen = 0;
+				while (!done && seen < progressive.getPassCount())
+				{
+					int finished = progressive.getPasses();
+					for (; seen < finished; ++seen)
+					{
+						times[seen] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+					}
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+			});
+			progressive.render(pixels, m_pool, m_threads, nullptr);
+			time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			done = true;
+			watcher.join();
+			if (run == 0 || time < passesTime)
+			{
+				passesTime = time;
+				passTimes[0] = times[0];
+				passTimes[1] = times[1];
+			}
+		}
+
+		int differ = 0;
+		for (size_t i = 0; i < (size_t)VIEW_WIDTH * VIEW_HEIGHT; ++i)
+		{
+			differ += whole.getIterations()[i] != passes.getIterations()[i] || whole.getFractions()[i] != passes.getFractions()[i] ? 1 : 0;
+		}
+
+		ss << std::left << std::setw(20) << view.name << std::right << std::setw(10) << wholeTime << std::setw(10) << passTimes[0]
+		   << std::setw(10) << passesTime << std::setw(9) << 100.0 * (passesTime - wholeTime) / wholeTime << "%" << std::setw(10) << differ << "\n";
+	}
+	ss << "\n";
+}
+
+/** Probes each view for its cost map, then renders the rest of it a tile
+	at a time on one thread, timing every tile. Gives how long the rest
+	took against the probe's prediction, and how long the slowest of
+	threads blocks of tiles would take against an even share, with the
+	blocks split by count and by predicted cost*/
+void Benchmark::compareCostMap(std::stringstream& ss)
+{
+	vector<BenchmarkView> views = m_views;
+	views.push_back({ "Seahorse 1e-9", -0.743643887037151, 0.131825904205330, 1e-9, 20000 });
+	const int splits[] = { 4, 16 };
+	CostMap costs;
+
+	ss << "Cost map from a probe of 1 pixel in 64, " << VIEW_WIDTH << "x" << VIEW_HEIGHT << ", ms, and slowest block of tiles as % of an even share\n";
+	ss << std::left << std::setw(20) << "View" << std::right << std::setw(10) << "Whole" << std::setw(10) << "Probe" << std::setw(10) << "Predicted"
+	   << std::setw(10) << "Rest" << std::setw(10) << "Ratio";
+	for (int threads : splits)
+	{
+		ss << std::setw(9) << threads << "n" << std::setw(9) << threads << "c";
+	}
+	ss << "\n";
+
+	for (const BenchmarkView& view : views)
+	{
+		double pixelSize = view.width / (double)VIEW_WIDTH;
+		DoubleDouble left = DoubleDouble(view.centreRe) - DoubleDouble(view.width / 2.0);
+		DoubleDouble top = DoubleDouble(view.centreIm) - DoubleDouble(pixelSize * VIEW_HEIGHT / 2.0);
+
+		FrameBuffer whole, probed;
+		whole.create(VIEW_WIDTH, VIEW_HEIGHT);
+		probed.create(VIEW_WIDTH, VIEW_HEIGHT);
+
+		PixelRenderer pixels;
+		pixels.setOutput(&whole, 0, VIEW_HEIGHT, view.maxIterations);
+		pixels.setKernel(&m_kernel, left, top, pixelSize, pixelSize);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		pixels.computeTiles(m_pool, 1, nullptr);
+		double wholeTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		pixels.setOutput(&probed, 0, VIEW_HEIGHT, view.maxIterations);
+		costs.probe(pixels, m_pool, 1);
+
+		const int tiles = ThreadPool::countTiles(VIEW_WIDTH, VIEW_HEIGHT);
+		vector<double> tileTimes(tiles);
+		start = std::chrono::steady_clock::now();
+		m_pool.run(tiles, 1, [&](int index)
+		{
+			std::chrono::steady_clock::time_point begun = std::chrono::steady_clock::now();
+			FrameTile tile = ThreadPool::getTile(index, VIEW_WIDTH, VIEW_HEIGHT);
+			for (int y = tile.top; y < tile.bottom; ++y)
+			{
+				pixels.computeLine(tile.left, y, tile.right - tile.left, false);
+			}
+			tileTimes[index] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begun).count();
+		});
+		double restTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		double predicted = costs.predictRemaining();
+
+		ss << std::left << std::setw(20) << view.name << std::right << std::setw(10) << wholeTime << std::setw(10) << costs.getProbeTime() << std::setw(10) << predicted
+		   << std::setw(10) << restTime << std::setw(10) << restTime / predicted;
+
+		//Times each block of tiles as it would run with no stealing
+		double total = 0.0;
+		for (double time : tileTimes)
+		{
+			total += time;
+		}
+		for (int threads : splits)
+		{
+			for (int byCost = 0; byCost < 2; ++byCost)
+			{
+				std::vector<int> blocks = ThreadPool::splitTasks(tiles, threads, byCost ? costs.getTileCosts() : nullptr);
+				double slowest = 0.0;
+				for (int i = 0; i < threads; ++i)
+				{
+					double block = 0.0;
+					for (int t = blocks[i]; t < blocks[i + 1]; ++t)
+					{
+						block += tileTimes[t];
+					}
+					slowest = std::max(slowest, block);
+				}
+				ss << std::setw(9) << 100.0 * slowest * threads / total << "%";
+			}
+		}
+		ss << "\n";
+	}
+	ss << "\n";
+}
+
+/** Renders each view progressively and times how long until all of it is
+	coloured and copied into a stand-in for the texture: colouring and
+	copying the whole frame after the render, against handing every tile
+	to the pipeline as it finishes and copying tiles out as they come.
+	Gives the total and how much of it came after the last pixel was
+	worked out. Every pass is coloured in the pipeline, as the view shows
+	it, so on fewer cores than threads its render slows by that much*/
+void Benchmark::compareTilePipeline(std::stringstream& ss)
+{
+	vector<BenchmarkView> views = m_views;
+	views.push_back({ "Seahorse 1e-9", -0.743643887037151, 0.131825904205330, 1e-9, 20000 });
+	Progressive progressive;
+	TilePipeline pipeline;
+	Palette palette;
+	palette.build(0.3, 0.3, 0.3);
+	vector<uint8_t> texture(VIEW_WIDTH * VIEW_HEIGHT * 4);
+
+	ss << "Tile pipeline, " << VIEW_WIDTH << "x" << VIEW_HEIGHT << ", ms until the frame is coloured and copied out, and of that after the render\n";
+	ss << std::left << std::setw(20) << "View" << std::right << std::setw(12) << "Sequential" << std::setw(10) << "After" << std::setw(11) << "Pipelined"
+	   << std::setw(10) << "After" << "\n";
+
+	for (const BenchmarkView& view : views)
+	{
+		double pixelSize = view.width / (double)VIEW_WIDTH;
+		DoubleDouble left = DoubleDouble(view.centreRe) - DoubleDouble(view.width / 2.0);
+		DoubleDouble top = DoubleDouble(view.centreIm) - DoubleDouble(pixelSize * VIEW_HEIGHT / 2.0);
+		const uint32_t maxIterations = (uint32_t)view.maxIterations;
+
+		FrameBuffer sequential, pipelined;
+		sequential.create(VIEW_WIDTH, VIEW_HEIGHT);
+		pipelined.create(VIEW_WIDTH, VIEW_HEIGHT);
+		PixelRenderer pixels;
+		pixels.setKernel(&m_kernel, left, top, pixelSize, pixelSize);
+
+		//Render, then colour and copy the whole frame
+		pixels.setOutput(&sequential, 0, VIEW_HEIGHT, view.maxIterations);
+		progressive.begin(VIEW_WIDTH, VIEW_HEIGHT, VIEW_WIDTH / 2, VIEW_HEIGHT / 2);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		progressive.render(pixels, m_pool, m_threads, nullptr);
+		std::chrono::steady_clock::time_point rendered = std::chrono::steady_clock::now();
+		m_pool.run(VIEW_HEIGHT, m_threads, [&](int y)
+		{
+			palette.colourPixels(sequential.getIterations() + y * VIEW_WIDTH, sequential.getFractions() + y * VIEW_WIDTH, VIEW_WIDTH, maxIterations,
+								 sequential.getRgba() + y * VIEW_WIDTH * 4);
+		});
+		std::copy(sequential.getRgba(), sequential.getRgba() + texture.size(), texture.begin());
+		double sequentialTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		double sequentialAfter = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - rendered).count();
+
+		//Tiles copied out on another thread as they come, as the view does
+		pixels.setOutput(&pipelined, 0, VIEW_HEIGHT, view.maxIterations);
+		progressive.begin(VIEW_WIDTH, VIEW_HEIGHT, VIEW_WIDTH / 2, VIEW_HEIGHT / 2);
+		pipeline.begin(&pipelined, palette, view.maxIterations, 0, VIEW_HEIGHT, -1);
+		std::atomic<bool> done(false);
+		start = std::chrono::steady_clock::now();
+		std::thread uploader([&]()
+		{
+			for (;;)
+			{
+				bool finished = done && pipeline.isIdle();
+				PackedTile* packed;
+				while ((packed = pipeline.takePacked()) != nullptr)
+				{
+					for (int y = 0; y < packed->height; ++y)
+					{
+						const uint8_t* row = packed->rgba.data() + y * packed->width * 4;
+						std::copy(row, row + packed->width * 4, texture.begin() + ((packed->top + y) * VIEW_WIDTH + packed->left) * 4);
+					}
+					pipeline.release(packed);
+				}
+				if (finished)
+				{
+					return;
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		});
+		progressive.render(pixels, m_pool, m_threads, [&pipeline](int tile, int step) { pipeline.pushTile(tile, step); });
+		rendered = std::chrono::steady_clock::now();
+		done = true;
+		uploader.join();
+		double pipelinedTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		double pipelinedAfter = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - rendered).count();
+
+		//Both must end up with the same picture
+		if (!pipeline.isComplete() || !std::equal(texture.begin(), texture.end(), sequential.getRgba()))
+		{
+			ss << view.name << " pipelined colours differ\n";
+		}
+
+		ss << std::left << std::setw(20) << view.name << std::right << std::setw(12) << sequentialTime << std::setw(10) << sequentialAfter << std::setw(11)
+		   << pipelinedTime << std::setw(10) << pipelinedAfter << "\n";
+	}
+	ss << "\n";
+}
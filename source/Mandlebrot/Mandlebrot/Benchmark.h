@@ -0,0 +1,81 @@
+#pragma once
+#include "Constants.h"
+#include "Kernel.h"
+#include "Perturbation.h"
+#include "PixelRenderer.h"
+#include "Subdivision.h"
+#include "BoundaryTrace.h"
+#include "ThreadPool.h"
+#include "Palette.h"
+#include "Histogram.h"
+#include "Progressive.h"
+#include "CostMap.h"
+#include "TilePipeline.h"
+#include <string>
+#include <vector>
+#include <sstream>
+
+// Import things we need from the standard library
+using std::vector;
+using std::string;
+
+//A named location used to compare render paths
+struct BenchmarkView
+{
+	const char* name;
+	double centreRe, centreIm;
+	double width;
+	int maxIterations;
+};
+
+class Benchmark
+{
+
+public:
+	Benchmark();
+	~Benchmark();
+
+	string run();
+
+private:
+	double renderView(const BenchmarkView& view, int width, int height, vector<double>& mu, PixelState* states);
+	void compareInteriorChecks(std::stringstream& ss);
+	double renderPerturbation(const BigFixed& centreRe, const BigFixed& centreIm, FloatExp viewWidth, long long maxIterations,
+							  int width, int height, vector<double>& mu, PixelState* states);
+	double iterateExact(const BigFixed& re, const BigFixed& im, int maxIterations);
+	void iterateSamples(const BigFixed& centreRe, const BigFixed& centreIm, FloatExp viewWidth, int maxIterations, int width, int height,
+						vector<int>& pixels, vector<double>& exact);
+	void comparePrecision(std::stringstream& ss);
+	void compareDeepZoom(std::stringstream& ss);
+	void compareResume(std::stringstream& ss);
+	double renderFill(FillMode mode, const BenchmarkView& view, int width, int height, vector<double>& mu);
+	void compareFill(std::stringstream& ss);
+	double renderScheduled(bool tiled, const BenchmarkView& view, int threads, vector<double>& mu);
+	void compareScheduling(std::stringstream& ss);
+	void compareFrameStore(std::stringstream& ss);
+	void renderFrame(const BenchmarkView& view, FrameBuffer& frame);
+	void compareCompactMu(std::stringstream& ss);
+	void compareColouring(std::stringstream& ss);
+	void compareHistogram(std::stringstream& ss);
+	void compareCycling(std::stringstream& ss);
+	void compareCancellation(std::stringstream& ss);
+	void compareProgressive(std::stringstream& ss);
+	void compareCostMap(std::stringstream& ss);
+	void compareTilePipeline(std::stringstream& ss);
+
+	//Kernel and deep zoom engine under test
+	Kernel m_kernel;
+	Perturbation m_perturbation;
+	Subdivision m_subdivision;
+	BoundaryTrace m_boundaryTrace;
+
+	//Standard locations
+	vector<BenchmarkView> m_views;
+
+	//Thread count
+	int m_threads;
+
+	//Persistent threads for the tiled scheduler
+	ThreadPool m_pool;
+
+};
@@ -0,0 +1,454 @@
+#include "BigFixed.h"
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <cfloat>
+#include <algorithm>
+
+//Fraction limbs every number gets at least, enough for a double-double
+static const int minimumLimbs = 2;
+
+//Binary digits carried by each decimal digit
+static const double bitsPerDigit = 3.3219280948873623;
+
+BigFixed::BigFixed()
+{
+	m_limbs.assign(minimumLimbs + 1, 0);
+	m_negative = false;
+}
+
+/** Converts a double exactly, with as many limbs as its lowest bit needs*/
+BigFixed::BigFixed(double d)
+{
+	int exponent = 0;
+	std::frexp(d, &exponent);
+	int bits = d == 0.0 ? 0 : DBL_MANT_DIG - exponent;
+
+	*this = BigFixed(d, limbsForBits(bits));
+}
+
+/** Converts a double, truncated to the given number of fraction limbs*/
+BigFixed::BigFixed(double d, int fractionLimbs)
+{
+	m_limbs.assign(fractionLimbs + 1, 0);
+	m_negative = d < 0.0;
+
+	double magnitude = std::abs(d);
+	double whole = std::floor(magnitude);
+	double fraction = magnitude - whole;
+	m_limbs[fractionLimbs] = (uint32_t)whole;
+
+	//Peels off 32 bits at a time, every step is exact
+	for (int i = fractionLimbs - 1; i >= 0 && fraction != 0.0; --i)
+	{
+		fraction = std::ldexp(fraction, 32);
+		double limb = std::floor(fraction);
+		m_limbs[i] = (uint32_t)limb;
+		fraction -= limb;
+	}
+}
+
+/** Converts a FloatExp, truncated to the given number of fraction limbs.
+	Used to place a reference orbit at an offset from the view centre*/
+BigFixed::BigFixed(const FloatExp& f, int fractionLimbs)
+{
+	//Splits the exponent into whole limbs and a shift a double can take
+	int limbShift = f.e >= 0 ? f.e / 32 : -((31 - f.e) / 32);
+	if (limbShift > 0 || fractionLimbs + limbShift < 0)
+	{
+		*this = BigFixed(f.toDouble(), fractionLimbs);
+		return;
+	}
+
+	BigFixed power(0.0, fractionLimbs);
+	power.m_limbs[fractionLimbs + limbShift] = 1;
+	*this = BigFixed(std::ldexp(f.m, f.e - 32 * limbShift), fractionLimbs) * power;
+}
+
+/** Parses a decimal such as -1.25, 0.3e-120 or 4E7, with enough limbs to
+	hold every digit given*/
+BigFixed::BigFixed(const std::string& text)
+{
+	size_t pos = 0;
+	bool negative = false;
+	if (pos < text.size() && (text[pos] == '-' || text[pos] == '+'))
+	{
+		negative = text[pos] == '-';
+		++pos;
+	}
+
+	//Collects the digits and where the decimal point falls among them
+	std::string digits;
+	int point = -1;
+	for (; pos < text.size(); ++pos)
+	{
+		if (std::isdigit((unsigned char)text[pos]))
+		{
+			digits += text[pos];
+		}
+		else if (text[pos] == '.' && point < 0)
+		{
+			point = (int)digits.size();
+		}
+		else
+		{
+			break;
+		}
+	}
+	if (point < 0)
+	{
+		point = (int)digits.size();
+	}
+	if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E'))
+	{
+		point += std::atoi(text.c_str() + pos + 1);
+	}
+
+	//Splits into whole and fraction digits with the exponent applied
+	std::string whole, fraction;
+	if (point <= 0)
+	{
+		fraction = std::string(-point, '0') + digits;
+	}
+	else if (point >= (int)digits.size())
+	{
+		whole = digits + std::string(point - digits.size(), '0');
+	}
+	else
+	{
+		whole = digits.substr(0, point);
+		fraction = digits.substr(point);
+	}
+
+	int fractionLimbs = limbsForBits((int)std::ceil(fraction.size() * bitsPerDigit) + 32);
+	m_limbs.assign(fractionLimbs + 1, 0);
+	m_negative = false;
+
+	//Builds the fraction from its last digit up, f = (d + f) / 10
+	for (size_t i = fraction.size(); i-- > 0;)
+	{
+		m_limbs[fractionLimbs] = fraction[i] - '0';
+		divideSmall(10);
+	}
+
+	unsigned long long wholeValue = 0;
+	for (char c : whole)
+	{
+		wholeValue = wholeValue * 10 + (c - '0');
+	}
+	m_limbs[fractionLimbs] = (uint32_t)wholeValue;
+	m_negative = negative && !isZero();
+}
+
+/** Rounds to the nearest double*/
+double BigFixed::toDouble() const
+{
+	int fractionLimbs = getFractionLimbs();
+	double d = 0.0;
+
+	//Smallest limbs first so the rounding happens once at the end
+	for (int i = 0; i <= fractionLimbs; ++i)
+	{
+		d += std::ldexp((double)m_limbs[i], 32 * (i - fractionLimbs));
+	}
+	return m_negative ? -d : d;
+}
+
+/** Rounds to a double-double, the form the vectorised kernels take*/
+DoubleDouble BigFixed::toDoubleDouble() const
+{
+	double hi = toDouble();
+	double lo = (*this - BigFixed(hi)).toDouble();
+	return DoubleDouble(hi, lo);
+}
+
+/** Rounds to a double mantissa and int exponent, so tiny view sizes that
+	a double would flush to zero survive*/
+FloatExp BigFixed::toFloatExp() const
+{
+	int fractionLimbs = getFractionLimbs();
+	int top = fractionLimbs;
+	while (top >= 0 && m_limbs[top] == 0)
+	{
+		--top;
+	}
+	if (top < 0)
+	{
+		return FloatExp();
+	}
+
+	//Three limbs cover the 53 bits of the mantissa
+	double mantissa = 0.0;
+	for (int i = std::max(top - 2, 0); i <= top; ++i)
+	{
+		mantissa += std::ldexp((double)m_limbs[i], 32 * (i - top));
+	}
+	return FloatExp(m_negative ? -mantissa : mantissa, 32 * (top - fractionLimbs));
+}
+
+/** Writes the number as a decimal rounded to the given number of fraction
+	digits*/
+std::string BigFixed::toString(int digits) const
+{
+	int fractionLimbs = getFractionLimbs();
+
+	//Each multiply by ten pushes the next digit into the whole limb, one
+	//past the last to round on
+	BigFixed fraction = *this;
+	std::string text;
+	for (int i = 0; i <= digits; ++i)
+	{
+		fraction.m_limbs[fractionLimbs] = 0;
+		fraction.multiplySmall(10);
+		text += (char)('0' + fraction.m_limbs[fractionLimbs]);
+	}
+	bool up = text.back() >= '5';
+	text.pop_back();
+
+	//Rounding up carries through any nines into the whole part
+	for (size_t i = text.size(); up && i-- > 0;)
+	{
+		up = text[i] == '9';
+		text[i] = up ? '0' : text[i] + 1;
+	}
+	unsigned long long whole = (unsigned long long)m_limbs[fractionLimbs] + (up ? 1 : 0);
+	bool negative = m_negative && (whole != 0 || text.find_first_not_of('0') != std::string::npos);
+	return (negative ? "-" : "") + std::to_string(whole) + "." + text;
+}
+
+/** Pads or truncates the fraction to the given number of limbs*/
+void BigFixed::setFractionLimbs(int fractionLimbs)
+{
+	m_limbs = widen(fractionLimbs);
+	m_negative = m_negative && !isZero();
+}
+
+bool BigFixed::isZero() const
+{
+	for (uint32_t limb : m_limbs)
+	{
+		if (limb != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Fraction limbs needed for the given number of binary places*/
+int BigFixed::limbsForBits(int bits)
+{
+	return std::max(minimumLimbs, (bits + 31) / 32);
+}
+
+/** Checks that locations typed in as decimals read back digit for digit,
+	that doubles and double-doubles go in and come out exactly, and that
+	adding and taking away a number gives back what it started from. Adds
+	a line to report for each that fails. Returns true if all pass*/
+bool BigFixed::check(std::string& report)
+{
+	bool passed = true;
+	auto fail = [&](const std::string& what)
+	{
+		report += "BigFixed: " + what + "\n";
+		passed = false;
+	};
+
+	const char* decimals[] = { "-0.743643887037158704752191506114774", "0.1", "0.000000000000000000000000000000000000000001", "-2.5", "1.15" };
+	for (const char* decimal : decimals)
+	{
+		std::string text(decimal);
+		std::string back = BigFixed(text).toString((int)(text.size() - text.find('.') - 1));
+		if (back != text)
+		{
+			fail(text + " reads back as " + back);
+		}
+	}
+
+	const double doubles[] = { -3.05, 1.15, 0.1, -1.0 / 3.0, std::ldexp(1.0, -300), 123456.789 };
+	for (double d : doubles)
+	{
+		if (BigFixed(d).toDouble() != d)
+		{
+			fail("double " + std::to_string(d) + " does not come back exactly");
+		}
+	}
+
+	//A double-double's two halves are the sum a view's corner is built from
+	DoubleDouble third = DoubleDouble(1.0) / DoubleDouble(3.0);
+	DoubleDouble back = (BigFixed(third.hi, limbsForBits(128)) + BigFixed(third.lo, limbsForBits(128))).toDoubleDouble();
+	if (back.hi != third.hi || back.lo != third.lo)
+	{
+		fail("double-double 1/3 does not come back exactly");
+	}
+
+	BigFixed centre("-0.743643887037158704752191506114774");
+	BigFixed step("0.000000000000000000000000000012345");
+	BigFixed sum = centre + step - step;
+	if (centre < sum || sum < centre || !(centre - centre).isZero())
+	{
+		fail("adding and taking away " + step.toString(33) + " gives " + sum.toString(33));
+	}
+	return passed;
+}
+
+/** Returns the magnitude with the given number of fraction limbs*/
+std::vector<uint32_t> BigFixed::widen(int fractionLimbs) const
+{
+	int shift = fractionLimbs - getFractionLimbs();
+	std::vector<uint32_t> limbs(fractionLimbs + 1, 0);
+
+	for (int i = 0; i <= fractionLimbs; ++i)
+	{
+		int source = i - shift;
+		if (source >= 0 && source < (int)m_limbs.size())
+		{
+			limbs[i] = m_limbs[source];
+		}
+	}
+	return limbs;
+}
+
+void BigFixed::multiplySmall(uint32_t factor)
+{
+	unsigned long long carry = 0;
+	for (uint32_t& limb : m_limbs)
+	{
+		unsigned long long t = (unsigned long long)limb * factor + carry;
+		limb = (uint32_t)t;
+		carry = t >> 32;
+	}
+}
+
+void BigFixed::divideSmall(uint32_t divisor)
+{
+	unsigned long long remainder = 0;
+	for (size_t i = m_limbs.size(); i-- > 0;)
+	{
+		unsigned long long t = (remainder << 32) | m_limbs[i];
+		m_limbs[i] = (uint32_t)(t / divisor);
+		remainder = t % divisor;
+	}
+}
+
+/** Compares two magnitudes of the same length, returns -1, 0 or 1*/
+int BigFixed::compareMagnitude(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b)
+{
+	for (size_t i = a.size(); i-- > 0;)
+	{
+		if (a[i] != b[i])
+		{
+			return a[i] < b[i] ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+/** Adds or subtracts b by adding or subtracting magnitudes*/
+BigFixed BigFixed::addSigned(const BigFixed& a, const BigFixed& b, bool negateB)
+{
+	int fractionLimbs = std::max(a.getFractionLimbs(), b.getFractionLimbs());
+	std::vector<uint32_t> x = a.widen(fractionLimbs);
+	std::vector<uint32_t> y = b.widen(fractionLimbs);
+	bool bNegative = b.m_negative != negateB;
+
+	BigFixed r;
+	r.m_limbs.assign(fractionLimbs + 1, 0);
+
+	if (a.m_negative == bNegative)
+	{
+		unsigned long long carry = 0;
+		for (int i = 0; i <= fractionLimbs; ++i)
+		{
+			unsigned long long t = (unsigned long long)x[i] + y[i] + carry;
+			r.m_limbs[i] = (uint32_t)t;
+			carry = t >> 32;
+		}
+		r.m_negative = a.m_negative;
+	}
+	else
+	{
+		//Takes the smaller magnitude from the larger
+		bool swap = compareMagnitude(x, y) < 0;
+		const std::vector<uint32_t>& big = swap ? y : x;
+		const std::vector<uint32_t>& small = swap ? x : y;
+
+		long long borrow = 0;
+		for (int i = 0; i <= fractionLimbs; ++i)
+		{
+			long long t = (long long)big[i] - small[i] - borrow;
+			borrow = t < 0 ? 1 : 0;
+			r.m_limbs[i] = (uint32_t)(t + (borrow << 32));
+		}
+		r.m_negative = swap ? bNegative : a.m_negative;
+	}
+
+	r.m_negative = r.m_negative && !r.isZero();
+	return r;
+}
+
+BigFixed operator+(const BigFixed& a, const BigFixed& b)
+{
+	return BigFixed::addSigned(a, b, false);
+}
+
+BigFixed operator-(const BigFixed& a)
+{
+	BigFixed r = a;
+	r.m_negative = !a.m_negative && !a.isZero();
+	return r;
+}
+
+BigFixed operator-(const BigFixed& a, const BigFixed& b)
+{
+	return BigFixed::addSigned(a, b, true);
+}
+
+/** Schoolbook product, truncated to the finer of the two precisions*/
+BigFixed operator*(const BigFixed& a, const BigFixed& b)
+{
+	int aLimbs = a.getFractionLimbs();
+	int bLimbs = b.getFractionLimbs();
+	int fractionLimbs = std::max(aLimbs, bLimbs);
+
+	std::vector<uint32_t> product(aLimbs + bLimbs + 2, 0);
+	for (int i = 0; i <= aLimbs; ++i)
+	{
+		if (a.m_limbs[i] == 0)
+		{
+			continue;
+		}
+
+		unsigned long long carry = 0;
+		for (int j = 0; j <= bLimbs; ++j)
+		{
+			unsigned long long t = (unsigned long long)a.m_limbs[i] * b.m_limbs[j] + product[i + j] + carry;
+			product[i + j] = (uint32_t)t;
+			carry = t >> 32;
+		}
+		product[i + bLimbs + 1] = (uint32_t)carry;
+	}
+
+	//The product has aLimbs + bLimbs fraction limbs
+	BigFixed r;
+	r.m_limbs.assign(product.begin() + (aLimbs + bLimbs - fractionLimbs), product.begin() + (aLimbs + bLimbs + 1));
+	r.m_negative = (a.m_negative != b.m_negative) && !r.isZero();
+	return r;
+}
+
+/** Divides by multiplying by the reciprocal, which is only good to a
+	double's precision but is plenty for scaling a view*/
+BigFixed operator/(const BigFixed& a, double d)
+{
+	return a * BigFixed(1.0 / d, a.getFractionLimbs());
+}
+
+bool operator<(const BigFixed& a, const BigFixed& b)
+{
+	return (a - b).m_negative;
+}
+
+bool operator>(const BigFixed& a, const BigFixed& b)
+{
+	return b < a;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "DoubleDouble.h"
+#include "FloatExp.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+//Signed fixed point number with one 32 bit whole limb and any number of
+//32 bit fraction limbs. Holds view coordinates to as many digits as the
+//zoom needs and iterates the perturbation reference orbit. The result of
+//an operation keeps the finer precision of its two operands
+class BigFixed
+{
+
+public:
+	BigFixed();
+	BigFixed(double d);
+	BigFixed(double d, int fractionLimbs);
+	BigFixed(const FloatExp& f, int fractionLimbs);
+	explicit BigFixed(const std::string& text);
+
+	double toDouble() const;
+	DoubleDouble toDoubleDouble() const;
+	FloatExp toFloatExp() const;
+	std::string toString(int digits) const;
+
+	int getFractionLimbs() const { return (int)m_limbs.size() - 1; };
+	void setFractionLimbs(int fractionLimbs);
+	bool isNegative() const { return m_negative; };
+	bool isZero() const;
+
+	static int limbsForBits(int bits);
+	static bool check(std::string& report);
+
+	friend BigFixed operator+(const BigFixed& a, const BigFixed& b);
+	friend BigFixed operator-(const BigFixed& a);
+	friend BigFixed operator-(const BigFixed& a, const BigFixed& b);
+	friend BigFixed operator*(const BigFixed& a, const BigFixed& b);
+	friend BigFixed operator/(const BigFixed& a, double d);
+	friend bool operator<(const BigFixed& a, const BigFixed& b);
+	friend bool operator>(const BigFixed& a, const BigFixed& b);
+
+private:
+	std::vector<uint32_t> widen(int fractionLimbs) const;
+	void multiplySmall(uint32_t factor);
+	void divideSmall(uint32_t divisor);
+
+	static int compareMagnitude(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b);
+	static BigFixed addSigned(const BigFixed& a, const BigFixed& b, bool negateB);
+
+	//Least significant fraction limb first, whole limb last
+	std::vector<uint32_t> m_limbs;
+	bool m_negative;
+
+};
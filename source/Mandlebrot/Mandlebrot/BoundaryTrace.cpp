@@ -0,0 +1,284 @@
+#include "BoundaryTrace.h"
+#include <algorithm>
+
+//Columns in each strip the view is traced in
+static const int stripWidth = 64;
+
+//Share of its pixels a strip's trace may work out before the rest of the
+//strip is worked out as rows instead. Edges that busy leave little to
+//fill, and the kernel runs rows faster than the same pixels scattered
+static const double busyShare = 0.75;
+
+//Pixel flags, worked out (or about to be) and queued for a scan
+static const char pixelComputed = 1;
+static const char pixelQueued = 2;
+
+BoundaryTrace::BoundaryTrace()
+{
+	m_height = 0;
+	m_skipped = 0.0;
+}
+
+BoundaryTrace::~BoundaryTrace()
+{
+}
+
+/** Traces every strip of the view in waves. Each wave works out the
+	queued pixels and their neighbours in one go, so the kernel gets full
+	vectors, then scans the queued pixels of every strip in parallel for
+	edges, which queues the next wave. Whatever is left is filled*/
+void BoundaryTrace::render(PixelRenderer& pixels, int threads)
+{
+	const int width = pixels.getWidth();
+	const int height = pixels.getHeight();
+	const int strips = (width + stripWidth - 1) / stripWidth;
+
+	m_height = height;
+	m_flags.assign(width * height, 0);
+
+	//Starts from the border of every strip
+	std::vector< std::vector<int> > queues(strips), next(strips);
+	for (int strip = 0; strip < strips; ++strip)
+	{
+		int left = strip * stripWidth;
+		int right = std::min(left + stripWidth, width) - 1;
+		for (int y = 0; y < height; ++y)
+		{
+			queue(left * height + y, queues[strip]);
+			queue(right * height + y, queues[strip]);
+		}
+		for (int x = left + 1; x < right; ++x)
+		{
+			queue(x * height, queues[strip]);
+			queue(x * height + height - 1, queues[strip]);
+		}
+	}
+
+	std::vector<int> xs, ys;
+	std::vector<int> computed(strips, 0);
+	std::vector<int> busy;
+	while (true)
+	{
+		//Gathers the queued pixels and their neighbours in the strip that
+		//are not worked out yet
+		xs.clear();
+		ys.clear();
+		busy.clear();
+		bool queued = false;
+		for (int strip = 0; strip < strips; ++strip)
+		{
+			int left = strip * stripWidth;
+			int right = std::min(left + stripWidth, width) - 1;
+			size_t gathered = xs.size();
+			for (int pixel : queues[strip])
+			{
+				queued = true;
+				int x = pixel / height;
+				int y = pixel % height;
+				int around[5][2] = { { x, y }, { x - 1, y }, { x + 1, y }, { x, y - 1 }, { x, y + 1 } };
+				for (int i = 0; i < 5; ++i)
+				{
+					int nx = around[i][0];
+					int ny = around[i][1];
+					if (nx < left || nx > right || ny < 0 || ny >= height || (m_flags[nx * height + ny] & pixelComputed))
+					{
+						continue;
+					}
+					m_flags[nx * height + ny] |= pixelComputed;
+					xs.push_back(nx);
+					ys.push_back(ny);
+				}
+			}
+
+			//A strip this busy stops tracing, and is worked out as rows
+			computed[strip] += (int)(xs.size() - gathered);
+			if (!queues[strip].empty() && computed[strip] > busyShare * (right - left + 1) * height)
+			{
+				busy.push_back(strip);
+				queues[strip].clear();
+			}
+		}
+
+		if (!queued || pixels.isCancelled())
+		{
+			break;
+		}
+
+		pixels.computePoints(xs.data(), ys.data(), (int)xs.size(), threads);
+
+		//Strips only ever flag their own pixels
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+		for (int strip = 0; strip < strips; ++strip)
+		{
+			int left = strip * stripWidth;
+			int right = std::min(left + stripWidth, width) - 1;
+			next[strip].clear();
+			for (int pixel : queues[strip])
+			{
+				scan(pixels, pixel, left, right, next[strip]);
+			}
+		}
+		queues.swap(next);
+
+		//Each gap in a row of a busy strip is one line
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+		for (int i = 0; i < (int)busy.size(); ++i)
+		{
+			int left = busy[i] * stripWidth;
+			int right = std::min(left + stripWidth, width) - 1;
+			for (int y = 0; y < height; ++y)
+			{
+				for (int x = left; x <= right; ++x)
+				{
+					int start = x;
+					while (x <= right && !(m_flags[x * height + y] & pixelComputed))
+					{
+						m_flags[x * height + y] |= pixelComputed;
+						++x;
+					}
+					pixels.computeLine(start, y, x - start, false);
+				}
+			}
+		}
+	}
+
+	int filled = 0;
+
+#pragma omp parallel for schedule(dynamic) num_threads(threads) reduction(+:filled)
+	for (int strip = 0; strip < strips; ++strip)
+	{
+		int left = strip * stripWidth;
+		filled += fillStrip(pixels, left, std::min(left + stripWidth, width) - 1);
+	}
+
+	m_skipped = filled / (double)(width * height);
+}
+
+/** Looks for edges around a worked out pixel whose neighbours are worked
+	out too, and queues the neighbours across any edge so it is followed*/
+void BoundaryTrace::scan(PixelRenderer& pixels, int pixel, int left, int right, std::vector<int>& queue)
+{
+	const int x = pixel / m_height;
+	const int y = pixel % m_height;
+	const long long band = pixels.getBand(x, y);
+
+	bool hasLeft = x > left;
+	bool hasRight = x < right;
+	bool hasUp = y > 0;
+	bool hasDown = y < m_height - 1;
+
+	bool l = hasLeft && differs(pixels, x, y, band, x - 1, y);
+	bool r = hasRight && differs(pixels, x, y, band, x + 1, y);
+	bool u = hasUp && differs(pixels, x, y, band, x, y - 1);
+	bool d = hasDown && differs(pixels, x, y, band, x, y + 1);
+
+	if (l)
+	{
+		this->queue(pixel - m_height, queue);
+	}
+	if (r)
+	{
+		this->queue(pixel + m_height, queue);
+	}
+	if (u)
+	{
+		this->queue(pixel - 1, queue);
+	}
+	if (d)
+	{
+		this->queue(pixel + 1, queue);
+	}
+
+	//Diagonals keep edges that turn a corner closed
+	if (hasUp && hasLeft && (l || u))
+	{
+		this->queue(pixel - m_height - 1, queue);
+	}
+	if (hasUp && hasRight && (r || u))
+	{
+		this->queue(pixel + m_height - 1, queue);
+	}
+	if (hasDown && hasLeft && (l || d))
+	{
+		this->queue(pixel - m_height + 1, queue);
+	}
+	if (hasDown && hasRight && (r || d))
+	{
+		this->queue(pixel + m_height + 1, queue);
+	}
+}
+
+/** Queues a pixel for the next scan unless it has been already*/
+void BoundaryTrace::queue(int pixel, std::vector<int>& queue)
+{
+	if (!(m_flags[pixel] & pixelQueued))
+	{
+		m_flags[pixel] |= pixelQueued;
+		queue.push_back(pixel);
+	}
+}
+
+/** Returns true if there is an edge between two worked out pixels.
+	Glitched pixels are not trusted, so are always edged round*/
+bool BoundaryTrace::differs(PixelRenderer& pixels, int x, int y, long long band, int otherX, int otherY)
+{
+	return !pixels.isTrusted(x, y) || !pixels.isTrusted(otherX, otherY) || pixels.getBand(otherX, otherY) != band;
+}
+
+/** Fills the pixels of a strip that were never worked out. Every gap in a
+	row lies between two worked out pixels of the same band, since the
+	edges round it were traced. Inside the set is filled as is, and an
+	escaped band is blended along the row so the smooth colouring carries
+	on across the gap. Returns the number of pixels filled*/
+int BoundaryTrace::fillStrip(PixelRenderer& pixels, int left, int right)
+{
+	const long long maxIterations = pixels.getMaxIterations();
+	int filled = 0;
+
+	//Left unstarted, so a higher limit works them out properly
+	PixelState inside;
+
+	PixelState escaped;
+	escaped.status = PixelStatus::Escaped;
+
+	for (int y = 0; y < m_height; ++y)
+	{
+		int x = left;
+		while (x <= right)
+		{
+			if (m_flags[x * m_height + y] & pixelComputed)
+			{
+				++x;
+				continue;
+			}
+
+			//The strip border is always worked out, so both ends exist
+			int start = x - 1;
+			int end = x;
+			while (!(m_flags[end * m_height + y] & pixelComputed))
+			{
+				++end;
+			}
+
+			long long band = pixels.getBand(start, y);
+			double from = pixels.getMu(start, y);
+			double to = pixels.getBand(end, y) == band ? pixels.getMu(end, y) : from;
+			escaped.iterations = band;
+			for (int i = start + 1; i < end; ++i)
+			{
+				if (band == maxIterations)
+				{
+					pixels.fill(i, y, inside);
+					continue;
+				}
+				double t = (i - start) / (double)(end - start);
+				escaped.mu = (1.0 - t) * from + t * to;
+				pixels.fill(i, y, escaped);
+			}
+			filled += end - start - 1;
+			x = end + 1;
+		}
+	}
+
+	return filled;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "PixelRenderer.h"
+#include <vector>
+
+//Boundary tracing rendering. Starting from the edges of the view, the
+//pixels either side of every edge between iteration bands are worked
+//out, following each edge round until it closes. Since the set is
+//connected, whatever the traced edges enclose is in one band and is
+//filled row by row, so the work grows with the length of the edges
+//rather than the area. The view is traced in strips of columns that
+//each have their own edges, so the strips are independent. A strip
+//whose trace has worked out most of it already is finished as rows
+class BoundaryTrace
+{
+
+public:
+	BoundaryTrace();
+	~BoundaryTrace();
+
+	void render(PixelRenderer& pixels, int threads);
+
+	double getSkipped() { return m_skipped; };
+
+private:
+	void scan(PixelRenderer& pixels, int pixel, int left, int right, std::vector<int>& queue);
+	void queue(int pixel, std::vector<int>& queue);
+	bool differs(PixelRenderer& pixels, int x, int y, long long band, int otherX, int otherY);
+	int fillStrip(PixelRenderer& pixels, int left, int right);
+
+	//Per pixel flags for the render, indexed x * height + y
+	std::vector<char> m_flags;
+	int m_height;
+
+	//Share of the pixels in the last render that were filled
+	double m_skipped;
+
+};
@@ -0,0 +1,236 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+//A fixed size queue any number of threads may push to and pop from
+//without locks. Every cell carries a sequence number saying whose turn it
+//is, so a push or pop is one compare and swap of a position and one store,
+//and a full or empty queue is found out rather than waited on. Keeps count
+//of how full it has been for the stages either side of it
+template <class T>
+class BoundedQueue
+{
+
+public:
+	/** Makes room for capacity items, rounded up to a power of two*/
+	BoundedQueue(size_t capacity)
+	{
+		m_capacity = 1;
+		while (m_capacity < capacity)
+		{
+			m_capacity *= 2;
+		}
+		m_cells.reset(new Cell[m_capacity]);
+		for (size_t i = 0; i < m_capacity; ++i)
+		{
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		m_head = 0;
+		m_tail = 0;
+		resetStats();
+	}
+
+	/** Adds an item at the back. Returns false and counts a stall if the
+		queue is full*/
+	bool push(const T& item)
+	{
+		size_t position = m_tail.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = m_cells[position & (m_capacity - 1)];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)position;
+			if (difference == 0)
+			{
+				if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					cell.item = item;
+					cell.sequence.store(position + 1, std::memory_order_release);
+					break;
+				}
+			}
+			else if (difference < 0)
+			{
+				m_stalls.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			else
+			{
+				position = m_tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		//Occupancy as this push left it, near enough with others at work
+		m_pushes.fetch_add(1, std::memory_order_relaxed);
+		size_t size = getSize();
+		size_t peak = m_peak.load(std::memory_order_relaxed);
+		while (size > peak && !m_peak.compare_exchange_weak(peak, size, std::memory_order_relaxed))
+		{
+		}
+		return true;
+	}
+
+	/** Takes the item at the front. Returns false if the queue is empty*/
+	bool pop(T& item)
+	{
+		size_t position = m_head.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = m_cells[position & (m_capacity - 1)];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)(position + 1);
+			if (difference == 0)
+			{
+				if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					item = cell.item;
+					cell.sequence.store(position + m_capacity, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				position = m_head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/** Returns the number of items waiting, which may be out of date by
+		the time it is used*/
+	size_t getSize()
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		size_t head = m_head.load(std::memory_order_relaxed);
+		return tail > head ? tail - head : 0;
+	}
+
+	size_t getCapacity() { return m_capacity; };
+	size_t getPeak() { return m_peak.load(std::memory_order_relaxed); };
+	size_t getPushes() { return m_pushes.load(std::memory_order_relaxed); };
+	size_t getStalls() { return m_stalls.load(std::memory_order_relaxed); };
+
+	/** Starts the occupancy counts again*/
+	void resetStats()
+	{
+		m_peak = 0;
+		m_pushes = 0;
+		m_stalls = 0;
+	}
+
+private:
+	//An item, and whose turn the cell is: position to push to it,
+	//position + 1 to pop from it
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T item;
+	};
+
+	std::unique_ptr<Cell[]> m_cells;
+	size_t m_capacity;
+
+	//Next positions to pop and push
+	std::atomic<size_t> m_head;
+	std::atomic<size_t> m_tail;
+
+	//Most items ever waiting, items pushed, and pushes turned away full
+	std::atomic<size_t> m_peak;
+	std::atomic<size_t> m_pushes;
+	std::atomic<size_t> m_stalls;
+
+};
+
+/** Checks that a queue rounds its capacity up, gives items back in the
+	order they went in, turns pushes away full and pops away empty, and
+	that every item pushed by several threads at once is popped by the
+	threads on the other side exactly once. Adds a line to report for each
+	that fails. Returns true if all pass*/
+inline bool checkBoundedQueue(std::string& report)
+{
+	bool passed = true;
+	auto fail = [&](const std::string& what)
+	{
+		report += "BoundedQueue: " + what + "\n";
+		passed = false;
+	};
+
+	BoundedQueue<size_t> queue(5);
+	size_t item = 0;
+	bool inOrder = queue.getCapacity() == 8;
+	for (size_t i = 0; i < 8; ++i)
+	{
+		inOrder = queue.push(i) && inOrder;
+	}
+	bool turnedAway = !queue.push(8) && queue.getStalls() == 1 && queue.getPeak() == 8;
+	for (size_t i = 0; i < 8; ++i)
+	{
+		inOrder = queue.pop(item) && item == i && inOrder;
+	}
+	if (!inOrder || !turnedAway || queue.pop(item))
+	{
+		fail("a queue of 5 rounded to 8 does not fill, turn away and empty in order");
+	}
+
+	//Items 1 to each producer's share, counted off by the consumers
+	const int producers = 3;
+	const size_t share = 20000;
+	const size_t total = producers * share;
+	std::vector<std::atomic<int>> seen(total + 1);
+	for (std::atomic<int>& count : seen)
+	{
+		count = 0;
+	}
+	std::atomic<size_t> popped(0);
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; ++p)
+	{
+		threads.emplace_back([&queue, p, share]()
+		{
+			for (size_t i = 1; i <= share; ++i)
+			{
+				while (!queue.push(p * share + i))
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+		threads.emplace_back([&queue, &seen, &popped, total]()
+		{
+			size_t value;
+			while (popped.load() < total)
+			{
+				if (queue.pop(value))
+				{
+					seen[value].fetch_add(1);
+					popped.fetch_add(1);
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	int wrong = 0;
+	for (size_t i = 1; i < seen.size(); ++i)
+	{
+		wrong += seen[i].load() != 1 ? 1 : 0;
+	}
+	if (wrong > 0)
+	{
+		fail(std::to_string(wrong) + " items pushed by " + std::to_string(producers) + " threads at once were not popped exactly once");
+	}
+	return passed;
+}
@@ -2,7 +2,8 @@
 #define MYLIB_CONSTANTS_H 1
 
 //Program constants
-static const int iterationsCap = 2000;
+//Highest iteration limit unless --iterations-cap gives another
+static const long long defaultIterationsCap = 10000000;
 static const int VIEW_HEIGHT = 535;
 static const int VIEW_WIDTH = 1075;
 
@@ -0,0 +1,108 @@
+#include "CostMap.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+//One pixel of every probeStep x probeStep block is probed, on the grid of
+//the first progressive pass so it leaves that pass less to do
+static const int probeStep = 8;
+
+//Cost per pixel a tile is clipped to, in multiples of the median tile's.
+//A tile probed while its thread was held up, or first on a cold thread,
+//otherwise looks many times dearer than it is
+static const double outlierCost = 8.0;
+
+//Spread of the tiles' costs per pixel, as standard deviation over mean,
+//below which splitting by cost balanced worse than by count. The probe's
+//scattered pixels slow some tiles more than others by about this much
+static const double unevenSpread = 0.5;
+
+CostMap::CostMap()
+{
+	m_totalCost = 0.0;
+	m_probeCost = 0.0;
+	m_probeTime = 0.0;
+	m_uneven = false;
+}
+
+CostMap::~CostMap()
+{
+}
+
+/** Works out the probe pixels of every tile on the pool and predicts each
+	tile's cost as the time its probe pixels took, per pixel, times its
+	size. Iteration counts would be a poorer guide, pixels the periodicity
+	check settles show the full limit for a fraction of the work. Pixels
+	finished by an earlier render of the view cost next to nothing. The
+	costs are only handed out if they differ enough to be worth it*/
+void CostMap::probe(PixelRenderer& pixels, ThreadPool& pool, int threads)
+{
+	const int width = pixels.getWidth();
+	const int height = pixels.getHeight();
+	const int tiles = ThreadPool::countTiles(width, height);
+	m_tileCosts.assign(tiles, 0.0);
+	m_probeCosts.assign(tiles, 0.0);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	pool.run(tiles, threads, [this, &pixels, width, height](int index)
+	{
+		//Tiles thinner than a block still get a row or column of probes
+		FrameTile tile = ThreadPool::getTile(index, width, height);
+		std::vector<int> xs, ys;
+		for (int y = tile.top + std::min(probeStep / 2, (tile.bottom - tile.top) / 2); y < tile.bottom; y += probeStep)
+		{
+			for (int x = tile.left + std::min(probeStep / 2, (tile.right - tile.left) / 2); x < tile.right; x += probeStep)
+			{
+				xs.push_back(x);
+				ys.push_back(y);
+			}
+		}
+
+		//Already on one of the pool's threads
+		const int count = (int)xs.size();
+		std::chrono::steady_clock::time_point begun = std::chrono::steady_clock::now();
+		pixels.computePoints(xs.data(), ys.data(), count, 1);
+		double cost = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begun).count();
+		m_probeCosts[index] = cost;
+		m_tileCosts[index] = cost * (tile.right - tile.left) * (tile.bottom - tile.top) / count;
+	});
+	m_probeTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	//Clips the outliers, then measures how far the rest spread
+	std::vector<double> perPixel(tiles);
+	for (int i = 0; i < tiles; ++i)
+	{
+		FrameTile tile = ThreadPool::getTile(i, width, height);
+		perPixel[i] = m_tileCosts[i] / ((tile.right - tile.left) * (tile.bottom - tile.top));
+	}
+	std::vector<double> sorted = perPixel;
+	std::nth_element(sorted.begin(), sorted.begin() + tiles / 2, sorted.end());
+	const double limit = sorted[tiles / 2] * outlierCost;
+
+	m_totalCost = 0.0;
+	m_probeCost = 0.0;
+	double sum = 0.0;
+	double squares = 0.0;
+	for (int i = 0; i < tiles; ++i)
+	{
+		if (perPixel[i] > limit)
+		{
+			m_tileCosts[i] *= limit / perPixel[i];
+			perPixel[i] = limit;
+		}
+		m_totalCost += m_tileCosts[i];
+		m_probeCost += m_probeCosts[i];
+		sum += perPixel[i];
+		squares += perPixel[i] * perPixel[i];
+	}
+	double mean = sum / tiles;
+	m_uneven = mean > 0.0 && std::sqrt(std::max(0.0, squares / tiles - mean * mean)) >= unevenSpread * mean;
+}
+
+/** Returns the milliseconds the pixels left after the probe should take,
+	at the rate the probe got through its own. Scattered pixels go slower
+	than whole rows, so this wants scaling by how far off it has been*/
+double CostMap::predictRemaining()
+{
+	return m_probeCost > 0.0 ? m_probeTime * (m_totalCost - m_probeCost) / m_probeCost : 0.0;
+}
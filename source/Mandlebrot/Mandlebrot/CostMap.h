@@ -0,0 +1,42 @@
+#pragma once
+#include "PixelRenderer.h"
+#include "ThreadPool.h"
+#include <vector>
+
+//Predicted cost of every tile of a view, from a probe of one pixel in
+//every 8 x 8 block. Iteration counts can differ a millionfold across a
+//view, so the probe gives the pool tiles of equal cost to start each
+//thread with and the render an idea of how long it will take. The probe
+//works out real pixels of the frame, which the render then skips, so it
+//costs next to nothing beyond its pixels being scattered
+class CostMap
+{
+
+public:
+	CostMap();
+	~CostMap();
+
+	void probe(PixelRenderer& pixels, ThreadPool& pool, int threads);
+	double predictRemaining();
+
+	/** Returns the predicted cost of every tile, in microseconds at the
+		speed of the probe, or null if the tiles cost too much alike for
+		the probe to split them better than by count*/
+	const double* getTileCosts() { return m_uneven ? m_tileCosts.data() : nullptr; };
+	double getTotalCost() { return m_totalCost; };
+	double getProbeTime() { return m_probeTime; };
+
+private:
+	//Microseconds every tile and its probe pixels alone should take
+	std::vector<double> m_tileCosts;
+	std::vector<double> m_probeCosts;
+	double m_totalCost;
+	double m_probeCost;
+
+	//Whether the tiles' costs differ by more than the probe's own noise
+	bool m_uneven;
+
+	//Milliseconds the probe took
+	double m_probeTime;
+
+};
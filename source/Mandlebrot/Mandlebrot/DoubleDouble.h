@@ -0,0 +1,104 @@
+#pragma once
+#include <cmath>
+
+//Unevaluated sum of two doubles, hi + lo, good for about 32 significant
+//digits. Used for view coordinates and the deepest precision tier
+struct DoubleDouble
+{
+	double hi, lo;
+
+	DoubleDouble() : hi(0.0), lo(0.0) {};
+	DoubleDouble(double h) : hi(h), lo(0.0) {};
+	DoubleDouble(double h, double l) : hi(h), lo(l) {};
+
+	double toDouble() const { return hi + lo; };
+	long double toLongDouble() const { return (long double)hi + (long double)lo; };
+};
+
+/** Exact sum of two doubles as hi + lo*/
+inline DoubleDouble twoSum(double a, double b)
+{
+	double s = a + b;
+	double v = s - a;
+	double e = (a - (s - v)) + (b - v);
+	return DoubleDouble(s, e);
+}
+
+/** Exact sum when |a| >= |b|*/
+inline DoubleDouble quickTwoSum(double a, double b)
+{
+	double s = a + b;
+	double e = b - (s - a);
+	return DoubleDouble(s, e);
+}
+
+/** Exact product of two doubles as hi + lo*/
+inline DoubleDouble twoProd(double a, double b)
+{
+	double p = a * b;
+#if defined(FP_FAST_FMA)
+	return DoubleDouble(p, std::fma(a, b, -p));
+#else
+	//Dekker's split into two 26 bit halves
+	const double splitter = 134217729.0;
+	double t = splitter * a;
+	double ahi = t - (t - a);
+	double alo = a - ahi;
+	t = splitter * b;
+	double bhi = t - (t - b);
+	double blo = b - bhi;
+	double e = ((ahi * bhi - p) + ahi * blo + alo * bhi) + alo * blo;
+	return DoubleDouble(p, e);
+#endif
+}
+
+inline DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b)
+{
+	DoubleDouble s = twoSum(a.hi, b.hi);
+	DoubleDouble t = twoSum(a.lo, b.lo);
+	s = quickTwoSum(s.hi, s.lo + t.hi);
+	return quickTwoSum(s.hi, s.lo + t.lo);
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a)
+{
+	return DoubleDouble(-a.hi, -a.lo);
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b)
+{
+	return a + (-b);
+}
+
+inline DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b)
+{
+	DoubleDouble p = twoProd(a.hi, b.hi);
+	return quickTwoSum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
+}
+
+inline DoubleDouble operator/(const DoubleDouble& a, const DoubleDouble& b)
+{
+	//Long division, one correction step
+	double q1 = a.hi / b.hi;
+	DoubleDouble r = a - b * DoubleDouble(q1);
+	double q2 = r.hi / b.hi;
+	r = r - b * DoubleDouble(q2);
+	double q3 = r.hi / b.hi;
+	DoubleDouble q = quickTwoSum(q1, q2);
+	return q + DoubleDouble(q3);
+}
+
+inline bool operator<(const DoubleDouble& a, const DoubleDouble& b)
+{
+	return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+inline bool operator>(const DoubleDouble& a, const DoubleDouble& b)
+{
+	return b < a;
+}
+
+inline DoubleDouble abs(const DoubleDouble& a)
+{
+	return a.hi < 0.0 ? -a : a;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <cmath>
+
+//A double mantissa with its own int exponent, m * 2^e with 0.5 <= |m| < 1.
+//Slower than a double but never underflows, so perturbation deltas keep
+//working past the 1e-308 floor of a double
+struct FloatExp
+{
+	double m;
+	int e;
+
+	FloatExp() : m(0.0), e(0) {};
+	FloatExp(double d) { m = std::frexp(d, &e); };
+	FloatExp(double mantissa, int exponent) { m = std::frexp(mantissa, &e); e += exponent; };
+
+	double toDouble() const { return std::ldexp(m, e); };
+};
+
+inline FloatExp operator*(const FloatExp& a, const FloatExp& b)
+{
+	FloatExp r;
+	r.m = a.m * b.m;
+	r.e = a.e + b.e;
+
+	//The product of two mantissas is at least a quarter
+	if (r.m == 0.0)
+	{
+		r.e = 0;
+	}
+	else if (std::abs(r.m) < 0.5)
+	{
+		r.m *= 2.0;
+		r.e -= 1;
+	}
+	return r;
+}
+
+inline FloatExp operator+(const FloatExp& a, const FloatExp& b)
+{
+	if (a.m == 0.0)
+	{
+		return b;
+	}
+	if (b.m == 0.0)
+	{
+		return a;
+	}
+
+	//Anything more than 64 binary places down is lost in the rounding
+	int shift = a.e - b.e;
+	if (shift > 64)
+	{
+		return a;
+	}
+	if (shift < -64)
+	{
+		return b;
+	}
+	if (shift >= 0)
+	{
+		return FloatExp(a.m + std::ldexp(b.m, -shift), a.e);
+	}
+	return FloatExp(std::ldexp(a.m, shift) + b.m, b.e);
+}
+
+inline FloatExp operator-(const FloatExp& a)
+{
+	FloatExp r;
+	r.m = -a.m;
+	r.e = a.e;
+	return r;
+}
+
+inline FloatExp operator-(const FloatExp& a, const FloatExp& b)
+{
+	return a + (-b);
+}
+
+inline bool operator<(const FloatExp& a, const FloatExp& b)
+{
+	return (a - b).m < 0.0;
+}
+
+inline bool operator>(const FloatExp& a, const FloatExp& b)
+{
+	return b < a;
+}
+
+inline FloatExp operator/(const FloatExp& a, const FloatExp& b)
+{
+	return FloatExp(a.m / b.m, a.e - b.e);
+}
+
+inline FloatExp sqrt(const FloatExp& a)
+{
+	//Halves an even exponent so the mantissa keeps its range
+	int odd = a.e & 1;
+	return FloatExp(std::sqrt(std::ldexp(a.m, odd)), (a.e - odd) / 2);
+}
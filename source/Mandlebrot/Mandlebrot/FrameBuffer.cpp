@@ -0,0 +1,118 @@
+#include "FrameBuffer.h"
+#include <algorithm>
+#include <memory>
+
+//Planes start on a cache line
+static const size_t frameAlignment = 64;
+
+FrameBuffer::FrameBuffer()
+{
+	m_width = 0;
+	m_height = 0;
+	m_iterations = nullptr;
+	m_fractions = nullptr;
+	m_rgba = nullptr;
+	m_slots = nullptr;
+	m_states = nullptr;
+}
+
+FrameBuffer::~FrameBuffer()
+{
+}
+
+/** Allocates the planes for a width x height frame. Colours start black.
+	The frame keeps no pixel states until asked to*/
+void FrameBuffer::create(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+
+	//Room for every plane rounded up to a cache line, plus the slack to
+	//line up the first
+	size_t pixels = (size_t)width * height;
+	size_t bytes = frameAlignment;
+	size_t sizes[4] = { sizeof(uint32_t), sizeof(uint16_t), 4, sizeof(uint16_t) };
+	for (size_t size : sizes)
+	{
+		bytes += (pixels * size + frameAlignment - 1) / frameAlignment * frameAlignment;
+	}
+	m_memory.assign(bytes, 0);
+
+	size_t offset = 0;
+	m_iterations = carve<uint32_t>(m_memory, offset, pixels);
+	m_fractions = carve<uint16_t>(m_memory, offset, pixels);
+	m_rgba = carve<uint8_t>(m_memory, offset, pixels * 4);
+	m_slots = carve<uint16_t>(m_memory, offset, pixels);
+
+	for (size_t i = 0; i < pixels; ++i)
+	{
+		m_rgba[i * 4 + 3] = 255;
+	}
+	keepStates(false);
+}
+
+/** Gives the frame a state for every pixel, each unstarted, so a render
+	into it can be carried on from. Or frees them, and renders into it
+	keep none*/
+void FrameBuffer::keepStates(bool keep)
+{
+	if (!keep)
+	{
+		std::vector<uint8_t>().swap(m_stateMemory);
+		m_states = nullptr;
+		return;
+	}
+	if (m_states)
+	{
+		return;
+	}
+	size_t pixels = (size_t)m_width * m_height;
+	m_stateMemory.resize(frameAlignment + pixels * sizeof(PixelState));
+	size_t offset = 0;
+	m_states = carve<PixelState>(m_stateMemory, offset, pixels);
+	std::uninitialized_fill(m_states, m_states + pixels, PixelState());
+}
+
+/** Starts every pixel from scratch*/
+void FrameBuffer::resetStates()
+{
+	if (m_states)
+	{
+		std::fill(m_states, m_states + (size_t)m_width * m_height, PixelState());
+	}
+}
+
+/** Takes the pixel states of a frame the same size, so a render into this
+	one carries on from where that one left each pixel. The source must
+	keep states*/
+void FrameBuffer::copyStates(FrameBuffer& source)
+{
+	keepStates(true);
+	std::copy(source.m_states, source.m_states + (size_t)m_width * m_height, m_states);
+}
+
+/** Trades every plane with another frame. Only the pointers move, so a
+	finished back buffer becomes the front in no time*/
+void FrameBuffer::swap(FrameBuffer& other)
+{
+	std::swap(m_width, other.m_width);
+	std::swap(m_height, other.m_height);
+	m_memory.swap(other.m_memory);
+	std::swap(m_iterations, other.m_iterations);
+	std::swap(m_fractions, other.m_fractions);
+	std::swap(m_rgba, other.m_rgba);
+	std::swap(m_slots, other.m_slots);
+	m_stateMemory.swap(other.m_stateMemory);
+	std::swap(m_states, other.m_states);
+}
+
+/** Returns the next cache line aligned plane of count elements in a block
+	of memory*/
+template <class T>
+T* FrameBuffer::carve(std::vector<uint8_t>& memory, size_t& offset, size_t count)
+{
+	uintptr_t base = (uintptr_t)memory.data();
+	uintptr_t start = (base + offset + frameAlignment - 1) / frameAlignment * frameAlignment;
+	offset = start - base + count * sizeof(T);
+	return reinterpret_cast<T*>(start);
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "PixelState.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Largest stored fraction, standing for a whole iteration
+const double fractionSteps = 65535.0;
+
+//Everything kept per pixel for one frame, as separate row-major planes
+//in one allocation. Pixel (x, y) is element y * width + x of every plane
+//and each plane starts on a 64 byte boundary, so a row of any plane is
+//contiguous for the kernel and the colour plane can be handed straight
+//to the texture. The pixel states a render carries on from take five
+//times the rest together, so a frame only has them once asked to keep
+//them and renders into frames without any keep none.
+//
+//Mu is kept compact as the band, the iteration a pixel escaped on or the
+//limit, and a 16 bit fraction below it, mu = band - fraction / 65535. An
+//escaped pixel's mu is always within one of its band, so the only loss is
+//rounding to within 1 / 131070 of an iteration
+class FrameBuffer
+{
+
+public:
+	FrameBuffer();
+	~FrameBuffer();
+
+	void create(int width, int height);
+	void keepStates(bool keep);
+	void resetStates();
+	void copyStates(FrameBuffer& source);
+	void swap(FrameBuffer& other);
+
+	int getWidth() { return m_width; };
+	int getHeight() { return m_height; };
+	size_t getBytes() { return m_memory.size() + m_stateMemory.size(); };
+
+	//Iteration a pixel escaped on, or the limit if it has not
+	uint32_t* getIterations() { return m_iterations; };
+
+	//How far below its band a pixel's mu is, in 1/65535ths
+	uint16_t* getFractions() { return m_fractions; };
+
+	/** Returns the smoothed iteration count of a pixel, the limit for
+		pixels inside the set*/
+	double getMu(size_t index) { return m_iterations[index] - m_fractions[index] * (1.0 / fractionSteps); };
+
+	/** Stores a pixel's band and mu. Mu outside the band's range, which
+		only filled pixels can have, is clamped to it*/
+	void setMu(size_t index, uint32_t band, double mu)
+	{
+		double fraction = (band - mu) * fractionSteps + 0.5;
+		m_iterations[index] = band;
+		m_fractions[index] = fraction <= 0.0 ? 0 : fraction >= fractionSteps ? (uint16_t)fractionSteps : (uint16_t)fraction;
+	};
+
+	//Colour as RGBA8, in the byte order a texture expects
+	uint8_t* getRgba() { return m_rgba; };
+
+	//Slot of the cycling palette each pixel takes its colour from
+	uint16_t* getSlots() { return m_slots; };
+
+	//Where each pixel got to, so a new limit can carry on from there, or
+	//null if the frame keeps no states
+	PixelState* getStates() { return m_states; };
+
+private:
+	template <class T>
+	static T* carve(std::vector<uint8_t>& memory, size_t& offset, size_t count);
+
+	int m_width, m_height;
+
+	//Backing store and the planes inside it, and the states' own, empty
+	//while the frame keeps none
+	std::vector<uint8_t> m_memory;
+	uint32_t* m_iterations;
+	uint16_t* m_fractions;
+	uint8_t* m_rgba;
+	uint16_t* m_slots;
+	std::vector<uint8_t> m_stateMemory;
+	PixelState* m_states;
+
+};
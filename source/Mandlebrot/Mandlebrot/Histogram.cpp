@@ -0,0 +1,157 @@
+#include "Histogram.h"
+#include <algorithm>
+
+Histogram::Histogram()
+{
+	m_parts = 0;
+	m_bins = 1;
+	m_scale = 0.0;
+	m_escaped = 0;
+	m_claimed = 0;
+	m_round = 0;
+	m_maxIterations = 1;
+	m_cdf.assign(2, 0.0f);
+}
+
+Histogram::~Histogram()
+{
+}
+
+//Counts begun so far, so a thread can tell whether it has claimed a part
+//of the count in progress
+static std::atomic<long long> rounds(0);
+
+/** Counts the escaped pixels of a frame by band on the pool. Each task
+	counts a band of rows into its own histogram, then the histograms are
+	merged*/
+void Histogram::count(ThreadPool& pool, int threads, const uint32_t* bands, int width, int height, uint32_t maxIterations)
+{
+	const int parts = std::max(1, std::min(threads, height));
+	begin(parts, maxIterations);
+	pool.run(parts, threads, [&](int part)
+	{
+		size_t first = (size_t)part * height / parts * width;
+		size_t last = (size_t)(part + 1) * height / parts * width;
+		add(bands + first, (int)(last - first), 1);
+	});
+	finish(pool, threads);
+}
+
+/** Starts a count up to a limit that at most threads threads add to at
+	once, such as the tasks of a render adding each tile as it is done*/
+void Histogram::begin(int threads, uint32_t maxIterations)
+{
+	m_maxIterations = std::max<uint32_t>(maxIterations, 1);
+	m_bins = (int)std::min<uint32_t>(m_maxIterations, histogramBins);
+	m_scale = m_bins / (double)m_maxIterations;
+	m_parts = std::max(1, threads);
+	m_counts.resize((size_t)m_parts * m_bins);
+	m_claimed = 0;
+	m_round = ++rounds;
+}
+
+/** Returns the histogram the calling thread counts into, claiming and
+	clearing a free one the first time it adds to this count*/
+int Histogram::claimPart()
+{
+	thread_local long long round = 0;
+	thread_local int part = 0;
+	if (round != m_round)
+	{
+		round = m_round;
+		part = m_claimed.fetch_add(1);
+		std::fill(m_counts.begin() + (size_t)part * m_bins, m_counts.begin() + (size_t)(part + 1) * m_bins, 0);
+	}
+	return part;
+}
+
+/** Counts some pixels of the frame weight times each, twice for rows that
+	are mirrored as well. Safe from as many threads at once as begin was
+	told*/
+void Histogram::add(const uint32_t* bands, int count, int weight)
+{
+	uint32_t* counts = &m_counts[(size_t)claimPart() * m_bins];
+	const uint32_t maxIterations = m_maxIterations;
+
+	//A band's mu lies within the iteration below it, which is its bin
+	//unless iterations share bins. The limit's bin takes the pixels
+	//inside and is left out of the totals
+	if (m_bins == (int)maxIterations)
+	{
+		uint32_t inside = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			(bands[i] < maxIterations ? counts[bands[i] - 1] : inside) += weight;
+		}
+	}
+	else
+	{
+		const int bins = m_bins;
+		const double scale = m_scale;
+		for (int i = 0; i < count; ++i)
+		{
+			if (bands[i] < maxIterations)
+			{
+				counts[std::min(bins - 1, (int)((bands[i] - 1) * scale))] += weight;
+			}
+		}
+	}
+}
+
+/** Merges the histograms of the threads that counted and turns the totals
+	into cumulative shares. Each task sums a slice of the bins across every
+	histogram into the first*/
+void Histogram::finish(ThreadPool& pool, int threads)
+{
+	const int bins = m_bins;
+	const int parts = m_claimed;
+	if (parts == 0)
+	{
+		std::fill(m_counts.begin(), m_counts.begin() + bins, 0);
+	}
+	pool.run(threads, threads, [&](int slice)
+	{
+		for (int bin = (int)((long long)slice * bins / threads); bin < (int)((long long)(slice + 1) * bins / threads); ++bin)
+		{
+			uint32_t total = m_counts[bin];
+			for (int other = 1; other < parts; ++other)
+			{
+				total += m_counts[(size_t)other * bins + bin];
+			}
+			m_counts[bin] = total;
+		}
+	});
+
+	long long escaped = 0;
+	for (int bin = 0; bin < bins; ++bin)
+	{
+		escaped += m_counts[bin];
+	}
+	m_escaped = (int)escaped;
+
+	m_cdf.resize(bins + 1);
+	double share = escaped > 0 ? 1.0 / escaped : 0.0;
+	long long running = 0;
+	for (int bin = 0; bin <= bins; ++bin)
+	{
+		m_cdf[bin] = (float)(running * share);
+		running += bin < bins ? m_counts[bin] : 0;
+	}
+}
+
+/** Trades counts with another histogram, so one counted by the render
+	thread can be taken over without a copy*/
+void Histogram::swap(Histogram& other)
+{
+	std::swap(m_counts, other.m_counts);
+	std::swap(m_parts, other.m_parts);
+	std::swap(m_round, other.m_round);
+	std::swap(m_maxIterations, other.m_maxIterations);
+	std::swap(m_cdf, other.m_cdf);
+	std::swap(m_bins, other.m_bins);
+	std::swap(m_scale, other.m_scale);
+	std::swap(m_escaped, other.m_escaped);
+	int claimed = m_claimed;
+	m_claimed = other.m_claimed.load();
+	other.m_claimed = claimed;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "FrameBuffer.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+//Most bins a histogram has, deeper limits share bins between iterations
+const int histogramBins = 65536;
+
+//How the escaped pixels of a frame are spread over the iterations, as a
+//cumulative share. Colouring by a pixel's place in it, rather than by mu
+//itself, spreads the palette evenly over whatever the frame holds, at
+//any limit or zoom
+class Histogram
+{
+
+public:
+	Histogram();
+	~Histogram();
+
+	void count(ThreadPool& pool, int threads, const uint32_t* bands, int width, int height, uint32_t maxIterations);
+	void begin(int threads, uint32_t maxIterations);
+	void add(const uint32_t* bands, int count, int weight);
+	void finish(ThreadPool& pool, int threads);
+	void swap(Histogram& other);
+	int getEscaped() { return m_escaped; };
+
+	/** Returns the share of escaped pixels with a lower mu than a pixel's,
+		from 0 to 1, interpolated across its bin*/
+	double getPosition(uint32_t band, uint16_t fraction) const
+	{
+		double bin = (band - fraction * (1.0 / fractionSteps)) * m_scale;
+		int i = bin < 0.0 ? 0 : bin >= m_bins ? m_bins - 1 : (int)bin;
+		return m_cdf[i] + (bin - i) * (m_cdf[i + 1] - m_cdf[i]);
+	};
+
+private:
+	int claimPart();
+
+	//One histogram per thread counting, each claimed by the first pixels
+	//a thread adds this count, so nothing is shared while counting
+	std::vector<uint32_t> m_counts;
+	int m_parts;
+	std::atomic<int> m_claimed;
+	long long m_round;
+	uint32_t m_maxIterations;
+
+	//Cumulative share of escaped pixels below each bin edge
+	std::vector<float> m_cdf;
+	int m_bins;
+	double m_scale;
+	int m_escaped;
+
+};
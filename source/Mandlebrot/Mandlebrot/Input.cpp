@@ -47,6 +47,18 @@ bool Input::isMouseLeftDown()
 	return mouse.left;
 }
 
+/** Sets mouse right down*/
+void Input::setMouseRightDown(bool r)
+{
+	mouse.right = r;
+}
+
+/** Checks if mouse right is down*/
+bool Input::isMouseRightDown()
+{
+	return mouse.right;
+}
+
 /** Returns mouse x position*/
 float Input::getMouseX()
 {
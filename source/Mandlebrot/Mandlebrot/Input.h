@@ -9,6 +9,7 @@ private:
 	{
 		float x, y;
 		bool left = false;
+		bool right = false;
 
 	};
 
@@ -22,6 +23,8 @@ public:
 	void setMousePosition(int lx, int ly);
 	void setMouseLeftDown(bool l);
 	bool isMouseLeftDown();
+	void setMouseRightDown(bool r);
+	bool isMouseRightDown();
 	float getMouseX();
 	float getMouseY();
 
@@ -0,0 +1,694 @@
+#include "Kernel.h"
+#include <complex>
+#include <cmath>
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+//Pixels handed to a vectorised kernel at a time
+static const int kernelChunk = 256;
+
+//Most iterations handed to a kernel in one go, so the count fits an int
+static const long long kernelSlice = 1 << 30;
+
+//Iterations handed over in one go while a render can be cancelled, a few
+//milliseconds of work for a chunk
+static const long long kernelCancelSlice = 1 << 12;
+
+//Fraction of a pixel two orbit points must be within to count as a cycle
+static const double periodTolerance = 1.0 / 1024.0;
+
+//Rounding error grows with every iteration, so a pixel must be this many
+//times the rounding error of a coordinate per iteration for a precision
+//tier to be used. Tuned with Benchmark::comparePrecision
+static const double precisionHeadroom = 32.0;
+
+//One value per lane, for the number types with no vector instructions
+template <class T>
+struct ScalarPack
+{
+	typedef T Real;
+	static const int Lanes = 1;
+	T v;
+
+	static ScalarPack load(const T* p) { ScalarPack r; r.v = *p; return r; };
+	static ScalarPack set1(double d) { ScalarPack r; r.v = T(d); return r; };
+	static void store(T* p, ScalarPack a) { *p = a.v; };
+	static unsigned int escaped(ScalarPack mag, ScalarPack limit) { return mag.v < limit.v ? 0u : 1u; };
+	static unsigned int less(ScalarPack a, ScalarPack b) { return a.v < b.v ? 1u : 0u; };
+};
+
+template <class T>
+inline ScalarPack<T> operator+(ScalarPack<T> a, ScalarPack<T> b) { ScalarPack<T> r; r.v = a.v + b.v; return r; }
+template <class T>
+inline ScalarPack<T> operator-(ScalarPack<T> a, ScalarPack<T> b) { ScalarPack<T> r; r.v = a.v - b.v; return r; }
+template <class T>
+inline ScalarPack<T> operator*(ScalarPack<T> a, ScalarPack<T> b) { ScalarPack<T> r; r.v = a.v * b.v; return r; }
+
+/** Rounds a double-double coordinate to the kernel's number type*/
+template <class T>
+inline T fromDoubleDouble(const DoubleDouble& d) { return (T)d.hi; }
+template <>
+inline long double fromDoubleDouble<long double>(const DoubleDouble& d) { return d.toLongDouble(); }
+template <>
+inline DoubleDouble fromDoubleDouble<DoubleDouble>(const DoubleDouble& d) { return d; }
+
+/** Widens a kernel value to a double-double without losing anything*/
+template <class T>
+inline DoubleDouble toDoubleDouble(T d) { return DoubleDouble(d); }
+template <>
+inline DoubleDouble toDoubleDouble<long double>(long double d) { double hi = (double)d; return DoubleDouble(hi, (double)(d - hi)); }
+
+/** Widens or narrows a kernel value to a double*/
+inline double toDouble(double d) { return d; }
+inline double toDouble(long double d) { return (double)d; }
+inline double toDouble(const DoubleDouble& d) { return d.toDouble(); }
+
+/** Closed form test for the main cardioid and the period two bulb*/
+static inline bool insideCardioidOrBulb(double x, double y)
+{
+	double y2 = y * y;
+	double q = (x - 0.25) * (x - 0.25) + y2;
+
+	//Main cardioid
+	if (q * (q + (x - 0.25)) <= 0.25 * y2)
+	{
+		return true;
+	}
+
+	//Period two bulb
+	return (x + 1.0) * (x + 1.0) + y2 <= 0.0625;
+}
+
+/** Reads a cpuid leaf into eax, ebx, ecx and edx*/
+static void readCpuid(int leaf, int subleaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuidex(info, leaf, subleaf);
+	for (int i = 0; i < 4; ++i)
+	{
+		regs[i] = (unsigned int)info[i];
+	}
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/** Reads the register state the os saves on a context switch*/
+static unsigned long long readXcr0()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int lo, hi;
+	__asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+
+Kernel::Kernel()
+{
+	//Start on the widest instruction set available
+	m_bestIsa = detectIsa();
+	m_isa = m_bestIsa;
+	m_precision = KernelPrecision::Double;
+	m_interiorChecks = true;
+	m_cancel = nullptr;
+}
+
+Kernel::~Kernel()
+{
+}
+
+/** Finds the widest instruction set the cpu and os both support*/
+KernelIsa Kernel::detectIsa()
+{
+	unsigned int regs[4];
+
+	readCpuid(0, 0, regs);
+	unsigned int maxLeaf = regs[0];
+
+	readCpuid(1, 0, regs);
+	bool sse2 = (regs[3] & (1u << 26)) != 0;
+	bool osxsave = (regs[2] & (1u << 27)) != 0;
+	bool avx = (regs[2] & (1u << 28)) != 0;
+
+	if (!sse2)
+	{
+		return KernelIsa::Scalar;
+	}
+
+	//Wider registers are only usable if the os saves them
+	if (!osxsave || !avx || maxLeaf < 7)
+	{
+		return KernelIsa::SSE2;
+	}
+
+	unsigned long long xcr0 = readXcr0();
+	readCpuid(7, 0, regs);
+	bool avx2 = (regs[1] & (1u << 5)) != 0;
+	bool avx512 = (regs[1] & (1u << 16)) != 0;
+
+#if defined(MBROT_HAVE_AVX512)
+	//Needs the opmask and both halves of the zmm registers
+	if (avx512 && (xcr0 & 0xE6) == 0xE6)
+	{
+		return KernelIsa::AVX512;
+	}
+#endif
+	if (avx2 && (xcr0 & 0x6) == 0x6)
+	{
+		return KernelIsa::AVX2;
+	}
+
+	return KernelIsa::SSE2;
+}
+
+/** Returns the processor's brand string, or its vendor if it has none*/
+std::string Kernel::getCpuName()
+{
+	unsigned int regs[4];
+	char name[49] = {};
+
+	readCpuid(0x80000000, 0, regs);
+	if (regs[0] >= 0x80000004)
+	{
+		for (int leaf = 0; leaf < 3; ++leaf)
+		{
+			readCpuid(0x80000002 + leaf, 0, regs);
+			std::memcpy(name + leaf * 16, regs, 16);
+		}
+	}
+	else
+	{
+		//Vendor is spread over ebx, edx and ecx
+		readCpuid(0, 0, regs);
+		std::memcpy(name, &regs[1], 4);
+		std::memcpy(name + 4, &regs[3], 4);
+		std::memcpy(name + 8, &regs[2], 4);
+	}
+
+	//Brand strings are padded with spaces at either end
+	std::string cpu(name);
+	size_t first = cpu.find_first_not_of(' ');
+	size_t last = cpu.find_last_not_of(' ');
+	return first == std::string::npos ? std::string("Unknown") : cpu.substr(first, last - first + 1);
+}
+
+/** Steps to the next instruction set, wrapping back round to scalar*/
+void Kernel::nextIsa()
+{
+	if (m_isa == m_bestIsa)
+	{
+		m_isa = KernelIsa::Scalar;
+	}
+	else
+	{
+		m_isa = (KernelIsa)((int)m_isa + 1);
+	}
+}
+
+/** Uses an instruction set, or the widest this cpu supports if it is
+	wider than that*/
+void Kernel::setIsa(KernelIsa isa)
+{
+	m_isa = std::min(isa, m_bestIsa);
+}
+
+/** Returns the name of the instruction set in use*/
+const char* Kernel::getIsaName()
+{
+	return getIsaName(m_isa);
+}
+
+/** Returns the name of an instruction set*/
+const char* Kernel::getIsaName(KernelIsa isa)
+{
+	switch (isa)
+	{
+	case KernelIsa::SSE2:
+		return "SSE2";
+	case KernelIsa::AVX2:
+		return "AVX2";
+	case KernelIsa::AVX512:
+		return "AVX-512";
+	default:
+		return "Scalar";
+	}
+}
+
+/** Returns true if long double has more precision than double, it is
+	the same type on msvc*/
+bool Kernel::hasExtendedLongDouble()
+{
+	return LDBL_MANT_DIG > DBL_MANT_DIG;
+}
+
+/** Picks the cheapest number type whose rounding error at this magnitude,
+	built up over maxIterations, is still well under a pixel*/
+KernelPrecision Kernel::choosePrecision(double pixelSize, double magnitude, long long maxIterations)
+{
+	//Orbits reach |z| = 2 wherever c is
+	double scale = std::max(magnitude, 2.0) * (double)maxIterations * precisionHeadroom;
+
+	if (pixelSize > scale * FLT_EPSILON)
+	{
+		return KernelPrecision::Float;
+	}
+	if (pixelSize > scale * DBL_EPSILON)
+	{
+		return KernelPrecision::Double;
+	}
+	if (hasExtendedLongDouble() && pixelSize > scale * LDBL_EPSILON)
+	{
+		return KernelPrecision::LongDouble;
+	}
+	return KernelPrecision::DoubleDouble;
+}
+
+/** Returns the name of a precision tier*/
+const char* Kernel::getPrecisionName(KernelPrecision precision)
+{
+	switch (precision)
+	{
+	case KernelPrecision::Float:
+		return "float";
+	case KernelPrecision::Double:
+		return "double";
+	case KernelPrecision::LongDouble:
+		return "long double";
+	default:
+		return "double-double";
+	}
+}
+
+/** Checks the kernel on a patch of the edge of the set and a few points
+	known to be inside or out. In each number type, every instruction set
+	the cpu has must give the bands the scalar kernel gives, and a render
+	carried on from a lower limit must match one done in one go. Adds a
+	line to report for each that fails. Returns true if all pass*/
+bool Kernel::check(std::string& report)
+{
+	bool passed = true;
+	auto fail = [&](const std::string& what)
+	{
+		report += std::string("Kernel: ") + what + "\n";
+		passed = false;
+	};
+
+	//A patch of the seahorse valley, then c = 0 and -1 inside and 1 outside
+	const int side = 24;
+	const long long limit = 2000;
+	const double pixelSize = 0.002;
+	std::vector<DoubleDouble> re, im;
+	for (int y = 0; y < side; ++y)
+	{
+		for (int x = 0; x < side; ++x)
+		{
+			re.push_back(DoubleDouble(-0.77 + x * pixelSize));
+			im.push_back(DoubleDouble(0.08 + y * pixelSize));
+		}
+	}
+	const double known[][2] = { { 0.0, 0.0 }, { -1.0, 0.0 }, { 1.0, 0.0 } };
+	for (const auto& point : known)
+	{
+		re.push_back(DoubleDouble(point[0]));
+		im.push_back(DoubleDouble(point[1]));
+	}
+	int count = (int)re.size();
+	auto band = [limit](const PixelState& state) { return state.status == PixelStatus::Escaped && state.iterations < limit ? state.iterations : limit; };
+
+	Kernel kernel;
+	const KernelPrecision precisions[] = { KernelPrecision::Float, KernelPrecision::Double, KernelPrecision::LongDouble, KernelPrecision::DoubleDouble };
+	for (KernelPrecision precision : precisions)
+	{
+		kernel.setPrecision(precision);
+		std::vector<PixelState> reference(count);
+		kernel.setIsa(KernelIsa::Scalar);
+		kernel.computePoints(re.data(), im.data(), count, pixelSize, limit, nullptr, reference.data());
+		if (band(reference[count - 3]) != limit || band(reference[count - 2]) != limit || band(reference[count - 1]) > 3)
+		{
+			fail(std::string(getPrecisionName(precision)) + " puts a known point on the wrong side of the set");
+		}
+
+		for (int isa = (int)KernelIsa::Scalar; isa <= (int)detectIsa(); ++isa)
+		{
+			kernel.setIsa((KernelIsa)isa);
+			std::vector<PixelState> states(count);
+			kernel.computePoints(re.data(), im.data(), count, pixelSize, limit, nullptr, states.data());
+			std::vector<PixelState> resumed(count);
+			kernel.computePoints(re.data(), im.data(), count, pixelSize, limit / 10, nullptr, resumed.data());
+			kernel.computePoints(re.data(), im.data(), count, pixelSize, limit, nullptr, resumed.data());
+
+			int differ = 0;
+			int resumeDiffer = 0;
+			for (int i = 0; i < count; ++i)
+			{
+				differ += band(states[i]) != band(reference[i]) ? 1 : 0;
+				resumeDiffer += band(resumed[i]) != band(states[i]) ? 1 : 0;
+			}
+			std::string name = std::string(getIsaName((KernelIsa)isa)) + " " + getPrecisionName(precision);
+			if (differ > 0)
+			{
+				fail(name + " differs from scalar in " + std::to_string(differ) + " of " + std::to_string(count) + " bands");
+			}
+			if (resumeDiffer > 0)
+			{
+				fail(name + " carried on from a lower limit differs in " + std::to_string(resumeDiffer) + " bands");
+			}
+		}
+	}
+	return passed;
+}
+
+/** Computes the smooth iteration value of every pixel in a run. With
+	states, pixels carry on from where the last render of the view left
+	them, otherwise every pixel starts from z = 0. Mu may be null when the
+	states are all that is wanted. Returns the number of pixels that
+	needed iterating*/
+int Kernel::computeRun(const KernelRun& run, long long maxIterations, double* mu, PixelState* states)
+{
+	DoubleDouble re[kernelChunk];
+	DoubleDouble im[kernelChunk];
+	double pixelSize = std::max(std::abs(run.reStep), std::abs(run.imStep));
+	int iterated = 0;
+
+	for (int start = 0; start < run.count; start += kernelChunk)
+	{
+		int chunk = std::min(kernelChunk, run.count - start);
+		for (int i = 0; i < chunk; ++i)
+		{
+			int k = run.first + start + i;
+			re[i] = run.reBase + DoubleDouble((k + 0.5f) * run.reStep);
+			im[i] = run.imBase + DoubleDouble((k + 0.5f) * run.imStep);
+		}
+		iterated += computePoints(re, im, chunk, pixelSize, maxIterations, mu ? mu + start : nullptr, states ? states + start : nullptr);
+	}
+
+	return iterated;
+}
+
+/** Computes the smooth iteration value of any list of points c = (re[i],
+	im[i]), pixelSize apart, for fill strategies that skip about the view.
+	States work as for computeRun. Once cancelled, calls return straight
+	away and leave their pixels part way, with mu unwritten*/
+int Kernel::computePoints(const DoubleDouble* re, const DoubleDouble* im, int count, double pixelSize, long long maxIterations, double* mu, PixelState* states)
+{
+	if (isCancelled())
+	{
+		return 0;
+	}
+
+	//A one off render starts every pixel from scratch
+	std::vector<PixelState> fresh;
+	if (!states)
+	{
+		fresh.resize(count);
+		states = fresh.data();
+	}
+
+	if (m_isa == KernelIsa::Scalar && m_precision == KernelPrecision::Double)
+	{
+		return computePointsScalar(re, im, count, maxIterations, mu, states);
+	}
+
+	KernelOptions options;
+	options.maxIterations = 0;
+	options.interiorChecks = m_interiorChecks;
+	options.periodTolerance = pixelSize * periodTolerance;
+
+	switch (m_precision)
+	{
+	case KernelPrecision::Float:
+		return computePointsAs<float>(re, im, count, options, maxIterations, mu, states);
+	case KernelPrecision::Double:
+		return computePointsAs<double>(re, im, count, options, maxIterations, mu, states);
+	case KernelPrecision::LongDouble:
+		return computePointsAs<long double>(re, im, count, options, maxIterations, mu, states);
+	default:
+		return computePointsAs<DoubleDouble>(re, im, count, options, maxIterations, mu, states);
+	}
+}
+
+/** Rounds c for every point that still needs iterating to the kernel's
+	number type, drops the ones the closed form test puts inside the set
+	and hands the rest to the kernel a chunk at a time. Points that are
+	furthest behind go first, so every point in a call to the kernel
+	starts from the same count*/
+template <class T>
+int Kernel::computePointsAs(const DoubleDouble* re, const DoubleDouble* im, int count, const KernelOptions& options, long long maxIterations, double* mu, PixelState* states)
+{
+	alignas(64) T cre[kernelChunk];
+	alignas(64) T cim[kernelChunk];
+	alignas(64) T zre[kernelChunk];
+	alignas(64) T zim[kernelChunk];
+	alignas(64) T norms[kernelChunk];
+	int iterations[kernelChunk];
+	int index[kernelChunk];
+	int iterated = 0;
+
+	for (int start = 0; start < count; start += kernelChunk)
+	{
+		int chunk = std::min(kernelChunk, count - start);
+		PixelState* state = states + start;
+		int points = 0;
+
+		for (int i = 0; i < chunk; ++i)
+		{
+			//Pixels already finished at this limit only need reclassifying
+			if (!state[i].needsWork(maxIterations))
+			{
+				if (mu)
+				{
+					mu[start + i] = state[i].valueAt(maxIterations);
+				}
+				continue;
+			}
+
+			if (m_interiorChecks && state[i].iterations == 0 && insideCardioidOrBulb(re[start + i].hi, im[start + i].hi))
+			{
+				state[i].status = PixelStatus::Inside;
+				if (mu)
+				{
+					mu[start + i] = (double)maxIterations;
+				}
+				continue;
+			}
+
+			cre[points] = fromDoubleDouble<T>(re[start + i]);
+			cim[points] = fromDoubleDouble<T>(im[start + i]);
+			zre[points] = fromDoubleDouble<T>(state[i].zr);
+			zim[points] = fromDoubleDouble<T>(state[i].zi);
+			index[points] = i;
+			++points;
+		}
+		iterated += points;
+
+		while (points > 0 && !isCancelled())
+		{
+			//Moves the points furthest behind to the front
+			long long from = state[index[0]].iterations;
+			for (int i = 1; i < points; ++i)
+			{
+				from = std::min(from, state[index[i]].iterations);
+			}
+			int batch = 0;
+			for (int i = 0; i < points; ++i)
+			{
+				if (state[index[i]].iterations == from)
+				{
+					std::swap(cre[i], cre[batch]);
+					std::swap(cim[i], cim[batch]);
+					std::swap(zre[i], zre[batch]);
+					std::swap(zim[i], zim[batch]);
+					std::swap(index[i], index[batch]);
+					++batch;
+				}
+			}
+
+			KernelOptions slice = options;
+			slice.maxIterations = (int)std::min(maxIterations - from, m_cancel ? kernelCancelSlice : kernelSlice);
+			iteratePoints(cre, cim, zre, zim, batch, slice, iterations, norms);
+
+			//Same smoothing as the scalar path, |z| = sqrt(|z|^2). Points
+			//stopped by a slice short of the limit stay in the list
+			int remaining = 0;
+			for (int i = 0; i < points; ++i)
+			{
+				PixelState& pixel = state[index[i]];
+				if (i < batch)
+				{
+					pixel.iterations = from + iterations[i];
+					if (toDouble(norms[i]) < 0.0)
+					{
+						pixel.status = PixelStatus::Inside;
+					}
+					else if (iterations[i] < slice.maxIterations)
+					{
+						pixel.status = PixelStatus::Escaped;
+						pixel.mu = pixel.iterations - (std::log(2) / std::log(std::sqrt(toDouble(norms[i]))));
+					}
+					else
+					{
+						pixel.zr = toDoubleDouble(zre[i]);
+						pixel.zi = toDoubleDouble(zim[i]);
+					}
+
+					if (pixel.needsWork(maxIterations))
+					{
+						cre[remaining] = cre[i];
+						cim[remaining] = cim[i];
+						zre[remaining] = zre[i];
+						zim[remaining] = zim[i];
+						index[remaining] = index[i];
+						++remaining;
+					}
+					else if (mu)
+					{
+						mu[start + index[i]] = pixel.valueAt(maxIterations);
+					}
+				}
+				else
+				{
+					cre[remaining] = cre[i];
+					cim[remaining] = cim[i];
+					zre[remaining] = zre[i];
+					zim[remaining] = zim[i];
+					index[remaining] = index[i];
+					++remaining;
+				}
+			}
+			points = remaining;
+		}
+	}
+
+	return iterated;
+}
+
+/** Runs float points on the selected instruction set*/
+void Kernel::iteratePoints(const float* cre, const float* cim, float* zre, float* zim, int count, const KernelOptions& options, int* iterations, float* norms)
+{
+	switch (m_isa)
+	{
+#if defined(MBROT_HAVE_AVX512)
+	case KernelIsa::AVX512:
+		iteratePointsAVX512(cre, cim, zre, zim, count, options, iterations, norms);
+		break;
+#endif
+	case KernelIsa::AVX2:
+		iteratePointsAVX2(cre, cim, zre, zim, count, options, iterations, norms);
+		break;
+	case KernelIsa::SSE2:
+		iteratePointsSSE2(cre, cim, zre, zim, count, options, iterations, norms);
+		break;
+	default:
+		::iteratePoints<ScalarPack<float> >(cre, cim, zre, zim, count, options, iterations, norms);
+		break;
+	}
+}
+
+/** Runs double points on the selected instruction set*/
+void Kernel::iteratePoints(const double* cre, const double* cim, double* zre, double* zim, int count, const KernelOptions& options, int* iterations, double* norms)
+{
+	switch (m_isa)
+	{
+#if defined(MBROT_HAVE_AVX512)
+	case KernelIsa::AVX512:
+		iteratePointsAVX512(cre, cim, zre, zim, count, options, iterations, norms);
+		break;
+#endif
+	case KernelIsa::AVX2:
+		iteratePointsAVX2(cre, cim, zre, zim, count, options, iterations, norms);
+		break;
+	case KernelIsa::SSE2:
+		iteratePointsSSE2(cre, cim, zre, zim, count, options, iterations, norms);
+		break;
+	default:
+		::iteratePoints<ScalarPack<double> >(cre, cim, zre, zim, count, options, iterations, norms);
+		break;
+	}
+}
+
+/** Runs long double points, there are no vector instructions for them*/
+void Kernel::iteratePoints(const long double* cre, const long double* cim, long double* zre, long double* zim, int count, const KernelOptions& options, int* iterations, long double* norms)
+{
+	::iteratePoints<ScalarPack<long double> >(cre, cim, zre, zim, count, options, iterations, norms);
+}
+
+/** Runs double-double points one at a time*/
+void Kernel::iteratePoints(const DoubleDouble* cre, const DoubleDouble* cim, DoubleDouble* zre, DoubleDouble* zim, int count, const KernelOptions& options, int* iterations, DoubleDouble* norms)
+{
+	::iteratePoints<ScalarPack<DoubleDouble> >(cre, cim, zre, zim, count, options, iterations, norms);
+}
+
+/** Reference kernel, one pixel at a time using std::complex. Has no
+	interior fast path so it can be used to check the vector kernels*/
+int Kernel::computePointsScalar(const DoubleDouble* re, const DoubleDouble* im, int count, long long maxIterations, double* mu, PixelState* states)
+{
+	int iterated = 0;
+
+	for (int i = 0; i < count; ++i)
+	{
+		PixelState& state = states[i];
+		if (!state.needsWork(maxIterations))
+		{
+			if (mu)
+			{
+				mu[i] = state.valueAt(maxIterations);
+			}
+			continue;
+		}
+		++iterated;
+
+		// The point in the complex plane that corresponds
+		// to this pixel in the output image.
+		std::complex<double> c(re[i].toDouble(), im[i].toDouble());
+
+		long long iterations = state.iterations;
+
+		std::complex<double> z(state.zr.hi, state.zi.hi);
+
+		// Iterate z = z^2 + c until z moves more than 2 units
+		// away from (0, 0), or we've iterated too many times.
+		while (abs(z) < 2.0 && iterations < maxIterations)
+		{
+			z = (z * z) + c;
+
+			++iterations;
+
+			//A pixel can take millions, so looks for a cancel now and then
+			if ((iterations & (kernelCancelSlice - 1)) == 0 && isCancelled())
+			{
+				break;
+			}
+		}
+		state.iterations = iterations;
+		if (iterations == maxIterations || abs(z) < 2.0)
+		{
+			state.zr = z.real();
+			state.zi = z.imag();
+		}
+		// z escaped within less than MAX_ITERATIONS
+		// iterations. This point isn't in the set.
+		else
+		{
+			state.status = PixelStatus::Escaped;
+			state.mu = iterations - (std::log(2) / std::log(std::abs(z)));
+		}
+		if (mu)
+		{
+			mu[i] = state.valueAt(maxIterations);
+		}
+	}
+
+	return iterated;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "DoubleDouble.h"
+#include "SimdKernel.h"
+#include "PixelState.h"
+#include <atomic>
+#include <string>
+
+//Instruction sets the escape time kernel can run on
+enum class KernelIsa
+{
+	Scalar,
+	SSE2,
+	AVX2,
+	AVX512
+};
+
+//Number types the kernel can iterate in, cheapest first
+enum class KernelPrecision
+{
+	Float,
+	Double,
+	LongDouble,
+	DoubleDouble
+};
+
+//A straight line of pixels through the complex plane. Pixel k of the
+//run sits at c = (reBase + (k + 0.5) * reStep, imBase + (k + 0.5) * imStep)
+//so a column of the image has reStep = 0 and a row has imStep = 0. The
+//bases are double-double so deep views keep their position
+struct KernelRun
+{
+	DoubleDouble reBase;
+	double reStep;
+	DoubleDouble imBase;
+	double imStep;
+
+	//Index of the first pixel and number of pixels in the run
+	int first;
+	int count;
+};
+
+class Kernel
+{
+
+public:
+	Kernel();
+	~Kernel();
+
+	int computeRun(const KernelRun& run, long long maxIterations, double* mu, PixelState* states);
+	int computePoints(const DoubleDouble* re, const DoubleDouble* im, int count, double pixelSize, long long maxIterations, double* mu, PixelState* states);
+	void nextIsa();
+	void setIsa(KernelIsa isa);
+	void setInteriorChecks(bool enabled) { m_interiorChecks = enabled; };
+	void setPrecision(KernelPrecision precision) { m_precision = precision; };
+	void setCancel(const std::atomic<bool>* cancel) { m_cancel = cancel; };
+
+	KernelIsa getIsa() { return m_isa; };
+	KernelPrecision getPrecision() { return m_precision; };
+	bool getInteriorChecks() { return m_interiorChecks; };
+	bool isCancelled() { return m_cancel && m_cancel->load(std::memory_order_relaxed); };
+	const char* getIsaName();
+
+	static KernelIsa detectIsa();
+	static const char* getIsaName(KernelIsa isa);
+	static std::string getCpuName();
+	static KernelPrecision choosePrecision(double pixelSize, double magnitude, long long maxIterations);
+	static bool hasExtendedLongDouble();
+	static const char* getPrecisionName(KernelPrecision precision);
+	static bool check(std::string& report);
+
+private:
+	template <class T>
+	int computePointsAs(const DoubleDouble* re, const DoubleDouble* im, int count, const KernelOptions& options, long long maxIterations, double* mu, PixelState* states);
+	int computePointsScalar(const DoubleDouble* re, const DoubleDouble* im, int count, long long maxIterations, double* mu, PixelState* states);
+
+	void iteratePoints(const float* cre, const float* cim, float* zre, float* zim, int count, const KernelOptions& options, int* iterations, float* norms);
+	void iteratePoints(const double* cre, const double* cim, double* zre, double* zim, int count, const KernelOptions& options, int* iterations, double* norms);
+	void iteratePoints(const long double* cre, const long double* cim, long double* zre, long double* zim, int count, const KernelOptions& options, int* iterations, long double* norms);
+	void iteratePoints(const DoubleDouble* cre, const DoubleDouble* cim, DoubleDouble* zre, DoubleDouble* zim, int count, const KernelOptions& options, int* iterations, DoubleDouble* norms);
+
+	//Instruction set in use and the best one this cpu supports
+	KernelIsa m_isa;
+	KernelIsa m_bestIsa;
+
+	//Number type the kernel iterates in
+	KernelPrecision m_precision;
+
+	//Interior fast path for the vector kernels
+	bool m_interiorChecks;
+
+	//Set from another thread to stop the render part way, null if renders
+	//are never cancelled
+	const std::atomic<bool>* m_cancel;
+
+};
@@ -0,0 +1,61 @@
+//Lets gcc and clang emit avx2 code in this file only, the kernel is
+//only called once the cpu has been checked for support
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx2")
+#endif
+
+#include "SimdKernel.h"
+#include <immintrin.h>
+
+//Four doubles per register
+struct PackAVX2
+{
+	typedef double Real;
+	static const int Lanes = 4;
+	__m256d v;
+
+	static PackAVX2 load(const double* p) { PackAVX2 r; r.v = _mm256_load_pd(p); return r; };
+	static PackAVX2 set1(double d) { PackAVX2 r; r.v = _mm256_set1_pd(d); return r; };
+	static void store(double* p, PackAVX2 a) { _mm256_store_pd(p, a.v); };
+	static unsigned int escaped(PackAVX2 mag, PackAVX2 limit) { return (unsigned int)_mm256_movemask_pd(_mm256_cmp_pd(mag.v, limit.v, _CMP_NLT_UQ)); };
+	static unsigned int less(PackAVX2 a, PackAVX2 b) { return (unsigned int)_mm256_movemask_pd(_mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ)); };
+};
+
+static inline PackAVX2 operator+(PackAVX2 a, PackAVX2 b) { PackAVX2 r; r.v = _mm256_add_pd(a.v, b.v); return r; }
+static inline PackAVX2 operator-(PackAVX2 a, PackAVX2 b) { PackAVX2 r; r.v = _mm256_sub_pd(a.v, b.v); return r; }
+static inline PackAVX2 operator*(PackAVX2 a, PackAVX2 b) { PackAVX2 r; r.v = _mm256_mul_pd(a.v, b.v); return r; }
+
+//Eight floats per register
+struct PackAVX2f
+{
+	typedef float Real;
+	static const int Lanes = 8;
+	__m256 v;
+
+	static PackAVX2f load(const float* p) { PackAVX2f r; r.v = _mm256_load_ps(p); return r; };
+	static PackAVX2f set1(double d) { PackAVX2f r; r.v = _mm256_set1_ps((float)d); return r; };
+	static void store(float* p, PackAVX2f a) { _mm256_store_ps(p, a.v); };
+	static unsigned int escaped(PackAVX2f mag, PackAVX2f limit) { return (unsigned int)_mm256_movemask_ps(_mm256_cmp_ps(mag.v, limit.v, _CMP_NLT_UQ)); };
+	static unsigned int less(PackAVX2f a, PackAVX2f b) { return (unsigned int)_mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); };
+};
+
+static inline PackAVX2f operator+(PackAVX2f a, PackAVX2f b) { PackAVX2f r; r.v = _mm256_add_ps(a.v, b.v); return r; }
+static inline PackAVX2f operator-(PackAVX2f a, PackAVX2f b) { PackAVX2f r; r.v = _mm256_sub_ps(a.v, b.v); return r; }
+static inline PackAVX2f operator*(PackAVX2f a, PackAVX2f b) { PackAVX2f r; r.v = _mm256_mul_ps(a.v, b.v); return r; }
+
+/** Escape time kernels for AVX2*/
+void iteratePointsAVX2(const float* cre, const float* cim, float* zre, float* zim, int count, const KernelOptions& options, int* iterations, float* norms)
+{
+	iteratePoints<PackAVX2f>(cre, cim, zre, zim, count, options, iterations, norms);
+}
+
+void iteratePointsAVX2(const double* cre, const double* cim, double* zre, double* zim, int count, const KernelOptions& options, int* iterations, double* norms)
+{
+	iteratePoints<PackAVX2>(cre, cim, zre, zim, count, options, iterations, norms);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
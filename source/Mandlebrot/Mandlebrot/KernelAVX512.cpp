@@ -0,0 +1,67 @@
+//Lets gcc and clang emit avx-512 code in this file only, the kernel is
+//only called once the cpu has been checked for support. Fused multiply
+//adds are kept off so results match the narrower kernels bit for bit
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx512f")
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#include "SimdKernel.h"
+
+#if defined(MBROT_HAVE_AVX512)
+#include <immintrin.h>
+
+//Eight doubles per register
+struct PackAVX512
+{
+	typedef double Real;
+	static const int Lanes = 8;
+	__m512d v;
+
+	static PackAVX512 load(const double* p) { PackAVX512 r; r.v = _mm512_load_pd(p); return r; };
+	static PackAVX512 set1(double d) { PackAVX512 r; r.v = _mm512_set1_pd(d); return r; };
+	static void store(double* p, PackAVX512 a) { _mm512_store_pd(p, a.v); };
+	static unsigned int escaped(PackAVX512 mag, PackAVX512 limit) { return (unsigned int)_mm512_cmp_pd_mask(mag.v, limit.v, _CMP_NLT_UQ); };
+	static unsigned int less(PackAVX512 a, PackAVX512 b) { return (unsigned int)_mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ); };
+};
+
+static inline PackAVX512 operator+(PackAVX512 a, PackAVX512 b) { PackAVX512 r; r.v = _mm512_add_pd(a.v, b.v); return r; }
+static inline PackAVX512 operator-(PackAVX512 a, PackAVX512 b) { PackAVX512 r; r.v = _mm512_sub_pd(a.v, b.v); return r; }
+static inline PackAVX512 operator*(PackAVX512 a, PackAVX512 b) { PackAVX512 r; r.v = _mm512_mul_pd(a.v, b.v); return r; }
+
+//Sixteen floats per register
+struct PackAVX512f
+{
+	typedef float Real;
+	static const int Lanes = 16;
+	__m512 v;
+
+	static PackAVX512f load(const float* p) { PackAVX512f r; r.v = _mm512_load_ps(p); return r; };
+	static PackAVX512f set1(double d) { PackAVX512f r; r.v = _mm512_set1_ps((float)d); return r; };
+	static void store(float* p, PackAVX512f a) { _mm512_store_ps(p, a.v); };
+	static unsigned int escaped(PackAVX512f mag, PackAVX512f limit) { return (unsigned int)_mm512_cmp_ps_mask(mag.v, limit.v, _CMP_NLT_UQ); };
+	static unsigned int less(PackAVX512f a, PackAVX512f b) { return (unsigned int)_mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ); };
+};
+
+static inline PackAVX512f operator+(PackAVX512f a, PackAVX512f b) { PackAVX512f r; r.v = _mm512_add_ps(a.v, b.v); return r; }
+static inline PackAVX512f operator-(PackAVX512f a, PackAVX512f b) { PackAVX512f r; r.v = _mm512_sub_ps(a.v, b.v); return r; }
+static inline PackAVX512f operator*(PackAVX512f a, PackAVX512f b) { PackAVX512f r; r.v = _mm512_mul_ps(a.v, b.v); return r; }
+
+/** Escape time kernels for AVX-512*/
+void iteratePointsAVX512(const float* cre, const float* cim, float* zre, float* zim, int count, const KernelOptions& options, int* iterations, float* norms)
+{
+	iteratePoints<PackAVX512f>(cre, cim, zre, zim, count, options, iterations, norms);
+}
+
+void iteratePointsAVX512(const double* cre, const double* cim, double* zre, double* zim, int count, const KernelOptions& options, int* iterations, double* norms)
+{
+	iteratePoints<PackAVX512>(cre, cim, zre, zim, count, options, iterations, norms);
+}
+
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
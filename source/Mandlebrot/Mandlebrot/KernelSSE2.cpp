@@ -0,0 +1,49 @@
+#include "SimdKernel.h"
+#include <emmintrin.h>
+
+//Two doubles per register
+struct PackSSE2
+{
+	typedef double Real;
+	static const int Lanes = 2;
+	__m128d v;
+
+	static PackSSE2 load(const double* p) { PackSSE2 r; r.v = _mm_load_pd(p); return r; };
+	static PackSSE2 set1(double d) { PackSSE2 r; r.v = _mm_set1_pd(d); return r; };
+	static void store(double* p, PackSSE2 a) { _mm_store_pd(p, a.v); };
+	static unsigned int escaped(PackSSE2 mag, PackSSE2 limit) { return (unsigned int)_mm_movemask_pd(_mm_cmpnlt_pd(mag.v, limit.v)); };
+	static unsigned int less(PackSSE2 a, PackSSE2 b) { return (unsigned int)_mm_movemask_pd(_mm_cmplt_pd(a.v, b.v)); };
+};
+
+static inline PackSSE2 operator+(PackSSE2 a, PackSSE2 b) { PackSSE2 r; r.v = _mm_add_pd(a.v, b.v); return r; }
+static inline PackSSE2 operator-(PackSSE2 a, PackSSE2 b) { PackSSE2 r; r.v = _mm_sub_pd(a.v, b.v); return r; }
+static inline PackSSE2 operator*(PackSSE2 a, PackSSE2 b) { PackSSE2 r; r.v = _mm_mul_pd(a.v, b.v); return r; }
+
+//Four floats per register
+struct PackSSE2f
+{
+	typedef float Real;
+	static const int Lanes = 4;
+	__m128 v;
+
+	static PackSSE2f load(const float* p) { PackSSE2f r; r.v = _mm_load_ps(p); return r; };
+	static PackSSE2f set1(double d) { PackSSE2f r; r.v = _mm_set1_ps((float)d); return r; };
+	static void store(float* p, PackSSE2f a) { _mm_store_ps(p, a.v); };
+	static unsigned int escaped(PackSSE2f mag, PackSSE2f limit) { return (unsigned int)_mm_movemask_ps(_mm_cmpnlt_ps(mag.v, limit.v)); };
+	static unsigned int less(PackSSE2f a, PackSSE2f b) { return (unsigned int)_mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); };
+};
+
+static inline PackSSE2f operator+(PackSSE2f a, PackSSE2f b) { PackSSE2f r; r.v = _mm_add_ps(a.v, b.v); return r; }
+static inline PackSSE2f operator-(PackSSE2f a, PackSSE2f b) { PackSSE2f r; r.v = _mm_sub_ps(a.v, b.v); return r; }
+static inline PackSSE2f operator*(PackSSE2f a, PackSSE2f b) { PackSSE2f r; r.v = _mm_mul_ps(a.v, b.v); return r; }
+
+/** Escape time kernels for SSE2*/
+void iteratePointsSSE2(const float* cre, const float* cim, float* zre, float* zim, int count, const KernelOptions& options, int* iterations, float* norms)
+{
+	iteratePoints<PackSSE2f>(cre, cim, zre, zim, count, options, iterations, norms);
+}
+
+void iteratePointsSSE2(const double* cre, const double* cim, double* zre, double* zim, int count, const KernelOptions& options, int* iterations, double* norms)
+{
+	iteratePoints<PackSSE2>(cre, cim, zre, zim, count, options, iterations, norms);
+}
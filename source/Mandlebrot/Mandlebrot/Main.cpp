@@ -1,17 +1,99 @@
 #include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
 #include "RenderLoop.h"
 #include "Input.h"
+#include "Benchmark.h"
+#include "Tuner.h"
+#include "Progressive.h"
+#include "TileStore.h"
+#include "ViewHistory.h"
+#include "BoundedQueue.h"
 
 
 using namespace std;
 
-void main(int argc, char** argv[]) {
+int main(int argc, char* argv[]) {
+	//Runs the benchmark instead of the viewer when asked to
+	if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0)
+	{
+		Benchmark benchmark;
+		string report = benchmark.run();
+		std::cout << report;
+		std::ofstream file("benchmark.txt");
+		file << report;
+		return 0;
+	}
+
+	//Runs the self checks of the parts that hold state or numbers worth
+	//checking without a window, and reports the ones that fail
+	if (argc > 1 && std::strcmp(argv[1], "--check") == 0)
+	{
+		string report;
+		bool passed = BigFixed::check(report);
+		passed = Kernel::check(report) && passed;
+		passed = Progressive::check(report) && passed;
+		passed = TileCache::check(report) && passed;
+		passed = TileStore::check(report) && passed;
+		passed = ViewHistory::check(report) && passed;
+		passed = checkBoundedQueue(report) && passed;
+		std::cout << (passed ? "All checks passed\n" : report);
+		return passed ? 0 : 1;
+	}
+
+	//Tunes the scheduling for this machine and saves it for the viewer
+	if (argc > 1 && std::strcmp(argv[1], "--tune") == 0)
+	{
+		Kernel kernel;
+		ThreadPool pool(std::thread::hardware_concurrency());
+		Tuner tuner;
+		TuningProfile profile = tuner.tune(kernel, pool);
+		std::cout << tuner.getReport();
+		return Tuner::save(tuningProfilePath, profile) ? 0 : 1;
+	}
+
+	//Drops the damaged tiles of the tile store and packs the rest into a
+	//store of the given size in MB, or of its own size, --store-gc [mb]
+	if (argc > 1 && std::strcmp(argv[1], "--store-gc") == 0)
+	{
+		string report;
+		bool compacted = TileStore::compact(tileStorePath, argc > 2 ? std::atoll(argv[2]) : 0, report);
+		std::cout << report;
+		return compacted ? 0 : 1;
+	}
+
 	//Winow settings
 	sf::RenderWindow window(sf::VideoMode(VIEW_WIDTH, VIEW_HEIGHT), "Mandelbrot", sf::Style::Close);
 	sf::View view(sf::Vector2f(0.0f, 0.0f), sf::Vector2f(VIEW_WIDTH, VIEW_HEIGHT));
+	//Renders run in the background, so the window is drawn every refresh
+	//without spinning a core the render could use
+	window.setVerticalSyncEnabled(true);
 	//Main classes
 	Input input;
 	RenderLoop loop(&window, &input);
+
+	//Highest iteration limit, --iterations-cap <n>, MB of computed tiles
+	//kept, --cache-mb <n>, and a location to start at given as decimals,
+	//--location <re> <im> <width>
+	for (int i = 1; i < argc; ++i)
+	{
+		if (i + 1 < argc && std::strcmp(argv[i], "--iterations-cap") == 0)
+		{
+			loop.setIterationsCap(std::atoll(argv[i + 1]));
+			i += 1;
+		}
+		else if (i + 1 < argc && std::strcmp(argv[i], "--cache-mb") == 0)
+		{
+			loop.setCacheBudget(std::atoll(argv[i + 1]));
+			i += 1;
+		}
+		else if (i + 3 < argc && std::strcmp(argv[i], "--location") == 0)
+		{
+			loop.setLocation(argv[i + 1], argv[i + 2], argv[i + 3]);
+			i += 3;
+		}
+	}
 	//For delta time
 	sf::Clock clock;
 	float deltaTime;
@@ -42,6 +124,10 @@ void main(int argc, char** argv[]) {
 					input.setMouseLeftDown(true);
 					input.setMousePosition(event.mouseButton.x, event.mouseButton.y);
 				}
+				else if (event.mouseButton.button == sf::Mouse::Right)
+				{
+					input.setMouseRightDown(true);
+				}
 				break;
 			case sf::Event::MouseButtonReleased:
 				if (event.mouseButton.button == sf::Mouse::Left)
@@ -50,6 +136,10 @@ void main(int argc, char** argv[]) {
 					input.setMouseLeftDown(false);
 					loop.scaleZoom();
 				}
+				else if (event.mouseButton.button == sf::Mouse::Right)
+				{
+					input.setMouseRightDown(false);
+				}
 				break;
 			default:
 				//Don't handle other events  
@@ -65,4 +155,6 @@ void main(int argc, char** argv[]) {
 		loop.update();
 		loop.render();
 	}
+
+	return 0;
 }
\ No newline at end of file
@@ -1,18 +1,109 @@
 #include "Mandlebrot.h"
 
+//Holding A or D changes the iteration limit by this fraction of itself
+static const long long resolutionStepDivisor = 64;
 
+//Pixels a row may be off its mirror image and still be copied into it
+static const double mirrorTolerance = 1e-6;
 
-Mandlebrot::Mandlebrot()
+//Pixels a view's edges may be off the lattice and still share its tiles
+static const double latticeTolerance = 1e-6;
+
+//Iterations of mu the colours move through each second while cycling
+static const float cycleSpeed = 30.0f;
+
+//Longest a progressive render goes without the picture being updated
+static const sf::Time previewInterval = sf::milliseconds(100);
+
+//Scattered probe pixels go slower than whole rows, predictions start at
+//this share of the probe's rate until renders show how far off they are
+static const double defaultEtaScale = 0.6;
+
+//How often the render thread looks for work ahead once it has run out
+static const std::chrono::milliseconds speculationInterval(50);
+
+//Rows of a strip a pan uncovered worked out as one task, so the pool
+//shares even a single tall strip
+static const int stripRows = 8;
+
+//Weight of the latest render in the scale predictions are made with, and
+//the least ms a render must have left after its probe to count
+static const double etaLearningRate = 0.5;
+static const double etaLearningMinimum = 10.0;
+
+/** Moves the elements of a plane of size elements count places on, or
+	back for a negative count, dropping those moved off the end*/
+template <class T>
+static void shiftPlane(T* plane, size_t size, long long count)
+{
+	size_t distance = (size_t)std::abs(count);
+	if (distance >= size)
+	{
+		return;
+	}
+	if (count > 0)
+	{
+		std::copy_backward(plane, plane + size - distance, plane + size);
+	}
+	else
+	{
+		std::copy(plane + distance, plane + size, plane);
+	}
+}
+
+Mandlebrot::Mandlebrot() : m_pool(std::thread::hardware_concurrency()), m_colourPool(std::thread::hardware_concurrency())
 {
 	//Initialise thread count, speed and elapsed time
 	m_threadCap = std::thread::hardware_concurrency();
 	m_threads = m_threadCap;
+	m_tuned = false;
 	m_elapsedTime = 0.0f;
 	m_threadIncrementSpeed = 0.5f;
 	m_resolutionIncrementSpeed = 0.05f;
+	m_autoPrecision = true;
+	m_usePerturbation = false;
+	m_iterationsCap = defaultIterationsCap;
+	m_stateGeneration = 0;
+	m_frameGeneration = -1;
+	m_shownIterations = m_max_iterations;
+	m_shownAxis = -1;
+	m_shownCoords = m_coords;
+	m_shownGeneration = -1;
+	m_previewTime = -1.0;
+	m_stripsOnly = false;
+	m_panning = false;
+	m_panUnrecorded = false;
+	m_previewPasses = 0;
+	m_focusX = -1;
+	m_focusY = -1;
+	m_etaScale = defaultEtaScale;
+	m_predictedTime = -1;
+	m_shownPrediction = -1.0;
+	m_probeFinished = 0.0;
+	m_colourVersion = 0;
+	m_speculationPlanned = false;
+	m_speculationThreads = 1;
+	m_nextDetailTile = 0;
+	m_cursorX = -1;
+	m_cursorY = -1;
+	m_speculatedTiles = 0;
+	m_latticeViews = 0;
+	m_instantViews = 0;
+	m_tileStore.open(tileStorePath, (size_t)defaultStoreMegabytes << 20);
+	m_iteratedShare = 1.0;
+	m_filled = 0.0;
+	m_fillMode = FillMode::BruteForce;
+	m_verifyFill = false;
+	m_colourMode = ColourMode::Palette;
+	m_cycling = false;
+	m_cyclePhase = 0.0f;
+	m_fillMismatches = 0;
+	m_mirrorAxis = -1;
 
-	//Create image
-	m_image.create((int)VIEW_WIDTH, (int)VIEW_HEIGHT);
+	//Create frame, the image is its colour plane
+	m_frame.create(VIEW_WIDTH, VIEW_HEIGHT);
+	m_preview.create(VIEW_WIDTH, VIEW_HEIGHT);
+	m_shown = &m_frame;
 
 	//Initialise colour frequencies
 	m_frequencyOne = 0.3;
@@ -24,120 +115,1605 @@ Mandlebrot::Mandlebrot()
 	omp_init_lock(&m_imageColour_lock);
 	omp_init_lock(&m_mu_lock);
 	
-	//Initialise mu vector
-	m_mu.resize(VIEW_WIDTH, vector<double>(VIEW_HEIGHT, 0));
+	//Set aspect ratio
+	m_aspectRatio = (double)VIEW_WIDTH / VIEW_HEIGHT;
+
+	//Initialise image rectangle
+	m_imageSprite.setSize(sf::Vector2f(VIEW_WIDTH, VIEW_HEIGHT));
+	m_imageTexture.create(VIEW_WIDTH, VIEW_HEIGHT);
+	m_imageTexture.setRepeated(true);
+	showImage(m_frame.getRgba());
+
+	//Start the render thread, it sleeps until a render is asked for
+	m_backFrame.create(VIEW_WIDTH, VIEW_HEIGHT);
+	m_jobPending = false;
+	m_rendering = false;
+	m_frameReady = false;
+	m_quit = false;
+	m_speculating = false;
+	m_speculationHeld = false;
+	m_tunePending = false;
+	m_tuning = false;
+	m_tuneReady = false;
+	m_cancelRender = false;
+	m_threadStats = m_pool.getStatsSummary(m_threads);
+	m_kernel.setCancel(&m_cancelRender);
+	m_perturbation.setCancel(&m_cancelRender);
+	m_speculativeKernel.setCancel(&m_cancelRender);
+	m_renderThread = std::thread(&Mandlebrot::renderWorker, this);
+}
+
+Mandlebrot::~Mandlebrot()
+{
+	cancelRender();
+	{
+		std::lock_guard<std::mutex> guard(m_renderLock);
+		m_quit = true;
+	}
+	m_renderWake.notify_all();
+	m_renderThread.join();
+}
+
+/** Asks the render thread for the current view, cancelling any render
+	still running. The frame on screen stays until presentFrame swaps the
+	new one in*/
+void Mandlebrot::computeMandelbrot()
+{
+	//Nothing else touches the kernel or the back frame once this returns,
+	//and the tiles of a render that did not finish are thrown away. A pan
+	//has seen to that already, and its strips take over from the last
+	//step's without waiting for them
+	if (!m_stripsOnly)
+	{
+		cancelRender();
+		presentFrame();
+		m_pipeline.cancel();
+	}
+	double pixelWidth, pixelHeight;
+
+	//Apply aspect ratio to selected area, and see if it is on the lattice
+	//and can share tiles
+	maintainAspectRatio();
+	int level;
+	long long latticeX, latticeY;
+	if (!findOnLattice(level, latticeX, latticeY))
+	{
+		level = -1;
+	}
+
+	//Calculate width and height of pixels, which may be too small for a double
+	FloatExp deepPixelWidth = ((m_coords.right - m_coords.left) / (double)VIEW_WIDTH).toFloatExp();
+	FloatExp deepPixelHeight = ((m_coords.bottom - m_coords.top) / (double)VIEW_HEIGHT).toFloatExp();
+	pixelWidth = deepPixelWidth.toDouble();
+	pixelHeight = deepPixelHeight.toDouble();
+
+	//Keeps the coordinates 64 bits finer than a pixel
+	int limbs = BigFixed::limbsForBits(64 - std::min(deepPixelWidth.e, deepPixelHeight.e));
+	m_coords.left.setFractionLimbs(limbs);
+	m_coords.right.setFractionLimbs(limbs);
+	m_coords.top.setFractionLimbs(limbs);
+	m_coords.bottom.setFractionLimbs(limbs);
+
+	//Picks the cheapest number type that still resolves a pixel, and
+	//perturbation once a double no longer does
+	KernelPrecision nextPrecision = m_kernel.getPrecision();
+	if (m_autoPrecision)
+	{
+		double magnitude = std::max(std::max(std::abs(m_coords.left.toDouble()), std::abs(m_coords.right.toDouble())),
+									std::max(std::abs(m_coords.top.toDouble()), std::abs(m_coords.bottom.toDouble())));
+		KernelPrecision precision = Kernel::choosePrecision(std::min(pixelWidth, pixelHeight), magnitude, m_max_iterations);
+		bool usePerturbation = precision > KernelPrecision::Double;
+		precision = usePerturbation ? KernelPrecision::Double : precision;
+
+		//Pixel states from another number type would not match, and the
+		//strips of a pan may still be using the kernel
+		if (usePerturbation != m_usePerturbation || precision != m_kernel.getPrecision())
+		{
+			++m_stateGeneration;
+			cancelRender();
+			m_usePerturbation = usePerturbation;
+			m_kernel.setPrecision(precision);
+		}
+
+		//What the next level in would be rendered with
+		nextPrecision = Kernel::choosePrecision(std::min(pixelWidth, pixelHeight) / 2.0, magnitude, m_max_iterations);
+	}
+
+	RenderJob job;
+	job.coords = m_coords;
+	job.pixelWidth = deepPixelWidth;
+	job.pixelHeight = deepPixelHeight;
+	job.maxIterations = m_max_iterations;
+	job.fillMode = m_fillMode;
+	job.verifyFill = m_verifyFill;
+	job.usePerturbation = m_usePerturbation;
+	job.threads = m_threads;
+	job.mirrorAxis = findMirrorAxis(deepPixelHeight);
+	job.countHistogram = m_colourMode == ColourMode::Histogram;
+
+	//Works outwards from the focus, or the middle of the view without one
+	job.focusX = m_focusX >= 0 ? m_focusX : VIEW_WIDTH / 2;
+	job.focusY = m_focusY >= 0 ? m_focusY : VIEW_HEIGHT / 2;
+	m_previewPasses = 0;
+	job.etaScale = m_etaScale;
+	m_predictedTime = -1;
+	m_previewTime = -1.0;
+	m_renderClock.restart();
+
+	//A pan asks for only the strips it uncovered, unless perturbation is
+	//taking over, anything else for the whole view
+	if (m_stripsOnly && !m_usePerturbation)
+	{
+		job.strips = m_missingStrips;
+		job.mirrorAxis = -1;
+	}
+	else
+	{
+		m_missingStrips.clear();
+	}
+	m_stripsOnly = false;
+
+	//Tiles are coloured as they finish when their colours depend on
+	//nothing but the palette, and never at full resolution by perturbation,
+	//which may fix glitches in any of them after the last pass. With one
+	//thread colouring would only take turns with the render, so it is left
+	//for the end
+	job.pipelined = m_threads > 1 && job.fillMode == FillMode::BruteForce && m_colourMode == ColourMode::Palette && !m_cycling && job.strips.empty();
+	job.colourVersion = m_colourVersion;
+	if (job.pipelined)
+	{
+		int first, last;
+		getRenderedRows(job.mirrorAxis, first, last);
+		m_pipeline.begin(&m_backFrame, m_palette, job.maxIterations, first, last - first, job.mirrorAxis);
+	}
+
+	//Starts every pixel from scratch after the view changes. A view that
+	//is rendered again, most often for a new limit, is likely to be again,
+	//so only then are states kept to carry on from
+	job.resume = m_frameGeneration == m_stateGeneration;
+	job.keepStates = m_shownGeneration == m_stateGeneration;
+	job.generation = m_stateGeneration;
+
+	//Perturbation's pixels are not cached, nor worked out ahead. A pan's
+	//strips on the lattice are placed on it like the rest of the frame,
+	//but are not whole tiles, so are neither cached nor worked on from
+	job.level = m_usePerturbation ? -1 : level;
+	job.latticeX = latticeX;
+	job.latticeY = latticeY;
+	job.precision = m_kernel.getPrecision();
+	job.isa = m_kernel.getIsa();
+	job.nextPrecision = nextPrecision;
+	job.speculate = job.level >= 0 && job.level < maxCacheLevel && nextPrecision <= KernelPrecision::Double && job.strips.empty();
+
+	//Something is on screen a few ms into a zoom however long the render
+	//takes. It goes first so the render does not hold up the cores
+	if (!job.resume && job.strips.empty())
+	{
+		previewZoom();
+	}
+
+	//A frame the strips taken over from finished meanwhile is of the last
+	//job, its strips are in this one's
+	{
+		std::lock_guard<std::mutex> guard(m_renderLock);
+		m_job = job;
+		m_jobPending = true;
+		m_frameReady = false;
+		m_speculationHeld = false;
+	}
+	m_renderWake.notify_one();
+}
+
+/** Stops the render in progress, if there is one, and any working ahead,
+	and waits for the render thread to let go of the kernel, the pool and
+	the back frame. Pixels give up within a few thousand iterations, so
+	this takes milliseconds. Working ahead stays stopped until the next
+	render is asked for. A frame that finished first is kept for
+	presentFrame*/
+void Mandlebrot::cancelRender()
+{
+	std::unique_lock<std::mutex> guard(m_renderLock);
+	m_jobPending = false;
+	m_tunePending = false;
+	m_speculationHeld = true;
+	m_cancelRender = true;
+	m_renderDone.wait(guard, [this] { return !m_rendering && !m_speculating && !m_tuning; });
+	m_cancelRender = false;
+}
+
+/** Stops the strips of a pan being worked out, and any working ahead,
+	without waiting for the render thread to let go of them. The strips of
+	the next step of the pan take over, and the render thread starts on
+	them as soon as it does. Returns false, stopping nothing, if the last
+	job was not a pan's strips or a tune is under way, which only
+	cancelRender can stop*/
+bool Mandlebrot::cancelStrips()
+{
+	std::lock_guard<std::mutex> guard(m_renderLock);
+	if (m_job.strips.empty() || m_tunePending || m_tuning)
+	{
+		return false;
+	}
+	m_jobPending = false;
+	m_speculationHeld = true;
+	m_cancelRender = true;
+	return true;
+}
+
+/** Swaps in the frame the render thread last finished, if it has not been
+	already, and colours it. Until then shows the passes of a progressive
+	render as they come. Called every time the window is drawn*/
+void Mandlebrot::presentFrame()
+{
+	bool ready, rendering, tuned;
+	{
+		std::lock_guard<std::mutex> guard(m_renderLock);
+		ready = m_frameReady;
+		rendering = m_rendering;
+		tuned = m_tuneReady;
+		m_frameReady = false;
+		m_tuneReady = false;
+	}
+
+	//A tune done meanwhile is put to use, and the view drawn again with it
+	if (tuned)
+	{
+		applyTuning(m_tunedProfile);
+		computeMandelbrot();
+		return;
+	}
+	if (!ready)
+	{
+		//The render thread forgets the progress of the last job before it
+		//counts as rendering the next
+		if (rendering && m_job.pipelined)
+		{
+			uploadTiles();
+		}
+		else if (rendering && m_job.fillMode == FillMode::BruteForce && m_job.strips.empty())
+		{
+			updatePreview();
+		}
+		return;
+	}
+
+	//Uploads the last tiles as they are coloured
+	if (m_job.pipelined)
+	{
+		while (!m_pipeline.isIdle())
+		{
+			uploadTiles();
+			std::this_thread::yield();
+		}
+		uploadTiles();
+	}
+
+	//The render thread is idle until the next job, which only this thread
+	//hands out, so the frames and the job can be touched freely
+	if (m_result.fromStrips)
+	{
+		presentStrips();
+		return;
+	}
+	m_frame.swap(m_backFrame);
+	m_frameGeneration = m_result.fromCache || !m_frame.getStates() ? -1 : m_job.generation;
+	m_mirrorAxis = m_job.mirrorAxis;
+	m_shown = &m_frame;
+	m_shownCoords = m_job.coords;
+	m_shownGeneration = m_job.generation;
+	m_shownIterations = m_job.maxIterations;
+	m_shownAxis = m_mirrorAxis;
+	m_iteratedShare = m_result.iteratedShare;
+	m_filled = m_result.filled;
+	m_fillMismatches = m_result.fillMismatches;
+	m_time = m_result.time;
+	m_threadStats = m_result.threadStats;
+
+	//Logs how far off the prediction was and learns from it
+	m_shownPrediction = m_result.predictedTime;
+	if (m_result.predictedTime >= 0.0)
+	{
+		std::clog << "Render predicted " << (int)m_result.predictedTime << " ms, took " << m_time.asMilliseconds() << " ms\n";
+		m_etaScale += etaLearningRate * (m_result.etaScale - m_etaScale);
+	}
+
+	//A frame every tile of which was coloured with the colours in use is
+	//on screen already
+	if (m_job.pipelined && m_job.colourVersion == m_colourVersion && !m_job.usePerturbation && m_pipeline.isComplete())
+	{
+		m_onScreenTime = m_renderClock.getElapsedTime();
+		recordView();
+		return;
+	}
+
+	//Histogram of the whole frame, which the render counted unless the
+	//colouring changed since
+	if (m_colourMode == ColourMode::Histogram && m_result.counted)
+	{
+		m_histogram.swap(m_renderHistogram);
+	}
+	else if (m_colourMode == ColourMode::Histogram)
+	{
+		m_histogram.count(m_colourPool, m_threads, m_frame.getIterations(), VIEW_WIDTH, VIEW_HEIGHT, (uint32_t)m_shownIterations);
+	}
+
+	colourFrame();
+	showImage(m_frame.getRgba());
+	m_onScreenTime = m_renderClock.getElapsedTime();
+	recordView();
+}
+
+/** Copies the strips a pan asked for into the frame on screen, which
+	holds the rest of the view already, and colours and uploads just them
+	unless the colours depend on the whole frame*/
+void Mandlebrot::presentStrips()
+{
+	for (const FrameTile& strip : m_job.strips)
+	{
+		for (int y = strip.top; y < strip.bottom; ++y)
+		{
+			size_t index = (size_t)y * VIEW_WIDTH + strip.left;
+			std::copy(m_backFrame.getIterations() + index, m_backFrame.getIterations() + index + strip.right - strip.left, m_frame.getIterations() + index);
+			std::copy(m_backFrame.getFractions() + index, m_backFrame.getFractions() + index + strip.right - strip.left, m_frame.getFractions() + index);
+		}
+	}
+	m_missingStrips.clear();
+
+	//The frame keeps no states to carry on from, and its mirrored rows
+	//were worked out like any other
+	m_frameGeneration = -1;
+	m_mirrorAxis = -1;
+	m_shown = &m_frame;
+	m_shownCoords = m_job.coords;
+	m_shownGeneration = m_job.generation;
+	m_shownIterations = m_job.maxIterations;
+	m_shownAxis = -1;
+	m_iteratedShare = m_result.iteratedShare;
+	m_filled = 0.0;
+	m_fillMismatches = 0;
+	m_time = m_result.time;
+	m_threadStats = m_result.threadStats;
+	m_shownPrediction = -1.0;
+
+	if (m_colourMode == ColourMode::Histogram)
+	{
+		m_histogram.count(m_colourPool, m_threads, m_frame.getIterations(), VIEW_WIDTH, VIEW_HEIGHT, (uint32_t)m_shownIterations);
+		colourFrame();
+		showImage(m_frame.getRgba());
+	}
+	else
+	{
+		for (const FrameTile& strip : m_job.strips)
+		{
+			colourTile(strip);
+			uploadArea(m_frame.getRgba() + ((size_t)strip.top * VIEW_WIDTH + strip.left) * 4, VIEW_WIDTH, strip);
+		}
+	}
+	m_onScreenTime = m_renderClock.getElapsedTime();
+	if (m_panning)
+	{
+		m_panUnrecorded = true;
+	}
+	else
+	{
+		recordView();
+	}
+}
+
+/** Adds the frame just put on screen to the history, with its colours
+	unless they are cycling*/
+void Mandlebrot::recordView()
+{
+	m_panUnrecorded = false;
+	HistoryView view = { m_job.coords.left, m_job.coords.right, m_job.coords.top, m_job.coords.bottom, m_job.maxIterations, m_mirrorAxis };
+	m_history.record(view, m_frame, m_cycling ? -1 : m_colourVersion);
+}
+
+/** Puts the view step places back or forward in the history on screen as
+	it was, without rendering it, colouring it again only if the colours
+	have changed since. Going back from a render in progress returns to
+	the view on screen instead. Returns false if there is no such view*/
+bool Mandlebrot::navigate(int step)
+{
+	if (step < 0 && isRendering())
+	{
+		step = 0;
+	}
+	if (!m_history.canMove(step))
+	{
+		return false;
+	}
+	cancelRender();
+	presentFrame();
+	m_pipeline.cancel();
+
+	HistoryView view;
+	bool coloured;
+	m_history.move(step, m_cycling ? -1 : m_colourVersion, view, m_frame, coloured);
+	m_coords.left = view.left;
+	m_coords.right = view.right;
+	m_coords.top = view.top;
+	m_coords.bottom = view.bottom;
+	m_max_iterations = view.maxIterations;
+
+	//The frame keeps no states to carry on from
+	++m_stateGeneration;
+	m_frameGeneration = -1;
+	m_missingStrips.clear();
+	m_mirrorAxis = view.mirrorAxis;
+	m_shown = &m_frame;
+	m_shownCoords = m_coords;
+	m_shownGeneration = m_stateGeneration;
+	m_shownIterations = view.maxIterations;
+	m_shownAxis = m_mirrorAxis;
+
+	if (m_colourMode == ColourMode::Histogram)
+	{
+		m_histogram.count(m_colourPool, m_threads, m_frame.getIterations(), VIEW_WIDTH, VIEW_HEIGHT, (uint32_t)m_shownIterations);
+	}
+	if (!coloured)
+	{
+		colourFrame();
+	}
+	showImage(m_frame.getRgba());
+	return true;
+}
+
+/** Moves the view dx pixels right and dy down on screen, the picture
+	following the mouse. The frame on screen is shifted along with the
+	texture and only the strips it uncovers are worked out, coloured and
+	uploaded. A frame on screen that is not all of the view, from a render
+	cut short or at another limit, is rendered whole instead. Strips of
+	the last step still being worked out are not waited for, they are
+	worked out again with this step's*/
+void Mandlebrot::pan(int dx, int dy)
+{
+	if (dx == 0 && dy == 0)
+	{
+		return;
+	}
+
+	//A render that was not a pan may have uploaded tiles of another frame.
+	//The last step's strips need not be waited for, they go on the list
+	//of strips to work out and this step's render takes over from them
+	bool stripsOnly = !isRendering() || !m_job.strips.empty();
+	if (!stripsOnly || !cancelStrips())
+	{
+		cancelRender();
+	}
+	presentFrame();
+	m_pipeline.cancel();
+	stripsOnly = stripsOnly && m_shown == &m_frame && m_shownGeneration == m_stateGeneration && m_shownIterations == m_max_iterations &&
+				 !m_usePerturbation && std::abs(dx) < VIEW_WIDTH && std::abs(dy) < VIEW_HEIGHT;
+	m_panning = true;
+
+	BigFixed shiftX = BigFixed((double)dx) * ((m_coords.right - m_coords.left) / (double)VIEW_WIDTH);
+	BigFixed shiftY = BigFixed((double)dy) * ((m_coords.bottom - m_coords.top) / (double)VIEW_HEIGHT);
+	m_coords.left = m_coords.left - shiftX;
+	m_coords.right = m_coords.right - shiftX;
+	m_coords.top = m_coords.top - shiftY;
+	m_coords.bottom = m_coords.bottom - shiftY;
+	++m_stateGeneration;
+	if (!stripsOnly)
+	{
+		computeMandelbrot();
+		return;
+	}
+
+	//Moving each plane along by a row per dy and a pixel per dx shifts the
+	//picture, what crosses the side of the view lands in a new strip
+	long long offset = (long long)dy * VIEW_WIDTH + dx;
+	shiftPlane(m_frame.getIterations(), VIEW_WIDTH * VIEW_HEIGHT, offset);
+	shiftPlane(m_frame.getFractions(), VIEW_WIDTH * VIEW_HEIGHT, offset);
+	shiftPlane(m_frame.getRgba(), VIEW_WIDTH * VIEW_HEIGHT * 4, offset * 4);
+	shiftPlane(m_frame.getSlots(), VIEW_WIDTH * VIEW_HEIGHT, offset);
+	m_textureX = ((m_textureX - dx) % VIEW_WIDTH + VIEW_WIDTH) % VIEW_WIDTH;
+	m_textureY = ((m_textureY - dy) % VIEW_HEIGHT + VIEW_HEIGHT) % VIEW_HEIGHT;
+	m_imageSprite.setTextureRect(sf::IntRect(m_textureX, m_textureY, VIEW_WIDTH, VIEW_HEIGHT));
+
+	//Strips still to be worked out move with the picture
+	std::vector<FrameTile> strips;
+	for (FrameTile strip : m_missingStrips)
+	{
+		strip.left = std::max(0, strip.left + dx);
+		strip.right = std::min(VIEW_WIDTH, strip.right + dx);
+		strip.top = std::max(0, strip.top + dy);
+		strip.bottom = std::min(VIEW_HEIGHT, strip.bottom + dy);
+		if (strip.left < strip.right && strip.top < strip.bottom)
+		{
+			strips.push_back(strip);
+		}
+	}
+
+	//Uncovered strips are black until they are worked out
+	std::vector<FrameTile> uncovered;
+	if (dx != 0)
+	{
+		uncovered.push_back(dx > 0 ? FrameTile{ 0, 0, dx, VIEW_HEIGHT } : FrameTile{ VIEW_WIDTH + dx, 0, VIEW_WIDTH, VIEW_HEIGHT });
+	}
+	if (dy != 0)
+	{
+		//Left of or right of the column strip, which has the corner already
+		int left = std::max(0, dx);
+		int right = VIEW_WIDTH + std::min(0, dx);
+		uncovered.push_back(dy > 0 ? FrameTile{ left, 0, right, dy } : FrameTile{ left, VIEW_HEIGHT + dy, right, VIEW_HEIGHT });
+	}
+	for (const FrameTile& strip : uncovered)
+	{
+		uint8_t* rgba = m_frame.getRgba();
+		for (int y = strip.top; y < strip.bottom; ++y)
+		{
+			for (int x = strip.left; x < strip.right; ++x)
+			{
+				uint8_t* pixel = rgba + ((size_t)y * VIEW_WIDTH + x) * 4;
+				pixel[0] = 0;
+				pixel[1] = 0;
+				pixel[2] = 0;
+				pixel[3] = 255;
+			}
+		}
+		uploadArea(rgba + ((size_t)strip.top * VIEW_WIDTH + strip.left) * 4, VIEW_WIDTH, strip);
+		strips.push_back(strip);
+	}
+
+	m_missingStrips = strips;
+	m_frameGeneration = -1;
+	m_shownCoords = m_coords;
+	m_shownGeneration = m_stateGeneration;
+	m_stripsOnly = true;
+	computeMandelbrot();
+}
+
+/** Ends a pan, adding the view it stopped at to the history once it is
+	all on screen*/
+void Mandlebrot::finishPan()
+{
+	m_panning = false;
+	if (m_panUnrecorded && !isRendering())
+	{
+		recordView();
+	}
+}
+
+/** Puts a whole image of the view on screen, from the start of the
+	texture*/
+void Mandlebrot::showImage(const uint8_t* rgba)
+{
+	m_textureX = 0;
+	m_textureY = 0;
+	m_imageTexture.update(rgba);
+	m_imageSprite.setTexture(&m_imageTexture);
+	m_imageSprite.setTextureRect(sf::IntRect(0, 0, VIEW_WIDTH, VIEW_HEIGHT));
+}
+
+/** Uploads the colours of an area of the view, rgba being its top left
+	pixel and its rows stride pixels apart, to where the view is in the
+	texture, in up to four pieces where it wraps round the edges*/
+void Mandlebrot::uploadArea(const uint8_t* rgba, int stride, const FrameTile& area)
+{
+	int left = (area.left + m_textureX) % VIEW_WIDTH;
+	int top = (area.top + m_textureY) % VIEW_HEIGHT;
+	int width = area.right - area.left;
+	int height = area.bottom - area.top;
+	int splitX = std::min(width, VIEW_WIDTH - left);
+	int splitY = std::min(height, VIEW_HEIGHT - top);
+	for (int piece = 0; piece < 4; ++piece)
+	{
+		int firstX = piece & 1 ? splitX : 0;
+		int lastX = piece & 1 ? width : splitX;
+		int firstY = piece & 2 ? splitY : 0;
+		int lastY = piece & 2 ? height : splitY;
+		if (firstX >= lastX || firstY >= lastY)
+		{
+			continue;
+		}
+
+		//Rows of a piece narrower than the source are packed together
+		const uint8_t* pixels = rgba + ((size_t)firstY * stride + firstX) * 4;
+		if (lastX - firstX != stride)
+		{
+			m_uploadRows.resize((size_t)(lastX - firstX) * (lastY - firstY) * 4);
+			for (int y = firstY; y < lastY; ++y)
+			{
+				const uint8_t* row = rgba + ((size_t)y * stride + firstX) * 4;
+				std::copy(row, row + (lastX - firstX) * 4, m_uploadRows.begin() + (size_t)(y - firstY) * (lastX - firstX) * 4);
+			}
+			pixels = m_uploadRows.data();
+		}
+		m_imageTexture.update(pixels, lastX - firstX, lastY - firstY, (left + firstX) % VIEW_WIDTH, (top + firstY) % VIEW_HEIGHT);
+	}
+}
+
+/** Uploads the tiles the pipeline has coloured since the last time, each
+	into its own rectangle of the texture*/
+void Mandlebrot::uploadTiles()
+{
+	PackedTile* packed;
+	while ((packed = m_pipeline.takePacked()) != nullptr)
+	{
+		uploadArea(packed->rgba.data(), packed->width, { packed->left, packed->top, packed->left + packed->width, packed->top + packed->height });
+		m_pipeline.release(packed);
+	}
+}
+
+/** Shows the pixels of a progressive render worked out so far, once a pass
+	finishes and every previewInterval during one. Every pixel takes the
+	value of the nearest one up and left of it on the finest grid its tile
+	has finished, so the picture sharpens tile by tile from the focus. Once
+	the last pass is done the frame is left alone, glitch fixing may still
+	be writing any pixel of it*/
+void Mandlebrot::updatePreview()
+{
+	int passes = m_progressive.getPasses();
+	if (passes == 0 || passes == m_progressive.getPassCount() || (passes == m_previewPasses && m_previewClock.getElapsedTime() < previewInterval))
+	{
+		return;
+	}
+	m_previewPasses = passes;
+	m_previewClock.restart();
+
+	//Mirrored rows are the image of rows that are worked out, so the
+	//preview itself needs no mirroring
+	const int axis = m_job.mirrorAxis;
+	int first, last;
+	getRenderedRows(axis, first, last);
+	m_colourPool.run(VIEW_HEIGHT, m_threads, [this, axis, first](int y)
+	{
+		int row = (isMirrored(axis, y) ? axis - y : y) - first;
+		const uint32_t* bands = m_backFrame.getIterations();
+		const uint16_t* fractions = m_backFrame.getFractions();
+		uint32_t* previewBands = m_preview.getIterations() + y * VIEW_WIDTH;
+		uint16_t* previewFractions = m_preview.getFractions() + y * VIEW_WIDTH;
+		for (int x = 0; x < VIEW_WIDTH; ++x)
+		{
+			int step = m_progressive.getTileStep(ThreadPool::findTile(x, row, VIEW_WIDTH));
+			size_t source = (size_t)(first + row - row % step) * VIEW_WIDTH + x - x % step;
+			previewBands[x] = bands[source];
+			previewFractions[x] = fractions[source];
+		}
+	});
+
+	m_shown = &m_preview;
+	m_shownCoords = m_job.coords;
+	m_shownGeneration = -1;
+	m_shownIterations = m_job.maxIterations;
+	m_shownAxis = -1;
+	if (m_colourMode == ColourMode::Histogram)
+	{
+		m_histogram.count(m_colourPool, m_threads, m_preview.getIterations(), VIEW_WIDTH, VIEW_HEIGHT, (uint32_t)m_shownIterations);
+	}
+
+	colourFrame();
+	showImage(m_preview.getRgba());
+}
+
+/** Sets the pixel a render works outwards from, or the middle of the view
+	if x is negative*/
+void Mandlebrot::setFocus(int x, int y)
+{
+	m_focusX = x < 0 ? -1 : std::min(x, VIEW_WIDTH - 1);
+	m_focusY = x < 0 ? -1 : std::max(0, std::min(y, VIEW_HEIGHT - 1));
+	m_cursorX = m_focusX;
+	m_cursorY = m_focusY;
+}
+
+/** Returns whether a render or tune has been asked for and not finished
+	yet*/
+bool Mandlebrot::isRendering()
+{
+	std::lock_guard<std::mutex> guard(m_renderLock);
+	return m_jobPending || m_rendering || m_tunePending || m_tuning;
+}
+
+/** Runs on the render thread, rendering each job handed over into the back
+	frame until the Mandlebrot is destroyed. Cancelled renders are dropped.
+	In between it works out tiles ahead, a few at a time, and looks for
+	more now and then once it runs out*/
+void Mandlebrot::renderWorker()
+{
+	std::unique_lock<std::mutex> guard(m_renderLock);
+	bool ahead = false;
+	for (;;)
+	{
+		if (!ahead)
+		{
+			m_renderWake.wait_for(guard, speculationInterval, [this] { return m_jobPending || m_tunePending || m_quit; });
+		}
+		if (m_quit)
+		{
+			return;
+		}
+
+		//Tunes with the kernel and pool renders use, cancelled the same way
+		if (!m_jobPending && m_tunePending)
+		{
+			m_tunePending = false;
+			m_tuning = true;
+			guard.unlock();
+
+			Tuner tuner;
+			TuningProfile profile = tuner.tune(m_kernel, m_pool);
+			std::clog << tuner.getReport();
+			if (!tuner.wasCancelled() && !Tuner::save(tuningProfilePath, profile))
+			{
+				std::clog << "Could not write " << tuningProfilePath << "\n";
+			}
+
+			guard.lock();
+			m_tuning = false;
+			m_tuneReady = !tuner.wasCancelled();
+			m_tunedProfile = profile;
+			m_renderDone.notify_all();
+			ahead = false;
+			continue;
+		}
+		if (!m_jobPending)
+		{
+			ahead = false;
+			if (!m_speculationHeld)
+			{
+				m_speculating = true;
+				guard.unlock();
+				ahead = speculate();
+				guard.lock();
+				m_speculating = false;
+				m_renderDone.notify_all();
+			}
+			continue;
+		}
+		RenderJob job = m_job;
+
+		//Forgets the progress of the last render before this one counts as
+		//started, the focus being in the rows that are worked out
+		if (job.fillMode == FillMode::BruteForce && job.strips.empty())
+		{
+			int first, last;
+			getRenderedRows(job.mirrorAxis, first, last);
+			int focusY = isMirrored(job.mirrorAxis, job.focusY) ? job.mirrorAxis - job.focusY : job.focusY;
+			m_progressive.begin(VIEW_WIDTH, last - first, job.focusX, focusY - first);
+		}
+		//A cancel before now was for the job this one took over from
+		m_jobPending = false;
+		m_rendering = true;
+		m_frameReady = false;
+		m_cancelRender = false;
+		guard.unlock();
+
+		RenderResult result;
+		bool finished = renderFrame(job, result);
+
+		guard.lock();
+		m_rendering = false;
+		if (finished && !m_jobPending)
+		{
+			m_result = result;
+			m_frameReady = true;
+		}
+		m_renderDone.notify_all();
+		ahead = finished;
+	}
+}
+
+/** Renders a job into the back frame. Returns false if it was cancelled
+	part way, leaving the back frame half done*/
+bool Mandlebrot::renderFrame(const RenderJob& job, RenderResult& result)
+{
+	//Timing, the prediction counts from here
+	m_renderTimer.restart();
+	m_pool.resetStats();
+
+	//A pan works out only the strips it uncovered, cut into a few rows
+	//each so the pool shares them
+	if (!job.strips.empty())
+	{
+		std::vector<FrameTile> pieces;
+		for (const FrameTile& strip : job.strips)
+		{
+			for (int top = strip.top; top < strip.bottom; top += stripRows)
+			{
+				pieces.push_back({ strip.left, top, strip.right, std::min(strip.bottom, top + stripRows) });
+			}
+		}
+		int iterated = computeAreas(job, pieces, m_backFrame);
+		if (m_cancelRender)
+		{
+			return false;
+		}
+		result.iteratedShare = iterated / (double)(VIEW_WIDTH * VIEW_HEIGHT);
+		result.filled = 0.0;
+		result.fillMismatches = 0;
+		result.time = m_renderTimer.getElapsedTime();
+		result.threadStats = m_pool.getStatsSummary(job.threads);
+		result.predictedTime = -1.0;
+		result.etaScale = job.etaScale;
+		result.fromCache = false;
+		result.fromStrips = true;
+		result.counted = false;
+		return true;
+	}
+
+	//Takes every pixel it can from tiles worked out before, and only works
+	//out the rest. A render carrying on from the frame on screen has all
+	//the cache could give it in the states already
+	std::vector<const CachedTile*> tiles;
+	int cached = job.resume ? 0 : findCachedTiles(job, tiles);
+	result.fromCache = cached > 0;
+	result.fromStrips = false;
+
+	//Carries on from where the frame on screen left each pixel, which
+	//costs a copy of the states. Nothing writes them on the window thread.
+	//Pixels taken from the cache need none, and keep none to carry on from
+	int first, last;
+	getRenderedRows(job.mirrorAxis, first, last);
+	int iterated = 0;
+	if (cached > 0)
+	{
+		m_backFrame.keepStates(false);
+		fillFromCache(job, tiles, m_backFrame);
+		iterated = computeMissing(job, tiles, m_backFrame, first, last);
+	}
+	else
+	{
+		m_backFrame.keepStates(job.keepStates);
+		if (job.resume)
+		{
+			m_backFrame.copyStates(m_frame);
+		}
+		else
+		{
+			m_backFrame.resetStates();
+		}
+		iterated = computePixels(job, job.fillMode, m_backFrame, first, last - first, true);
+	}
+	if (m_cancelRender)
+	{
+		return false;
+	}
+
+	//Copies the worked out rows into their mirror images
+	if (job.mirrorAxis >= 0)
+	{
+		m_pool.run(VIEW_HEIGHT, job.threads, [this, &job](int y) { mirrorRow(m_backFrame, job.mirrorAxis, y); });
+	}
+
+	//Histogram of the whole frame, mirrored rows included. The passes of
+	//a brute force render counted each tile as they finished it, frames
+	//filled any other way are counted once they are done
+	result.counted = job.countHistogram;
+	if (job.countHistogram && countsTiles(job) && cached == 0)
+	{
+		m_renderHistogram.finish(m_pool, job.threads);
+	}
+	else if (job.countHistogram)
+	{
+		m_renderHistogram.count(m_pool, job.threads, m_backFrame.getIterations(), VIEW_WIDTH, VIEW_HEIGHT, (uint32_t)job.maxIterations);
+	}
+
+	//Works out every pixel from scratch as well and counts the ones the
+	//fill strategy got wrong, by more than a band or inside for outside
+	result.fillMismatches = 0;
+	bool verify = job.verifyFill && (job.fillMode != FillMode::BruteForce || job.mirrorAxis >= 0);
+	if (verify)
+	{
+		FrameBuffer check;
+		check.create(VIEW_WIDTH, VIEW_HEIGHT);
+		computePixels(job, FillMode::BruteForce, check, 0, VIEW_HEIGHT, false);
+		if (m_cancelRender)
+		{
+			return false;
+		}
+
+		const uint32_t* bands = m_backFrame.getIterations();
+		const uint32_t* expected = check.getIterations();
+		for (int i = 0; i < VIEW_WIDTH * VIEW_HEIGHT; ++i)
+		{
+			bool inside = bands[i] == job.maxIterations;
+			bool expectedInside = expected[i] == job.maxIterations;
+			result.fillMismatches += inside != expectedInside || std::abs(m_backFrame.getMu(i) - check.getMu(i)) > 1.0 ? 1 : 0;
+		}
+	}
+
+	//Gets rendering time
+	result.iteratedShare = iterated / (double)(VIEW_WIDTH * VIEW_HEIGHT);
+	result.filled = job.fillMode == FillMode::Subdivision ? m_subdivision.getSkipped() : m_boundaryTrace.getSkipped();
+	result.time = m_renderTimer.getElapsedTime();
+	result.threadStats = m_pool.getStatsSummary(job.threads);
+
+	//Scale that would have predicted the time after the probe exactly. A
+	//check against every pixel is not part of the prediction, and renders
+	//with next to nothing left after the probe say little about the scale
+	result.predictedTime = -1.0;
+	result.etaScale = job.etaScale;
+	if (job.fillMode == FillMode::BruteForce && !verify && cached == 0)
+	{
+		double rest = m_costMap.predictRemaining();
+		result.predictedTime = m_predictedTime;
+		if (rest >= etaLearningMinimum)
+		{
+			result.etaScale = (result.time.asSeconds() * 1000.0 - m_probeFinished) / rest;
+		}
+	}
+
+	//Keeps the frame's tiles and works out the next level in ahead from it
+	storeTiles(job, m_backFrame);
+	planSpeculation(job);
+	return true;
+}
+
+/** Works out height rows of a job's view from firstRow down into a frame,
+	with the kernel or by perturbation, leaving the choice of pixels to the
+	fill strategy. Every pixel is worked out progressively if asked, which
+	m_progressive must have begun for. Returns the number of pixels
+	iterated*/
+int Mandlebrot::computePixels(const RenderJob& job, FillMode mode, FrameBuffer& frame, int firstRow, int height, bool progressive)
+{
+	const Dimensions& coords = job.coords;
+	PixelRenderer pixels;
+	pixels.setOutput(&frame, firstRow, height, job.maxIterations);
+
+	if (job.usePerturbation)
+	{
+		//Iterates around the centre of the rows
+		BigFixed centreRe = (coords.left + coords.right) / 2.0;
+		BigFixed centreIm = coords.top + BigFixed(job.pixelHeight * FloatExp(firstRow + height / 2.0), coords.top.getFractionLimbs());
+		m_perturbation.beginRender(centreRe, centreIm, job.pixelWidth, job.pixelHeight, VIEW_WIDTH, height, job.maxIterations,
+								   nullptr, frame.getStates() ? frame.getStates() + firstRow * VIEW_WIDTH : nullptr, VIEW_WIDTH);
+		pixels.setPerturbation(&m_perturbation);
+	}
+	else if (job.level >= 0)
+	{
+		pixels.setLattice(&m_kernel, job.level, job.latticeX, job.latticeY);
+	}
+	else
+	{
+		pixels.setKernel(&m_kernel, coords.left.toDoubleDouble(), coords.top.toDoubleDouble(), job.pixelWidth.toDouble(), job.pixelHeight.toDouble());
+	}
+
+	//Hands each tile of a pipelined render on to be coloured as it
+	//finishes, the last pass of a perturbation render excepted, and counts
+	//it into the histogram once its last pass is done
+	std::function<void(int, int)> finished;
+	const bool count = progressive && mode == FillMode::BruteForce && countsTiles(job);
+	if (count)
+	{
+		m_renderHistogram.begin(job.threads, (uint32_t)job.maxIterations);
+	}
+	if ((job.pipelined || count) && progressive)
+	{
+		finished = [this, &job, &frame, firstRow, height, count](int tile, int step)
+		{
+			if (job.pipelined && (step > 1 || !job.usePerturbation))
+			{
+				m_pipeline.pushTile(tile, step);
+			}
+			if (count && step == 1)
+			{
+				countTile(job, frame, firstRow, height, tile);
+			}
+		};
+	}
+
+	switch (mode)
+	{
+	case FillMode::Subdivision:
+		m_subdivision.render(pixels, job.threads);
+		break;
+	case FillMode::BoundaryTrace:
+		m_boundaryTrace.render(pixels, job.threads);
+		break;
+	default:
+		//Probes what every pixel costs first, for how long the render
+		//should take and to start the threads on tiles of equal cost. The
+		//passes of a progressive render share out the tiles as they go
+		m_costMap.probe(pixels, m_pool, job.threads);
+		if (progressive)
+		{
+			m_probeFinished = m_renderTimer.getElapsedTime().asSeconds() * 1000.0;
+			m_predictedTime = (int)(m_probeFinished + job.etaScale * m_costMap.predictRemaining());
+			m_progressive.render(pixels, m_pool, job.threads, finished);
+		}
+		else
+		{
+			pixels.computeTiles(m_pool, job.threads, m_costMap.getTileCosts());
+		}
+		break;
+	}
+
+	pixels.finish(job.threads);
+
+	return pixels.getIterated();
+}
+
+/** Gives the rows first to last - 1 that are worked out for a mirror axis,
+	the rest are the mirror image of rows the other side of the real axis*/
+void Mandlebrot::getRenderedRows(int axis, int& first, int& last)
+{
+	first = 0;
+	last = VIEW_HEIGHT;
+	if (axis >= 0 && axis < VIEW_HEIGHT)
+	{
+		first = (axis + 1) / 2;
+	}
+	else if (axis >= 0)
+	{
+		last = axis / 2 + 1;
+	}
+}
+
+/** Looks up the cached tiles covering a job's view, row after row of
+	them with nullptr for those not cached, reading those the cache lacks
+	from the store. Returns the number of the view's pixels they hold*/
+int Mandlebrot::findCachedTiles(const RenderJob& job, std::vector<const CachedTile*>& tiles)
+{
+	m_loadedTiles.clear();
+	m_loadedKeys.clear();
+	if (job.level < 0)
+	{
+		return 0;
+	}
+	++m_latticeViews;
+
+	int cached = 0;
+	long long lastX = TileCache::findTile(job.latticeX + VIEW_WIDTH - 1, cacheTileWidth);
+	long long lastY = TileCache::findTile(job.latticeY + VIEW_HEIGHT - 1, cacheTileHeight);
+	for (long long tileY = TileCache::findTile(job.latticeY, cacheTileHeight); tileY <= lastY; ++tileY)
+	{
+		for (long long tileX = TileCache::findTile(job.latticeX, cacheTileWidth); tileX <= lastX; ++tileX)
+		{
+			TileKey key = { job.level, tileX, tileY, job.maxIterations, job.precision, job.isa };
+			const CachedTile* tile = m_tileCache.find(key);
+			if (!tile)
+			{
+				m_loadedTiles.emplace_back();
+				if (m_tileStore.load(key, m_loadedTiles.back()))
+				{
+					tile = &m_loadedTiles.back();
+					m_loadedKeys.push_back(key);
+				}
+				else
+				{
+					m_loadedTiles.pop_back();
+				}
+			}
+			if (tile)
+			{
+				FrameTile area = getCacheTileArea(job, tiles.size());
+				cached += (area.right - area.left) * (area.bottom - area.top);
+			}
+			tiles.push_back(tile);
+		}
+	}
+
+	if (cached == VIEW_WIDTH * VIEW_HEIGHT)
+	{
+		++m_instantViews;
+	}
+	return cached;
+}
+
+/** Returns the part of a job's view the index'th of the tiles covering it
+	takes up, in the view's pixels*/
+FrameTile Mandlebrot::getCacheTileArea(const RenderJob& job, size_t index)
+{
+	long long firstX = TileCache::findTile(job.latticeX, cacheTileWidth);
+	long long columns = TileCache::findTile(job.latticeX + VIEW_WIDTH - 1, cacheTileWidth) - firstX + 1;
+	long long originX = (firstX + (long long)index % columns) * cacheTileWidth - job.latticeX;
+	long long originY = (TileCache::findTile(job.latticeY, cacheTileHeight) + (long long)index / columns) * cacheTileHeight - job.latticeY;
+
+	FrameTile area;
+	area.left = (int)std::max(0LL, originX);
+	area.right = (int)std::min((long long)VIEW_WIDTH, originX + cacheTileWidth);
+	area.top = (int)std::max(0LL, originY);
+	area.bottom = (int)std::min((long long)VIEW_HEIGHT, originY + cacheTileHeight);
+	return area;
+}
+
+/** Copies the pixels of the cached tiles findCachedTiles found into a
+	frame, and caches those it read from the store*/
+void Mandlebrot::fillFromCache(const RenderJob& job, const std::vector<const CachedTile*>& tiles, FrameBuffer& frame)
+{
+	for (size_t i = 0; i < tiles.size(); ++i)
+	{
+		const CachedTile* tile = tiles[i];
+		if (!tile)
+		{
+			continue;
+		}
+
+		//Where the area starts in the tile, which may stick out of the view
+		FrameTile area = getCacheTileArea(job, i);
+		int offsetX = (int)((job.latticeX + area.left) % cacheTileWidth + cacheTileWidth) % cacheTileWidth;
+		int offsetY = (int)((job.latticeY + area.top) % cacheTileHeight + cacheTileHeight) % cacheTileHeight;
+		for (int y = area.top; y < area.bottom; ++y)
+		{
+			int source = (y - area.top + offsetY) * cacheTileWidth + offsetX;
+			size_t index = y * VIEW_WIDTH + area.left;
+			std::copy(tile->bands.begin() + source, tile->bands.begin() + source + area.right - area.left, frame.getIterations() + index);
+			std::copy(tile->fractions.begin() + source, tile->fractions.begin() + source + area.right - area.left, frame.getFractions() + index);
+		}
+	}
+
+	for (size_t i = 0; i < m_loadedTiles.size(); ++i)
+	{
+		m_tileCache.store(m_loadedKeys[i], m_loadedTiles[i].bands.data(), m_loadedTiles[i].fractions.data(), cacheTileWidth, false);
+	}
+	m_loadedTiles.clear();
+	m_loadedKeys.clear();
+}
+
+/** Works out the pixels of rows firstRow to lastRow - 1 of a job's view
+	that the cached tiles findCachedTiles found do not hold, a missing tile
+	at a time on the pool. With most of the view cached that is quicker
+	than the probe and passes of a progressive render. Returns the number
+	of pixels iterated*/
+int Mandlebrot::computeMissing(const RenderJob& job, const std::vector<const CachedTile*>& tiles, FrameBuffer& frame, int firstRow, int lastRow)
+{
+	std::vector<FrameTile> missing;
+	for (size_t i = 0; i < tiles.size(); ++i)
+	{
+		FrameTile area = getCacheTileArea(job, i);
+		area.top = std::max(area.top, firstRow);
+		area.bottom = std::min(area.bottom, lastRow);
+		if (!tiles[i] && area.top < area.bottom)
+		{
+			missing.push_back(area);
+		}
+	}
+	return computeAreas(job, missing, frame);
+}
+
+/** Works out every pixel of some areas of a job's view into a frame, an
+	area at a time on the pool. Returns the number of pixels iterated*/
+int Mandlebrot::computeAreas(const RenderJob& job, const std::vector<FrameTile>& areas, FrameBuffer& frame)
+{
+	PixelRenderer pixels;
+	pixels.setOutput(&frame, 0, VIEW_HEIGHT, job.maxIterations);
+	if (job.level >= 0)
+	{
+		pixels.setLattice(&m_kernel, job.level, job.latticeX, job.latticeY);
+	}
+	else
+	{
+		pixels.setKernel(&m_kernel, job.coords.left.toDoubleDouble(), job.coords.top.toDoubleDouble(), job.pixelWidth.toDouble(), job.pixelHeight.toDouble());
+	}
+	PixelState* states = frame.getStates();
+	m_pool.run((int)areas.size(), job.threads, [&](int i)
+	{
+		const FrameTile& area = areas[i];
+		for (int y = area.top; y < area.bottom; ++y)
+		{
+			if (states)
+			{
+				std::fill(states + y * VIEW_WIDTH + area.left, states + y * VIEW_WIDTH + area.right, PixelState());
+			}
+			pixels.computeLine(area.left, y, area.right - area.left, false);
+		}
+	});
+	return pixels.getIterated();
+}
+
+/** Caches the tiles of a finished frame on the lattice that lie wholly
+	inside it. Only frames with every pixel worked out are kept, the fill
+	strategies' guesses are not*/
+void Mandlebrot::storeTiles(const RenderJob& job, FrameBuffer& frame)
+{
+	if (job.level < 0 || job.fillMode != FillMode::BruteForce)
+	{
+		return;
+	}
+	long long lastX = TileCache::findTile(job.latticeX + VIEW_WIDTH, cacheTileWidth) - 1;
+	long long lastY = TileCache::findTile(job.latticeY + VIEW_HEIGHT, cacheTileHeight) - 1;
+	for (long long tileY = TileCache::findTile(job.latticeY + cacheTileHeight - 1, cacheTileHeight); tileY <= lastY; ++tileY)
+	{
+		for (long long tileX = TileCache::findTile(job.latticeX + cacheTileWidth - 1, cacheTileWidth); tileX <= lastX; ++tileX)
+		{
+			size_t index = (size_t)(tileY * cacheTileHeight - job.latticeY) * VIEW_WIDTH + (size_t)(tileX * cacheTileWidth - job.latticeX);
+			keepTile({ job.level, tileX, tileY, job.maxIterations, job.precision, job.isa }, frame.getIterations() + index, frame.getFractions() + index,
+					 VIEW_WIDTH, false);
+		}
+	}
+}
+
+/** Caches a tile's pixels, taken from rows stride pixels apart, and
+	writes them to the store if the cache did not have them already. Ahead
+	marks a tile worked out before a render asked for it*/
+void Mandlebrot::keepTile(const TileKey& key, const uint32_t* bands, const uint16_t* fractions, int stride, bool ahead)
+{
+	if (m_tileCache.store(key, bands, fractions, stride, ahead))
+	{
+		m_tileStore.save(key, bands, fractions, stride);
+	}
+}
+
+/** Returns whether the cache has a tile, reading it from the store into
+	the cache if it is only there*/
+bool Mandlebrot::recallTile(const TileKey& key)
+{
+	if (m_tileCache.contains(key))
+	{
+		return true;
+	}
+	CachedTile tile;
+	if (!m_tileStore.load(key, tile))
+	{
+		return false;
+	}
+	m_tileCache.store(key, tile.bands.data(), tile.fractions.data(), cacheTileWidth, false);
+	return true;
+}
+
+/** Works out which tiles of the next level in to work out ahead of a
+	finished frame, ranked by how many neighbouring pixels of the part of
+	the frame they cover differ in band, so the most detailed go first*/
+void Mandlebrot::planSpeculation(const RenderJob& job)
+{
+	m_speculationPlanned = job.speculate;
+	m_detailTiles.clear();
+	m_nextDetailTile = 0;
+	if (!job.speculate)
+	{
+		return;
+	}
+	m_nextLevel = { job.level + 1, job.latticeX * 2, job.latticeY * 2, job.maxIterations, job.nextPrecision, job.isa };
+	m_speculationThreads = job.threads;
+
+	const uint32_t* bands = m_backFrame.getIterations();
+	std::vector<std::pair<int, TileKey>> ranked;
+	long long lastX = TileCache::findTile(m_nextLevel.x + 2 * VIEW_WIDTH - 1, cacheTileWidth);
+	long long lastY = TileCache::findTile(m_nextLevel.y + 2 * VIEW_HEIGHT - 1, cacheTileHeight);
+	for (long long tileY = TileCache::findTile(m_nextLevel.y, cacheTileHeight); tileY <= lastY; ++tileY)
+	{
+		for (long long tileX = TileCache::findTile(m_nextLevel.x, cacheTileWidth); tileX <= lastX; ++tileX)
+		{
+			//The tile covers half as many pixels of this frame each way
+			long long originX = tileX * cacheTileWidth - m_nextLevel.x;
+			long long originY = tileY * cacheTileHeight - m_nextLevel.y;
+			int left = (int)std::max(0LL, originX / 2);
+			int right = (int)std::min((long long)VIEW_WIDTH, (originX + cacheTileWidth + 1) / 2);
+			int top = (int)std::max(0LL, originY / 2);
+			int bottom = (int)std::min((long long)VIEW_HEIGHT, (originY + cacheTileHeight + 1) / 2);
+
+			int detail = 0;
+			for (int y = top; y < bottom; ++y)
+			{
+				const uint32_t* row = bands + y * VIEW_WIDTH;
+				for (int x = left; x < right; ++x)
+				{
+					detail += (x + 1 < VIEW_WIDTH && row[x] != row[x + 1]) + (y + 1 < VIEW_HEIGHT && row[x] != row[x + VIEW_WIDTH]);
+				}
+			}
+			if (detail > 0)
+			{
+				TileKey key = m_nextLevel;
+				key.x = tileX;
+				key.y = tileY;
+				ranked.push_back(std::make_pair(detail, key));
+			}
+		}
+	}
+
+	std::stable_sort(ranked.begin(), ranked.end(),
+					 [](const std::pair<int, TileKey>& a, const std::pair<int, TileKey>& b) { return a.first > b.first; });
+	for (const auto& tile : ranked)
+	{
+		m_detailTiles.push_back(tile.second);
+	}
+}
+
+/** Works out a batch of tiles of the next level in ahead of being asked
+	for, a tile per thread, the nearest the cursor first and then the most
+	detailed. Gives up with the rest of a render when one is asked for.
+	Returns false once there is nothing left to work out*/
+bool Mandlebrot::speculate()
+{
+	if (!m_speculationPlanned)
+	{
+		return false;
+	}
+	std::vector<TileKey> batch;
+	size_t batchSize = std::max(1, m_speculationThreads);
+
+	//Tiles the next level's view about the cursor would need, the view a
+	//zoom in on it would most likely ask for
+	int cursorX = m_cursorX;
+	int cursorY = m_cursorY;
+	if (cursorX >= 0)
+	{
+		long long centreX = m_nextLevel.x + 2 * cursorX + 1;
+		long long centreY = m_nextLevel.y + 2 * cursorY + 1;
+		std::vector<std::pair<long long, TileKey>> nearest;
+		long long lastX = TileCache::findTile(centreX + VIEW_WIDTH / 2, cacheTileWidth);
+		long long lastY = TileCache::findTile(centreY + VIEW_HEIGHT / 2, cacheTileHeight);
+		for (long long tileY = TileCache::findTile(centreY - VIEW_HEIGHT / 2, cacheTileHeight); tileY <= lastY; ++tileY)
+		{
+			for (long long tileX = TileCache::findTile(centreX - VIEW_WIDTH / 2, cacheTileWidth); tileX <= lastX; ++tileX)
+			{
+				TileKey key = m_nextLevel;
+				key.x = tileX;
+				key.y = tileY;
+				if (!recallTile(key))
+				{
+					long long dx = tileX * cacheTileWidth + cacheTileWidth / 2 - centreX;
+					long long dy = tileY * cacheTileHeight + cacheTileHeight / 2 - centreY;
+					nearest.push_back(std::make_pair(dx * dx + dy * dy, key));
+				}
+			}
+		}
+		std::sort(nearest.begin(), nearest.end(),
+				  [](const std::pair<long long, TileKey>& a, const std::pair<long long, TileKey>& b) { return a.first < b.first; });
+		for (size_t i = 0; i < nearest.size() && batch.size() < batchSize; ++i)
+		{
+			batch.push_back(nearest[i].second);
+		}
+	}
+
+	while (batch.size() < batchSize && m_nextDetailTile < m_detailTiles.size())
+	{
+		const TileKey& key = m_detailTiles[m_nextDetailTile++];
+		if (!recallTile(key) && std::find(batch.begin(), batch.end(), key) == batch.end())
+		{
+			batch.push_back(key);
+		}
+	}
+	if (batch.empty())
+	{
+		return false;
+	}
 
-	//Set aspect ratio
-	m_aspectRatio = VIEW_WIDTH / VIEW_HEIGHT;
+	//Each tile is worked out on its own into a frame of its own
+	m_speculativeKernel.setIsa(m_nextLevel.isa);
+	m_speculativeKernel.setPrecision(m_nextLevel.precision);
+	while (m_speculationFrames.size() < batch.size())
+	{
+		m_speculationFrames.emplace_back();
+		m_speculationFrames.back().create(cacheTileWidth, cacheTileHeight);
+	}
+	m_pool.run((int)batch.size(), m_speculationThreads, [&](int i)
+	{
+		const TileKey& key = batch[i];
+		FrameBuffer& frame = m_speculationFrames[i];
+		frame.resetStates();
 
-	//Initialise image rectangle
-	m_imageSprite.setSize(sf::Vector2f(VIEW_WIDTH, VIEW_HEIGHT));
-	m_imageTexture.loadFromImage(m_image);
-	m_imageSprite.setTexture(&m_imageTexture);
-}
+		PixelRenderer pixels;
+		pixels.setOutput(&frame, 0, cacheTileHeight, key.maxIterations);
+		pixels.setLattice(&m_speculativeKernel, key.level, key.x * cacheTileWidth, key.y * cacheTileHeight);
+		for (int y = 0; y < cacheTileHeight; ++y)
+		{
+			pixels.computeLine(0, y, cacheTileWidth, false);
+		}
+	});
 
-Mandlebrot::~Mandlebrot()
-{
+	//Tiles a render cut short are left out
+	if (m_cancelRender)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < batch.size(); ++i)
+	{
+		keepTile(batch[i], m_speculationFrames[i].getIterations(), m_speculationFrames[i].getFractions(), cacheTileWidth, true);
+		++m_speculatedTiles;
+	}
+	return true;
 }
 
-/** Computes mandlebrot set*/
-void Mandlebrot::computeMandelbrot()
+/** Returns the row a such that rows y and a - y of the view are mirror
+	images in the real axis, or -1 if the view has no such rows. The rows
+	must line up to a millionth of a pixel, views merely close to
+	symmetric are worked out in full*/
+int Mandlebrot::findMirrorAxis(FloatExp pixelHeight)
 {
-	//Local variables for timing and pixels
-	sf::Clock timer;
-	double pixelWidth, pixelHeight;
+	//Row y is centred on top + (y + 0.5) * pixelHeight, so a - y is centred
+	//on its conjugate when a = height - 1 - (top + bottom) / pixelHeight
+	double offset = ((m_coords.top + m_coords.bottom).toFloatExp() / pixelHeight).toDouble();
+	if (std::abs(offset) > VIEW_HEIGHT)
+	{
+		return -1;
+	}
+	double axis = VIEW_HEIGHT - 1 - offset;
+	double row = std::floor(axis + 0.5);
+	if (std::abs(axis - row) > mirrorTolerance)
+	{
+		return -1;
+	}
 
-	//Apply aspect ratio to selected area
-	maintainAspectRatio();
+	//Needs at least one pair of different rows inside the view
+	int mirror = (int)row;
+	return mirror >= 1 && mirror <= 2 * VIEW_HEIGHT - 3 ? mirror : -1;
+}
 
-	//Calculate width and height of pixels
-	pixelWidth = (m_coords.right - m_coords.left) / (double)VIEW_WIDTH;
-	pixelHeight = (m_coords.bottom - m_coords.top) / (double)VIEW_HEIGHT;
+/** Counts the pixels of a finished tile of rows firstRow on into the
+	render's histogram, rows with a mirror image in the view twice. Called
+	from the task that finished it*/
+void Mandlebrot::countTile(const RenderJob& job, FrameBuffer& frame, int firstRow, int height, int tile)
+{
+	FrameTile area = ThreadPool::getTile(tile, VIEW_WIDTH, height);
+	for (int y = firstRow + area.top; y < firstRow + area.bottom; ++y)
+	{
+		int mirror = job.mirrorAxis - y;
+		bool mirrored = mirror >= 0 && mirror < VIEW_HEIGHT && isMirrored(job.mirrorAxis, mirror);
+		m_renderHistogram.add(frame.getIterations() + y * VIEW_WIDTH + area.left, area.right - area.left, mirrored ? 2 : 1);
+	}
+}
 
-	
-#pragma omp parallel for schedule(dynamic) num_threads(m_threads)
+/** Copies the worked out row a mirrored row of a frame is the image of,
+	with z conjugated. Copied perturbation deltas are never resumed, since
+	the same view mirrors the same rows again*/
+void Mandlebrot::mirrorRow(FrameBuffer& frame, int axis, int y)
+{
+	if (!isMirrored(axis, y))
+	{
+		return;
+	}
+	int row = y * VIEW_WIDTH;
+	int source = (axis - y) * VIEW_WIDTH;
+	std::copy(frame.getFractions() + source, frame.getFractions() + source + VIEW_WIDTH, frame.getFractions() + row);
+	std::copy(frame.getIterations() + source, frame.getIterations() + source + VIEW_WIDTH, frame.getIterations() + row);
+	PixelState* states = frame.getStates();
+	if (!states)
+	{
+		return;
+	}
 	for (int x = 0; x < VIEW_WIDTH; ++x)
 	{
-		for (int y = 0; y < VIEW_HEIGHT; ++y)
-		{
-			// Work out the point in the complex plane that
-			// corresponds to this pixel in the output image.
-			complex<double> c(m_coords.left + ((x + 0.5f) * pixelWidth), m_coords.top + ((y + 0.5f) * pixelHeight));
+		states[row + x] = states[source + x];
+		states[row + x].zi = -states[row + x].zi;
+	}
+}
 
-			int iterations = 0;
+/** Returns a / b, which may each be too small for a double*/
+static double divide(const FloatExp& a, const FloatExp& b)
+{
+	return b.m == 0.0 ? 0.0 : std::ldexp(a.m / b.m, a.e - b.e);
+}
 
-			complex<double> z(0.0, 0.0);
+/** Puts the part of the frame on screen a zoom in will show on screen
+	straight away, stretched over the view, for the render to replace as
+	its pixels come. Escaped pixels take mu interpolated between the four
+	nearest, the rest that of the nearest, so the set keeps its edge.
+	Views no deeper than the one on screen, or centred outside it, are
+	left to the render*/
+void Mandlebrot::previewZoom()
+{
+	FloatExp shownWidth = (m_shownCoords.right - m_shownCoords.left).toFloatExp();
+	FloatExp shownHeight = (m_shownCoords.bottom - m_shownCoords.top).toFloatExp();
+	double scaleX = divide((m_coords.right - m_coords.left).toFloatExp(), shownWidth);
+	double scaleY = divide((m_coords.bottom - m_coords.top).toFloatExp(), shownHeight);
+	double originX = divide((m_coords.left - m_shownCoords.left).toFloatExp(), shownWidth) * VIEW_WIDTH;
+	double originY = divide((m_coords.top - m_shownCoords.top).toFloatExp(), shownHeight) * VIEW_HEIGHT;
+	double centreX = originX + scaleX * VIEW_WIDTH / 2.0;
+	double centreY = originY + scaleY * VIEW_HEIGHT / 2.0;
+	if (!(scaleX < 1.0 && scaleY < 1.0 && centreX >= 0.0 && centreX <= VIEW_WIDTH && centreY >= 0.0 && centreY <= VIEW_HEIGHT))
+	{
+		return;
+	}
 
-			// Iterate z = z^2 + c until z moves more than 2 units
-			// away from (0, 0), or we've iterated too many times.
-			while (abs(z) < 2.0 && iterations < m_max_iterations)
-			{
-				z = (z * z) + c;
+	//A preview on screen is stretched in turn, from m_frame, which the
+	//render will not carry on from
+	if (m_shown == &m_preview)
+	{
+		m_frame.swap(m_preview);
+		m_frameGeneration = -1;
+	}
 
-				++iterations;
-			}
-			if (iterations == m_max_iterations)
-			{
-				//Updates mu vector and image
-				m_mu[x][y] = iterations;
-				m_image.setPixel(x, y, sf::Color::Black);
-			}
-			// z escaped within less than MAX_ITERATIONS
-			// iterations. This point isn't in the set.
-			else
-			{
-				//Updates mu vector
-				m_mu[x][y] = iterations - (std::log(2) / std::log(std::abs(z)));
+	//Pixels of the frame on screen each column of the view falls between,
+	//and how far it is from the first, the edges clamped to the frame
+	std::vector<int> columns(VIEW_WIDTH);
+	std::vector<double> weights(VIEW_WIDTH);
+	for (int x = 0; x < VIEW_WIDTH; ++x)
+	{
+		double source = std::max(0.0, std::min(VIEW_WIDTH - 1.0, originX + (x + 0.5) * scaleX - 0.5));
+		columns[x] = std::min((int)source, VIEW_WIDTH - 2);
+		weights[x] = source - columns[x];
+	}
 
-				//Updates image
-				m_image.setPixel(x, y, colourGradient(m_mu[x][y]));
+	const uint32_t limit = (uint32_t)m_shownIterations;
+	m_colourPool.run(VIEW_HEIGHT, m_threads, [&](int y)
+	{
+		double source = std::max(0.0, std::min(VIEW_HEIGHT - 1.0, originY + (y + 0.5) * scaleY - 0.5));
+		int row = std::min((int)source, VIEW_HEIGHT - 2);
+		double weightY = source - row;
+		const uint32_t* bands = m_frame.getIterations();
+		size_t index = (size_t)y * VIEW_WIDTH;
+		for (int x = 0; x < VIEW_WIDTH; ++x, ++index)
+		{
+			size_t corner = (size_t)row * VIEW_WIDTH + columns[x];
+			double weightX = weights[x];
+			if (bands[corner] == limit || bands[corner + 1] == limit || bands[corner + VIEW_WIDTH] == limit || bands[corner + VIEW_WIDTH + 1] == limit)
+			{
+				size_t nearest = corner + (weightY >= 0.5 ? VIEW_WIDTH : 0) + (weightX >= 0.5 ? 1 : 0);
+				m_preview.getIterations()[index] = bands[nearest];
+				m_preview.getFractions()[index] = m_frame.getFractions()[nearest];
+				continue;
 			}
+			double top = m_frame.getMu(corner) + weightX * (m_frame.getMu(corner + 1) - m_frame.getMu(corner));
+			double bottom = m_frame.getMu(corner + VIEW_WIDTH) + weightX * (m_frame.getMu(corner + VIEW_WIDTH + 1) - m_frame.getMu(corner + VIEW_WIDTH));
+			double mu = top + weightY * (bottom - top);
+			m_preview.setMu(index, (uint32_t)std::ceil(mu), mu);
 		}
-	}
+	});
 
-	//Gets rendering time
-	m_time = timer.getElapsedTime();
-	m_imageTexture.update(m_image);
-	m_imageSprite.setTexture(&m_imageTexture);
+	m_shown = &m_preview;
+	m_shownCoords = m_coords;
+	m_shownGeneration = -1;
+	m_shownAxis = -1;
+	if (m_colourMode == ColourMode::Histogram)
+	{
+		m_histogram.count(m_colourPool, m_threads, m_preview.getIterations(), VIEW_WIDTH, VIEW_HEIGHT, limit);
+	}
+	colourFrame();
+	showImage(m_preview.getRgba());
+	m_previewTime = m_renderClock.getElapsedTime().asSeconds() * 1000.0;
 }
 
-/** Takes in mu factor and calculates colour using sine waves*/
-sf::Color Mandlebrot::colourGradient(double mu)
+/** Colours the frame on screen through the palette a tile at a time, so
+	each thread writes whole rows of pixels, then copies the mirrored rows*/
+void Mandlebrot::colourFrame()
 {
-	sf::Color colourRgb;
-
-	//Uses sine waves to calculate rgb value
-	colourRgb.r = (sin(m_frequencyOne * mu + 0) * 127 + 128);
-	colourRgb.b = (sin(m_frequencyTwo * mu + 2) * 127 + 128);
-	colourRgb.g = (sin(m_frequencyThree * mu + 4) * 127 + 128);
-
-	return colourRgb;
+	int tiles = ThreadPool::countTiles(VIEW_WIDTH, VIEW_HEIGHT);
+	m_colourPool.run(tiles, m_threads, [this](int tile) { colourTile(ThreadPool::getTile(tile, VIEW_WIDTH, VIEW_HEIGHT)); });
+	if (m_shownAxis >= 0)
+	{
+		m_colourPool.run(VIEW_HEIGHT, m_threads, [this](int y) { mirrorColours(y); });
+	}
 }
 
-/** Updates colours based on new frequencies*/
-void Mandlebrot::updateColourGradient()
+/** Colours a tile of the image from its bands and mu values, black where
+	the band is the limit. Mirrored rows are left for mirrorColours, since
+	the rows they copy may be in another tile*/
+void Mandlebrot::colourTile(const FrameTile& tile)
 {
-#pragma omp parallel for num_threads(6)		
-	for (int x = 0; x < VIEW_WIDTH; ++x)
+	for (int y = tile.top; y < tile.bottom; ++y)
 	{
-		for (int y = 0; y < VIEW_HEIGHT; ++y)
+		if (isMirrored(m_shownAxis, y))
 		{
-			//Checks if pixel is black 
-			if (m_image.getPixel(x, y) != sf::Color::Black)
-			{
-				//Updates image with new colouring
-				m_image.setPixel(x, y, colourGradient(m_mu[x][y]));
-			}
-			else
-			{
-			//Colours pixel black
-			m_image.setPixel(x, y, sf::Color::Black);
-			}
+			continue;
+		}
+		int start = y * VIEW_WIDTH + tile.left;
+		if (m_cycling)
+		{
+			//Slots first, so the next steps of the cycle only look them up
+			m_palette.indexPixels(m_shown->getIterations() + start, m_shown->getFractions() + start, tile.right - tile.left, (uint32_t)m_shownIterations,
+								  m_colourMode == ColourMode::Histogram ? &m_histogram : nullptr, m_shown->getSlots() + start);
+			m_palette.expandCycle(m_shown->getSlots() + start, tile.right - tile.left, m_shown->getRgba() + start * 4);
+		}
+		else if (m_colourMode == ColourMode::Histogram)
+		{
+			m_palette.colourEqualised(m_shown->getIterations() + start, m_shown->getFractions() + start, tile.right - tile.left,
+									  (uint32_t)m_shownIterations, m_histogram, m_shown->getRgba() + start * 4);
+		}
+		else
+		{
+			m_palette.colourPixels(m_shown->getIterations() + start, m_shown->getFractions() + start, tile.right - tile.left,
+								   (uint32_t)m_shownIterations, m_shown->getRgba() + start * 4);
 		}
 	}
+}
+
+/** Copies the colours and palette slots of the row a mirrored row is the
+	image of*/
+void Mandlebrot::mirrorColours(int y)
+{
+	if (!isMirrored(m_shownAxis, y))
+	{
+		return;
+	}
+	uint8_t* rgba = m_shown->getRgba();
+	std::copy(rgba + (m_shownAxis - y) * VIEW_WIDTH * 4, rgba + (m_shownAxis - y + 1) * VIEW_WIDTH * 4, rgba + y * VIEW_WIDTH * 4);
+	uint16_t* slots = m_shown->getSlots();
+	std::copy(slots + (m_shownAxis - y) * VIEW_WIDTH, slots + (m_shownAxis - y + 1) * VIEW_WIDTH, slots + y * VIEW_WIDTH);
+}
+
+/** Rebakes the palette for new frequencies and recolours the frame from
+	the mu values already worked out*/
+void Mandlebrot::updateColourGradient()
+{
+	m_palette.build(m_frequencyOne, m_frequencyTwo, m_frequencyThree);
+	m_palette.buildCycle(m_cyclePhase);
+	++m_colourVersion;
+	colourFrame();
+
 	//Loads new image to our display rectangle
-	m_imageTexture.update(m_image);
-	m_imageSprite.setTexture(&m_imageTexture);
+	showImage(m_shown->getRgba());
 }
 
 /** Adjusts selected area to fit aspect ratio*/
@@ -157,6 +1733,70 @@ void Mandlebrot::maintainAspectRatio()
 	}
 }
 
+/** Finds the level of the lattice the view is on and the lattice pixel of
+	its top left corner. Returns false for views whose pixels do not line up
+	with the lattice's, to a millionth of a pixel, and for views wider than
+	the home view or deeper than the lattice goes. The view is left as it
+	is either way*/
+bool Mandlebrot::findOnLattice(int& level, long long& x, long long& y)
+{
+	double width = (m_coords.right - m_coords.left).toDouble();
+	double nearest = std::floor(std::log2(latticeWidth / width) + 0.5);
+	if (!(nearest >= 0.0 && nearest <= maxCacheLevel))
+	{
+		return false;
+	}
+	level = (int)nearest;
+
+	//Each edge in lattice pixels, which must all be whole numbers
+	DoubleDouble pixelWidth = TileCache::getPixelWidth(level);
+	DoubleDouble pixelHeight = TileCache::getPixelHeight(level);
+	DoubleDouble edges[] = { (m_coords.left.toDoubleDouble() - DoubleDouble(latticeLeft)) / pixelWidth,
+							 (m_coords.right.toDoubleDouble() - DoubleDouble(latticeLeft)) / pixelWidth,
+							 (m_coords.top.toDoubleDouble() - DoubleDouble(latticeTop)) / pixelHeight,
+							 (m_coords.bottom.toDoubleDouble() - DoubleDouble(latticeTop)) / pixelHeight };
+	long long pixels[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		pixels[i] = TileCache::roundToLattice(edges[i]);
+		if (std::abs((edges[i] - TileCache::toDoubleDouble(pixels[i])).hi) > latticeTolerance)
+		{
+			return false;
+		}
+	}
+	x = pixels[0];
+	y = pixels[2];
+	return pixels[1] - x == VIEW_WIDTH && pixels[3] - y == VIEW_HEIGHT;
+}
+
+/** Moves a view zoomed to onto the nearest view of the lattice, so its
+	tiles can be cached, worked out ahead and kept in the store. Views
+	wider than the home view or deeper than the lattice goes are left as
+	they are*/
+void Mandlebrot::moveOntoLattice()
+{
+	maintainAspectRatio();
+	int level;
+	long long x, y;
+	if (!TileCache::findNearestView(((m_coords.left + m_coords.right) / 2.0).toDoubleDouble(), ((m_coords.top + m_coords.bottom) / 2.0).toDoubleDouble(),
+									(m_coords.right - m_coords.left).toDouble(), level, x, y))
+	{
+		return;
+	}
+
+	//Double doubles fit in 128 bits below the point down to the deepest level
+	int limbs = BigFixed::limbsForBits(128);
+	auto toBigFixed = [limbs](const DoubleDouble& value) { return BigFixed(value.hi, limbs) + BigFixed(value.lo, limbs); };
+	DoubleDouble pixelWidth = TileCache::getPixelWidth(level);
+	DoubleDouble pixelHeight = TileCache::getPixelHeight(level);
+	DoubleDouble left = DoubleDouble(latticeLeft) + TileCache::toDoubleDouble(x) * pixelWidth;
+	DoubleDouble top = DoubleDouble(latticeTop) + TileCache::toDoubleDouble(y) * pixelHeight;
+	m_coords.left = toBigFixed(left);
+	m_coords.right = toBigFixed(left + DoubleDouble((double)VIEW_WIDTH) * pixelWidth);
+	m_coords.top = toBigFixed(top);
+	m_coords.bottom = toBigFixed(top + DoubleDouble((double)VIEW_HEIGHT) * pixelHeight);
+}
+
 /** Renders mandlebrot image*/
 void Mandlebrot::render(sf::RenderWindow * hwnd)
 {
@@ -174,10 +1814,14 @@ void Mandlebrot::resetResolution()
 	m_coords.right = 0.5;
 	m_coords.top = -1.15;
 	m_coords.bottom = 1.15;
+	++m_stateGeneration;
 
 	m_frequencyOne = 0.3;
 	m_frequencyTwo = 0.3;
 	m_frequencyThree = 0.3;
+	m_palette.build(m_frequencyOne, m_frequencyTwo, m_frequencyThree);
+	m_palette.buildCycle(m_cyclePhase);
+	++m_colourVersion;
 }
 
 /** Increases resolution*/
@@ -190,10 +1834,11 @@ void Mandlebrot::increaseResolution(float dt)
 	if (m_elapsedTime >= m_resolutionIncrementSpeed)
 	{
 
-		//Increase resolution 
-		if (m_max_iterations < iterationsCap) {
+		//Increase resolution, in steps that grow with it so a limit in
+		//the millions can be reached
+		if (m_max_iterations < m_iterationsCap) {
 
-			m_max_iterations += 1;
+			m_max_iterations = std::min(m_iterationsCap, m_max_iterations + std::max(1LL, m_max_iterations / resolutionStepDivisor));
 
 		}
 
@@ -214,7 +1859,7 @@ void Mandlebrot::decreaseResolution(float dt)
 		//Decrease resolution
 		if (m_max_iterations > 0) {
 
-			m_max_iterations -= 1;
+			m_max_iterations -= std::max(1LL, m_max_iterations / resolutionStepDivisor);
 
 		}
 
@@ -298,6 +1943,190 @@ void Mandlebrot::decreaseThreads(float dt)
 	}
 }
 
+/** Switches to the next instruction set for the kernel*/
+void Mandlebrot::nextKernelIsa()
+{
+	cancelRender();
+	m_kernel.nextIsa();
+}
+
+/** Applies the scheduling settings tuned for this machine, if there are
+	any. Returns false for a profile tuned on another processor or number
+	of cores, which wants autoTune*/
+bool Mandlebrot::loadTuning()
+{
+	TuningProfile profile;
+	if (!Tuner::load(tuningProfilePath, profile))
+	{
+		return true;
+	}
+
+	if (!Tuner::isForThisMachine(profile))
+	{
+		std::clog << "Tuning profile is for " << profile.cpu << ", " << profile.cores << " cores, tuning again\n";
+		return false;
+	}
+	applyTuning(profile);
+	return true;
+}
+
+/** Has the render thread render the calibration views with every setting
+	the tuner tries and keep the best for this machine, which takes a few
+	seconds. It is put to use and the view drawn again once it is done,
+	unless a render asked for meanwhile cancels it*/
+void Mandlebrot::autoTune()
+{
+	cancelRender();
+	{
+		std::lock_guard<std::mutex> guard(m_renderLock);
+		m_tunePending = true;
+	}
+	m_renderWake.notify_all();
+}
+
+/** Uses a profile's thread count, instruction set and tile size*/
+void Mandlebrot::applyTuning(const TuningProfile& profile)
+{
+	cancelRender();
+	m_threads = std::max(1, std::min(profile.threads, m_threadCap));
+	m_kernel.setIsa(profile.isa);
+	ThreadPool::setTileSize(profile.tileWidth, profile.tileHeight);
+	m_tuned = true;
+}
+
+/** Steps from automatic precision through each fixed tier, then
+	perturbation, and back*/
+void Mandlebrot::nextPrecision()
+{
+	cancelRender();
+	++m_stateGeneration;
+
+	if (m_autoPrecision)
+	{
+		m_autoPrecision = false;
+		m_usePerturbation = false;
+		m_kernel.setPrecision(KernelPrecision::Float);
+	}
+	else if (m_usePerturbation)
+	{
+		m_usePerturbation = false;
+		m_autoPrecision = true;
+	}
+	else if (m_kernel.getPrecision() == KernelPrecision::DoubleDouble)
+	{
+		m_usePerturbation = true;
+	}
+	else
+	{
+		KernelPrecision next = (KernelPrecision)((int)m_kernel.getPrecision() + 1);
+
+		//Long double is just double on some compilers
+		if (next == KernelPrecision::LongDouble && !Kernel::hasExtendedLongDouble())
+		{
+			next = KernelPrecision::DoubleDouble;
+		}
+		m_kernel.setPrecision(next);
+	}
+}
+
+/** Switches between iterating every pixel, subdivision and boundary tracing*/
+void Mandlebrot::nextFillMode()
+{
+	switch (m_fillMode)
+	{
+	case FillMode::BruteForce:
+		m_fillMode = FillMode::Subdivision;
+		break;
+	case FillMode::Subdivision:
+		m_fillMode = FillMode::BoundaryTrace;
+		break;
+	default:
+		m_fillMode = FillMode::BruteForce;
+		break;
+	}
+
+	//Filled pixels carry no z to resume from
+	++m_stateGeneration;
+}
+
+/** Turns checking the fill strategy against every pixel on or off*/
+void Mandlebrot::toggleFillCheck()
+{
+	m_verifyFill = !m_verifyFill;
+	m_fillMismatches = 0;
+}
+
+/** Starts or stops the colours cycling, and recolours the frame. While
+	cycling every pixel's slot in the loop of colours is kept, and only
+	the loop moves*/
+void Mandlebrot::toggleCycling()
+{
+	m_cycling = !m_cycling;
+	m_cyclePhase = 0.0f;
+	updateColourGradient();
+}
+
+/** Moves the colours along by dt seconds while cycling. Each step is a
+	rebuild of the loop and one lookup per pixel from its slot, mu and
+	the histogram are not looked at*/
+void Mandlebrot::cycleColours(float dt)
+{
+	if (!m_cycling)
+	{
+		return;
+	}
+	m_cyclePhase += cycleSpeed * dt;
+	m_palette.buildCycle(m_cyclePhase);
+	m_colourPool.run(VIEW_HEIGHT, m_threads, [this](int y)
+	{
+		m_palette.expandCycle(m_shown->getSlots() + y * VIEW_WIDTH, VIEW_WIDTH, m_shown->getRgba() + y * VIEW_WIDTH * 4);
+	});
+	showImage(m_shown->getRgba());
+}
+
+/** Switches between colouring by mu and by histogram, and recolours the
+	frame. The histogram is counted here the first time, after that every
+	render counts it*/
+void Mandlebrot::toggleColourMode()
+{
+	m_colourMode = m_colourMode == ColourMode::Palette ? ColourMode::Histogram : ColourMode::Palette;
+	if (m_colourMode == ColourMode::Histogram)
+	{
+		m_histogram.count(m_colourPool, m_threads, m_shown->getIterations(), VIEW_WIDTH, VIEW_HEIGHT, (uint32_t)m_shownIterations);
+	}
+	updateColourGradient();
+}
+
+/** Moves the view to a centre and width given as decimals, which can
+	carry as many digits as a deep zoom needs*/
+void Mandlebrot::setLocation(const string& re, const string& im, const string& width)
+{
+	BigFixed centreRe(re);
+	BigFixed centreIm(im);
+	BigFixed halfWidth = BigFixed(width) / 2.0;
+	BigFixed halfHeight = halfWidth / m_aspectRatio;
+
+	m_coords.left = centreRe - halfWidth;
+	m_coords.right = centreRe + halfWidth;
+	m_coords.top = centreIm - halfHeight;
+	m_coords.bottom = centreIm + halfHeight;
+	++m_stateGeneration;
+}
+
+/** Sets how high the iteration limit may be raised*/
+void Mandlebrot::setIterationsCap(long long cap)
+{
+	m_iterationsCap = std::max(1LL, cap);
+	m_max_iterations = std::min(m_max_iterations, m_iterationsCap);
+}
+
+/** Sets how many MB the tile cache may take, the least recently used
+	tiles go once it is over*/
+void Mandlebrot::setCacheBudget(long long megabytes)
+{
+	m_tileCache.setBudget((size_t)std::max(0LL, megabytes) << 20);
+}
+
 /** Returns current resolution for display*/
 string Mandlebrot::getResolution()
 {
@@ -319,6 +2148,89 @@ string Mandlebrot::getLastRenderingTime()
 	return ss.str();
 }
 
+/** Returns what the cost map predicted the frame on screen would take
+	for display, nothing if it was not predicted*/
+string Mandlebrot::getPredictedTime()
+{
+	std::stringstream ss;
+	if (m_shownPrediction >= 0.0)
+	{
+		ss << ", predicted " << (int)m_shownPrediction << " ms";
+	}
+	return ss.str();
+}
+
+/** Returns how long the frame on screen took to be all on screen for
+	display*/
+string Mandlebrot::getOnScreenTime()
+{
+	std::stringstream ss;
+	ss << ", on screen after " << m_onScreenTime.asMilliseconds() << " ms";
+	if (m_previewTime >= 0.0)
+	{
+		ss << ", preview after " << (int)m_previewTime << " ms";
+	}
+	return ss.str();
+}
+
+/** Returns how full the queues between the stages of the last pipelined
+	render got for display*/
+string Mandlebrot::getPipelineStats()
+{
+	return m_pipeline.getStats();
+}
+
+/** Returns how many tiles the render thread has worked out ahead, how
+	many of them renders went on to use, and how many views were on screen
+	straight from the cache for display*/
+string Mandlebrot::getSpeculation()
+{
+	std::stringstream ss;
+	ss << "Worked ahead: " << m_tileCache.getAheadUsed() << " of " << m_speculatedTiles << " tiles used, " << m_instantViews << " of " << m_latticeViews
+	   << " views instant\n";
+	return ss.str();
+}
+
+/** Returns how often renders found their tiles cached, how much memory
+	the cache takes and what the store read and wrote for display*/
+string Mandlebrot::getTileCacheStats()
+{
+	return m_tileCache.getStats() + m_tileStore.getStats();
+}
+
+/** Returns how many views the history holds and the memory they take for
+	display*/
+string Mandlebrot::getHistoryStats()
+{
+	return m_history.getStats();
+}
+
+/** Returns how long the render in progress should take yet for display*/
+string Mandlebrot::getTimeLeft()
+{
+	//The prediction counts from when the render was asked for
+	int predicted = m_predictedTime;
+	std::stringstream ss;
+	bool tuning;
+	{
+		std::lock_guard<std::mutex> guard(m_renderLock);
+		tuning = m_tunePending || m_tuning;
+	}
+	if (tuning)
+	{
+		ss << "Tuning...";
+	}
+	else if (predicted < 0)
+	{
+		ss << "Rendering...";
+	}
+	else
+	{
+		ss << "Rendering, about " << std::max(0, predicted - m_renderClock.getElapsedTime().asMilliseconds()) << " ms left";
+	}
+	return ss.str();
+}
+
 /** Returns current colour frequencies for display*/
 string Mandlebrot::getColourFrequencies()
 {
@@ -326,6 +2238,7 @@ string Mandlebrot::getColourFrequencies()
 	std::stringstream ss;
 	ss.precision(3);
 	ss << "Colour frequency one: " << m_frequencyOne << "\n" << "Colour frequency two: " << m_frequencyTwo << "\n" << "Colour frequency three: " << m_frequencyThree << "\n";
+	ss << "Colouring: " << (m_colourMode == ColourMode::Histogram ? "histogram" : "palette") << (m_cycling ? ", cycling" : "") << "\n";
 	string str = ss.str();
 	return ss.str();
 }
@@ -340,10 +2253,91 @@ string Mandlebrot::getNumberOfThreads()
 	return ss.str();
 }
 
+/** Returns how busy the threads were over the last render*/
+string Mandlebrot::getThreadStats()
+{
+	return m_threadStats;
+}
 
+/** Returns kernel instruction set for display*/
+string Mandlebrot::getKernelIsa()
+{
+	//Returns instruction set for performance text
+	std::stringstream ss;
+	ss << "Kernel: " << m_kernel.getIsaName() << "\n";
+	return ss.str();
+}
 
+/** Returns where the scheduling settings came from for display*/
+string Mandlebrot::getTuning()
+{
+	std::stringstream ss;
+	ss << "Tiles: " << ThreadPool::getTileWidth() << "x" << ThreadPool::getTileHeight() << (m_tuned ? ", tuned for this machine" : ", untuned") << "\n";
+	return ss.str();
+}
 
+/** Returns precision tier for display*/
+string Mandlebrot::getPrecision()
+{
+	//Returns precision tier for performance text
+	std::stringstream ss;
+	ss << "Precision: " << (m_usePerturbation ? "perturbation" : Kernel::getPrecisionName(m_kernel.getPrecision())) << (m_autoPrecision ? " (auto)" : "") << "\n";
+	return ss.str();
+}
 
+/** Returns the width of the view for display*/
+string Mandlebrot::getZoomWidth()
+{
+	//Splits the binary exponent into a decimal one by hand, as the width
+	//can be far smaller than a double holds
+	FloatExp width = (m_coords.right - m_coords.left).toFloatExp();
+	double digits = std::log10(std::abs(width.m)) + width.e * std::log10(2.0);
+	double exponent = std::floor(digits);
 
+	std::stringstream ss;
+	ss.precision(3);
+	ss << "Zoom width: " << std::pow(10.0, digits - exponent) << "e" << (int)exponent << "\n";
+	return ss.str();
+}
 
+/** Returns the share of pixels the last render iterated for display*/
+string Mandlebrot::getIteratedPixels()
+{
+	//Raising the limit on the same view only carries on unfinished pixels
+	std::stringstream ss;
+	ss << std::fixed;
+	ss.precision(1);
+	ss << "Pixels iterated: " << 100.0 * m_iteratedShare << "%";
+	if (m_mirrorAxis >= 0)
+	{
+		ss << ", mirrored about the real axis";
+	}
+	ss << "\n";
+	return ss.str();
+}
 
+/** Returns the fill strategy for display*/
+string Mandlebrot::getFillMode()
+{
+	//Returns fill strategy, and the check against every pixel if it is on
+	std::stringstream ss;
+	ss << std::fixed;
+	ss.precision(1);
+	switch (m_fillMode)
+	{
+	case FillMode::Subdivision:
+		ss << "Fill: subdivision, " << 100.0 * m_filled << "% filled\n";
+		break;
+	case FillMode::BoundaryTrace:
+		ss << "Fill: boundary tracing, " << 100.0 * m_filled << "% filled\n";
+		break;
+	default:
+		ss << "Fill: every pixel\n";
+		break;
+	}
+	if (m_verifyFill && m_fillMode != FillMode::BruteForce)
+	{
+		ss << "Fill check: " << m_fillMismatches << " pixels differ\n";
+	}
+	return ss.str();
+}
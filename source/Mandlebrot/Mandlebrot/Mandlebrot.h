@@ -1,10 +1,31 @@
 #pragma once
 #include "Constants.h"
+#include "Kernel.h"
+#include "BigFixed.h"
+#include "Perturbation.h"
+#include "PixelRenderer.h"
+#include "Subdivision.h"
+#include "BoundaryTrace.h"
+#include "ThreadPool.h"
+#include "Palette.h"
+#include "Histogram.h"
+#include "Progressive.h"
+#include "CostMap.h"
+#include "Tuner.h"
+#include "TilePipeline.h"
+#include "TileCache.h"
+#include "TileStore.h"
+#include "ViewHistory.h"
 #include <SFML/Graphics.hpp>
 #include <complex>
 #include <vector>
+#include <deque>
+#include <algorithm>
 #include <string>
 #include <iostream>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 #include <omp.h>
 
@@ -20,24 +41,111 @@ private:
 
 	struct Dimensions {
 
-		double left = -2.0;
-		double right = 0.5;
-		double top = -1.15;
-		double bottom = 1.15;
+		BigFixed left = -2.0;
+		BigFixed right = 0.5;
+		BigFixed top = -1.15;
+		BigFixed bottom = 1.15;
 
 	};
 
 	//Holds the image dimensions
 	Dimensions m_coords;
 
+	//Everything a render works from, copied when it is asked for so the
+	//view and settings can change while it runs
+	struct RenderJob {
+
+		Dimensions coords;
+		FloatExp pixelWidth, pixelHeight;
+		long long maxIterations;
+		FillMode fillMode;
+		bool verifyFill;
+		bool usePerturbation;
+		int threads;
+		int mirrorAxis;
+		int focusX, focusY;
+
+		//What the time the cost map predicts is scaled by
+		double etaScale;
+
+		//Tiles are coloured and uploaded as they finish, with the colours
+		//of this version
+		bool pipelined;
+		int colourVersion;
+
+		//Carries on from the states of the frame on screen, and keeps
+		//states of its own to be carried on from
+		bool resume;
+		bool keepStates;
+		int generation;
+
+		//Level of the lattice the view is on and the lattice pixel of its
+		//top left corner, level -1 for a view off it. The kernel settings
+		//its tiles are cached under, and the precision the next level
+		//would take, for working it out ahead
+		int level;
+		long long latticeX, latticeY;
+		KernelPrecision precision;
+		KernelIsa isa;
+		bool speculate;
+		KernelPrecision nextPrecision;
+
+		//Areas of the view a pan uncovered, the only pixels worked out when
+		//there are any, the rest being in the frame on screen already
+		std::vector<FrameTile> strips;
+
+		//The frame is coloured by histogram, which the render counts
+		bool countHistogram;
+
+	};
+
+	//What a finished render found, for display
+	struct RenderResult {
+
+		double iteratedShare;
+		double filled;
+		int fillMismatches;
+		sf::Time time;
+		string threadStats;
+
+		//Time the cost map predicted in ms, or -1 for none, and the scale
+		//that would have got it right
+		double predictedTime;
+		double etaScale;
+
+		//Some pixels came from cached tiles, which keep no states to
+		//carry on from
+		bool fromCache;
+
+		//Only the strips a pan uncovered were worked out, the rest of the
+		//view is in the frame on screen
+		bool fromStrips;
+
+		//The histogram of the frame is in m_renderHistogram
+		bool counted;
+
+	};
+
 public:
 	Mandlebrot();
 	~Mandlebrot();
 
 	void computeMandelbrot();
-	sf::Color colourGradient(double mu);
+	void cancelRender();
+	void presentFrame();
+	void updatePreview();
+	void uploadTiles();
+	bool isRendering();
+	bool navigate(int step);
+	void pan(int dx, int dy);
+	void finishPan();
+	int findMirrorAxis(FloatExp pixelHeight);
+	void colourFrame();
+	void colourTile(const FrameTile& tile);
+	void mirrorColours(int y);
 	void updateColourGradient();
 	void maintainAspectRatio();
+	void moveOntoLattice();
 	void render(sf::RenderWindow* hwnd);
 	void resetResolution();
 	void increaseResolution(float dt);
@@ -46,41 +154,266 @@ public:
 	void decreaseColourFrequency(char key, float dt);
 	void increaseThreads(float dt);
 	void decreaseThreads(float dt);
+	void nextKernelIsa();
+	bool loadTuning();
+	void autoTune();
+	void applyTuning(const TuningProfile& profile);
+	void nextPrecision();
+	void nextFillMode();
+	void toggleFillCheck();
+	void toggleColourMode();
+	void toggleCycling();
+	void cycleColours(float dt);
+	void setLocation(const string& re, const string& im, const string& width);
+	void setFocus(int x, int y);
+	void setIterationsCap(long long cap);
+	void setCacheBudget(long long megabytes);
 	string getResolution();
 	string getLastRenderingTime();
+	string getPredictedTime();
+	string getOnScreenTime();
+	string getTimeLeft();
 	string getColourFrequencies();
 	string getNumberOfThreads();
+	string getThreadStats();
+	string getPipelineStats();
+	string getSpeculation();
+	string getTileCacheStats();
+	string getHistoryStats();
+	string getKernelIsa();
+	string getTuning();
+	string getPrecision();
+	string getZoomWidth();
+	string getIteratedPixels();
+	string getFillMode();
 
 	Dimensions getMbrotDimensions() { return m_coords; };
-	void setMbrotDimensions(double left, double right, double top, double bottom) { m_coords.left = left;
+	void setMbrotDimensions(BigFixed left, BigFixed right, BigFixed top, BigFixed bottom) { m_coords.left = left;
 																					m_coords.right = right;
 																					m_coords.top = top;
 																					m_coords.bottom = bottom;
+																					++m_stateGeneration;
 																				  };
 private:
+	void renderWorker();
+	bool cancelStrips();
+	bool renderFrame(const RenderJob& job, RenderResult& result);
+	int computePixels(const RenderJob& job, FillMode mode, FrameBuffer& frame, int firstRow, int height, bool progressive);
+	static void getRenderedRows(int axis, int& first, int& last);
+	bool findOnLattice(int& level, long long& x, long long& y);
+	int findCachedTiles(const RenderJob& job, std::vector<const CachedTile*>& tiles);
+	static FrameTile getCacheTileArea(const RenderJob& job, size_t index);
+	void fillFromCache(const RenderJob& job, const std::vector<const CachedTile*>& tiles, FrameBuffer& frame);
+	int computeMissing(const RenderJob& job, const std::vector<const CachedTile*>& tiles, FrameBuffer& frame, int firstRow, int lastRow);
+	int computeAreas(const RenderJob& job, const std::vector<FrameTile>& areas, FrameBuffer& frame);
+	void storeTiles(const RenderJob& job, FrameBuffer& frame);
+	void keepTile(const TileKey& key, const uint32_t* bands, const uint16_t* fractions, int stride, bool ahead);
+	bool recallTile(const TileKey& key);
+	void planSpeculation(const RenderJob& job);
+	bool speculate();
+	void mirrorRow(FrameBuffer& frame, int axis, int y);
+	void countTile(const RenderJob& job, FrameBuffer& frame, int firstRow, int height, int tile);
+	void previewZoom();
+	void presentStrips();
+	void showImage(const uint8_t* rgba);
+	void uploadArea(const uint8_t* rgba, int stride, const FrameTile& area);
+	void recordView();
+
+	//Escape time kernel
+	Kernel m_kernel;
+
+	//Deep zoom engine for views past the reach of a double
+	Perturbation m_perturbation;
+
+	//Picks the precision tier from the zoom depth when set
+	bool m_autoPrecision;
+
+	//Renders with m_perturbation instead of m_kernel
+	bool m_usePerturbation;
+
+	//Fill strategy, and whether to check it against every pixel
+	FillMode m_fillMode;
+	Subdivision m_subdivision;
+	BoundaryTrace m_boundaryTrace;
+	bool m_verifyFill;
+	int m_fillMismatches;
+	double m_filled;
+
+	//Rows y and axis - y are mirror images in the real axis, and the ones
+	//nearer the edge of the view are copied. -1 for none. m_mirrorAxis is
+	//the axis of the frame on screen
+	int m_mirrorAxis;
+	static bool countsTiles(const RenderJob& job) { return job.countHistogram && job.fillMode == FillMode::BruteForce && !job.usePerturbation; };
+	static bool isMirrored(int axis, int y) { return axis >= 0 && (axis < VIEW_HEIGHT ? y < (axis + 1) / 2 : y > axis / 2); };
 
 	//Window for drawing
 	sf::RenderWindow* m_window;
 
-	//Max iterations(resolution)
-	int m_max_iterations = 500;
+	//Max iterations(resolution) and how high it may go
+	long long m_max_iterations = 500;
+	long long m_iterationsCap;
 
 	//For maintaining aspect ration of selected areas
 	double m_aspectRatio;
 
-	//Arbitrary values that control the image colouring
+	//Arbitrary values that control the image colouring, and the colours
+	//they give baked into tables
 	float m_frequencyOne, m_frequencyTwo, m_frequencyThree;
+	Palette m_palette;
 
-	//For colour calculations
-	vector< vector<double> > m_mu;
+	//Colouring by mu or by histogram, and the histogram of the frame,
+	//counted once a render so recolouring can reuse it
+	ColourMode m_colourMode;
+	Histogram m_histogram;
+
+	//Histogram of the frame the render thread is working on, counted a
+	//tile at a time by the passes that work them out where they can
+	Histogram m_renderHistogram;
+
+	//Whether the colours are cycling, and how far they have moved
+	bool m_cycling;
+	float m_cyclePhase;
+
+	//Iterations, mu, colour and state of every pixel of the frame on
+	//screen, and the one being rendered. The states let a new limit on the
+	//same view carry on from where each pixel got to, and are only valid
+	//for the view and precision they were made with
+	FrameBuffer m_frame;
+	FrameBuffer m_backFrame;
+
+	//Goes up whenever the view or precision changes, a frame made with the
+	//same generation can be carried on from
+	int m_stateGeneration;
+	int m_frameGeneration;
+
+	//Frame whose colours are on screen, m_frame or a preview of the render
+	//in progress, with the view, limit and mirror axis it was rendered at
+	FrameBuffer* m_shown;
+	Dimensions m_shownCoords;
+	int m_shownGeneration;
+	long long m_shownIterations;
+	int m_shownAxis;
+
+	//Every pixel is worked out in passes, and what is done so far copied
+	//into m_preview for display now and then
+	Progressive m_progressive;
+	FrameBuffer m_preview;
+	int m_previewPasses;
+	sf::Clock m_previewClock;
+
+	//Pixel renders work outwards from, -1 for the middle of the view
+	int m_focusX, m_focusY;
+
+	//Every pixel is probed first for how long it should take. The render
+	//in progress publishes its prediction in ms from when it was asked for
+	//once it has one, -1 till then. The probe's rate is scaled by how far
+	//off the renders before have been
+	CostMap m_costMap;
+	double m_etaScale;
+	std::atomic<int> m_predictedTime;
+	sf::Clock m_renderClock;
+	double m_shownPrediction;
+
+	//Tiles of a render coloured by the palette are coloured and uploaded
+	//while it runs. Goes up whenever the colouring changes, a render
+	//coloured with another version is coloured again once it is done
+	TilePipeline m_pipeline;
+	int m_colourVersion;
+
+	//Time from a render being asked for to all of it being on screen, and
+	//to the frame before stretched over the view being on screen in ms, -1
+	//for a render with no such preview
+	sf::Time m_onScreenTime;
+	double m_previewTime;
+
+	//Every view put on screen, for going back and forward through them
+	ViewHistory m_history;
+
+	//Whole tiles of every render on the lattice are cached, and tiles of
+	//the next level are worked out ahead while nothing is being rendered,
+	//around the cursor first and then where the last frame has most
+	//detail, so going back or zooming in can take them from the cache.
+	//m_nextLevel keys the next level's tiles, its x and y the
+	//lattice pixel there of the last frame's top left corner. The render
+	//thread owns all of this but the cursor and counts
+	TileCache m_tileCache;
+	Kernel m_speculativeKernel;
+	TileKey m_nextLevel;
+	bool m_speculationPlanned;
+	int m_speculationThreads;
+	std::vector<TileKey> m_detailTiles;
+	size_t m_nextDetailTile;
+	std::vector<FrameBuffer> m_speculationFrames;
+	std::atomic<int> m_cursorX, m_cursorY;
+
+	//Tiles are kept on disk as well, shared with other viewers and with
+	//later sessions. Tiles the cache lacked that a render found there are
+	//held here until the render has copied them
+	TileStore m_tileStore;
+	std::deque<CachedTile> m_loadedTiles;
+	std::vector<TileKey> m_loadedKeys;
+
+	//Tiles worked out ahead, and renders on the lattice and those the
+	//cache had every pixel of
+	std::atomic<int> m_speculatedTiles;
+	std::atomic<int> m_latticeViews, m_instantViews;
+
+	//Started when the render thread takes a job, and when its probe was done
+	sf::Clock m_renderTimer;
+	double m_probeFinished;
+
+	//Renders run on their own thread into m_backFrame, one at a time. The
+	//window thread waits on m_renderDone only to cancel
+	std::thread m_renderThread;
+	std::mutex m_renderLock;
+	std::condition_variable m_renderWake;
+	std::condition_variable m_renderDone;
+	RenderJob m_job;
+	RenderResult m_result;
+	bool m_jobPending;
+	bool m_rendering;
+	bool m_frameReady;
+	bool m_quit;
+
+	//Set while the render thread works ahead, and while it may not because
+	//a render is about to be asked for
+	bool m_speculating;
+	bool m_speculationHeld;
+
+	//Set while a tune is asked for or the render thread runs it, and once
+	//it is done until the window thread puts the profile it picked to use
+	bool m_tunePending;
+	bool m_tuning;
+	bool m_tuneReady;
+	TuningProfile m_tunedProfile;
+
+	//Set to make the kernel and perturbation give up the render or tune in
+	//progress
+	std::atomic<bool> m_cancelRender;
+	string m_threadStats;
+
+	//Share of pixels the last render had to iterate
+	double m_iteratedShare;
 	
 	//For getting rendering time
 	sf::Time m_time;
 
-	//The image data
-	sf::Image m_image;
+	//The image data, uploaded from the frame's colour plane. The texture
+	//wraps round, the view's top left pixel being at m_textureX,
+	//m_textureY in it, so a pan moves that instead of every pixel and
+	//uploads only what it uncovers
 	sf::Texture m_imageTexture;
 	sf::RectangleShape m_imageSprite;
+	int m_textureX, m_textureY;
+	std::vector<uint8_t> m_uploadRows;
+
+	//Areas pans uncovered in the frame on screen that are yet to be worked
+	//out. A pan asks computeMandelbrot for only those, and while one goes
+	//on the views it puts on screen are left out of the history
+	std::vector<FrameTile> m_missingStrips;
+	bool m_stripsOnly;
+	bool m_panning;
+	bool m_panUnrecorded;
 
 	//Omp lock variables
 	omp_lock_t m_imageBlack_lock, m_imageColour_lock, m_mu_lock;
@@ -89,6 +422,14 @@ private:
 	int m_threads;
 	int m_threadCap;
 
+	//Whether the scheduling settings came from a profile for this machine
+	bool m_tuned;
+
+	//Threads started once for every render, m_threads of them take part,
+	//and the ones the window thread colours with meanwhile
+	ThreadPool m_pool;
+	ThreadPool m_colourPool;
+
 	//For increasing/decreasing threads and resolution
 	float m_elapsedTime;
 	float m_threadIncrementSpeed;
@@ -0,0 +1,119 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	m_data = nullptr;
+	m_size = 0;
+	m_file = nullptr;
+	m_mapping = nullptr;
+	m_descriptor = -1;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+/** Maps a file, making it size bytes of zeros first if it is empty or
+	missing. A file that already has a size is mapped whole, whatever size
+	is asked for. Returns false if it cannot be mapped*/
+bool MappedFile::open(const std::string& path, size_t size)
+{
+	close();
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS,
+							  FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER existing;
+	if (!GetFileSizeEx(file, &existing))
+	{
+		CloseHandle(file);
+		return false;
+	}
+	size = existing.QuadPart > 0 ? (size_t)existing.QuadPart : size;
+
+	//A mapping bigger than the file grows the file with zeros
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)((unsigned long long)size >> 32), (DWORD)size, nullptr);
+	void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size) : nullptr;
+	if (!data)
+	{
+		if (mapping)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return false;
+	}
+	m_file = file;
+	m_mapping = mapping;
+#else
+	int descriptor = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (descriptor < 0)
+	{
+		return false;
+	}
+	struct stat status;
+	if (fstat(descriptor, &status) != 0)
+	{
+		::close(descriptor);
+		return false;
+	}
+
+	//Growing the file leaves it sparse, the zeros take no disk until written
+	if (status.st_size > 0)
+	{
+		size = (size_t)status.st_size;
+	}
+	else if (ftruncate(descriptor, (off_t)size) != 0)
+	{
+		::close(descriptor);
+		return false;
+	}
+	void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	if (data == MAP_FAILED)
+	{
+		::close(descriptor);
+		return false;
+	}
+	m_descriptor = descriptor;
+#endif
+	m_data = (uint8_t*)data;
+	m_size = size;
+	return true;
+}
+
+/** Unmaps the file, if one is mapped*/
+void MappedFile::close()
+{
+	if (!m_data)
+	{
+		return;
+	}
+#if defined(_WIN32)
+	UnmapViewOfFile(m_data);
+	CloseHandle((HANDLE)m_mapping);
+	CloseHandle((HANDLE)m_file);
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	munmap(m_data, m_size);
+	::close(m_descriptor);
+	m_descriptor = -1;
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
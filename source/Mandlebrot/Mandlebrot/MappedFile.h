@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//A file mapped into memory for reading and writing, shared with every
+//other process that maps it, so what one writes the others see without
+//reading the file. The os writes changed pages back in its own time
+class MappedFile
+{
+
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const std::string& path, size_t size);
+	void close();
+
+	bool isOpen() { return m_data != nullptr; };
+	uint8_t* getData() { return m_data; };
+	size_t getSize() { return m_size; };
+
+private:
+	uint8_t* m_data;
+	size_t m_size;
+
+	//The file, and on Windows the mapping object as well
+	void* m_file;
+	void* m_mapping;
+	int m_descriptor;
+
+};
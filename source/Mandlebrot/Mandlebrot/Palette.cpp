@@ -0,0 +1,116 @@
+#include "Palette.h"
+#include "FrameBuffer.h"
+#include "Histogram.h"
+#include <cmath>
+
+//Iterations of the waves an equalised frame is spread over, from the
+//lowest mu in it to the highest
+static const double equalisedSpan = 100.0;
+
+//Iterations of mu one loop of the cycling palette covers. Each wave is
+//rounded to a whole number of periods over it, so the loop has no seam
+static const int cycleLength = 256;
+
+static const double pi = 3.14159265358979323846;
+
+Palette::Palette() : m_cycle(cycleSlots + 1)
+{
+	build(0.3, 0.3, 0.3);
+	buildCycle(0.0);
+}
+
+Palette::~Palette()
+{
+}
+
+/** Bakes the waves sin(frequency * mu + phase) * 127 + 128 of each channel
+	into its table, with red at phase 0, green at 4 and blue at 2*/
+void Palette::build(double frequencyOne, double frequencyTwo, double frequencyThree)
+{
+	for (int i = 0; i < paletteSize; ++i)
+	{
+		double angle = 2.0 * pi * i / paletteSize;
+		m_red[i] = (uint32_t)(uint8_t)(sin(angle + 0) * 127 + 128);
+		m_green[i] = (uint32_t)(uint8_t)(sin(angle + 4) * 127 + 128) << 8;
+		m_blue[i] = (uint32_t)(uint8_t)(sin(angle + 2) * 127 + 128) << 16;
+	}
+
+	m_redScale = frequencyOne * paletteSize / (2.0 * pi);
+	m_greenScale = frequencyThree * paletteSize / (2.0 * pi);
+	m_blueScale = frequencyTwo * paletteSize / (2.0 * pi);
+}
+
+/** Colours count pixels from their bands and fractions into RGBA8, black
+	where the band is the limit. Each pixel is three table lookups and a
+	single 32 bit store*/
+void Palette::colourPixels(const uint32_t* bands, const uint16_t* fractions, size_t count, uint32_t maxIterations, uint8_t* rgba) const
+{
+	uint32_t* out = reinterpret_cast<uint32_t*>(rgba);
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint32_t pixel = colour(bands[i] - fractions[i] * (1.0 / fractionSteps));
+		out[i] = bands[i] == maxIterations ? paletteOpaque : pixel;
+	}
+}
+
+/** Colours count pixels like colourPixels, but by their place in the
+	frame's histogram, so the palette is spread evenly over the pixels
+	whatever their iterations*/
+void Palette::colourEqualised(const uint32_t* bands, const uint16_t* fractions, size_t count, uint32_t maxIterations, const Histogram& histogram, uint8_t* rgba) const
+{
+	uint32_t* out = reinterpret_cast<uint32_t*>(rgba);
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint32_t pixel = colour(histogram.getPosition(bands[i], fractions[i]) * equalisedSpan);
+		out[i] = bands[i] == maxIterations ? paletteOpaque : pixel;
+	}
+}
+
+/** Gives count pixels their slot in the cycling palette, from mu or from
+	their place in the histogram as the colouring does. Pixels inside get
+	the inside slot. Only needed again once mu or the histogram changes*/
+void Palette::indexPixels(const uint32_t* bands, const uint16_t* fractions, size_t count, uint32_t maxIterations, const Histogram* histogram, uint16_t* slots) const
+{
+	const double slotsPerIteration = cycleSlots / (double)cycleLength;
+	for (size_t i = 0; i < count; ++i)
+	{
+		double mu = histogram ? histogram->getPosition(bands[i], fractions[i]) * equalisedSpan : bands[i] - fractions[i] * (1.0 / fractionSteps);
+		slots[i] = bands[i] == maxIterations ? interiorSlot : (uint16_t)((long long)(mu * slotsPerIteration + 0.5) & (cycleSlots - 1));
+	}
+}
+
+/** Builds the loop of colours moved on by phase iterations, from the
+	channel tables. Every wave is rounded to a whole number of periods per
+	loop, so slot positions in the tables are exact integers*/
+void Palette::buildCycle(double phase)
+{
+	//Periods of each wave per loop
+	long long redPeriods = (long long)floor(m_redScale * cycleLength / paletteSize + 0.5);
+	long long greenPeriods = (long long)floor(m_greenScale * cycleLength / paletteSize + 0.5);
+	long long bluePeriods = (long long)floor(m_blueScale * cycleLength / paletteSize + 0.5);
+
+	//The phase as table entries of each wave
+	double loops = phase / cycleLength;
+	long long redShift = (long long)floor(loops * redPeriods * paletteSize + 0.5);
+	long long greenShift = (long long)floor(loops * greenPeriods * paletteSize + 0.5);
+	long long blueShift = (long long)floor(loops * bluePeriods * paletteSize + 0.5);
+
+	for (long long slot = 0; slot < cycleSlots; ++slot)
+	{
+		m_cycle[slot] = m_red[(slot * redPeriods * paletteSize / cycleSlots + redShift) & (paletteSize - 1)] |
+						m_green[(slot * greenPeriods * paletteSize / cycleSlots + greenShift) & (paletteSize - 1)] |
+						m_blue[(slot * bluePeriods * paletteSize / cycleSlots + blueShift) & (paletteSize - 1)] | paletteOpaque;
+	}
+	m_cycle[interiorSlot] = paletteOpaque;
+}
+
+/** Colours count pixels from their slots in the loop, one lookup and one
+	32 bit store each*/
+void Palette::expandCycle(const uint16_t* slots, size_t count, uint8_t* rgba) const
+{
+	uint32_t* out = reinterpret_cast<uint32_t*>(rgba);
+	for (size_t i = 0; i < count; ++i)
+	{
+		out[i] = m_cycle[slots[i]];
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Histogram;
+
+//Entries in each channel's table, one period of its sine wave
+const int paletteSize = 4096;
+
+//Slots in the cycling palette, and the one kept for pixels inside
+const int cycleSlots = 32768;
+const uint16_t interiorSlot = (uint16_t)cycleSlots;
+
+//Opaque alpha in a little endian RGBA8 word
+const uint32_t paletteOpaque = 0xFF000000u;
+
+//How a frame's mu is turned into colour
+enum class ColourMode
+{
+	//The sine waves of mu itself
+	Palette,
+
+	//The sine waves of a pixel's place in the frame's histogram
+	Histogram
+};
+
+//The colouring, three sine waves of mu at their own frequencies, baked
+//into one table per channel over a single period. A pixel's colour is
+//three lookups indexed by its phase and a pack into RGBA8, so changing a
+//frequency costs a rebuild of the tables and one pass over the frame.
+//
+//For cycling, pixels get a slot of a loop of colours once, and every step
+//of the animation only rotates the loop and looks each pixel's colour up
+class Palette
+{
+
+public:
+	Palette();
+	~Palette();
+
+	void build(double frequencyOne, double frequencyTwo, double frequencyThree);
+	void colourPixels(const uint32_t* bands, const uint16_t* fractions, size_t count, uint32_t maxIterations, uint8_t* rgba) const;
+	void colourEqualised(const uint32_t* bands, const uint16_t* fractions, size_t count, uint32_t maxIterations, const Histogram& histogram, uint8_t* rgba) const;
+	void indexPixels(const uint32_t* bands, const uint16_t* fractions, size_t count, uint32_t maxIterations, const Histogram* histogram, uint16_t* slots) const;
+	void buildCycle(double phase);
+	void expandCycle(const uint16_t* slots, size_t count, uint8_t* rgba) const;
+
+	/** Returns the RGBA8 word for one mu, three lookups or-ed together*/
+	uint32_t colour(double mu) const
+	{
+		return m_red[(long long)(mu * m_redScale + 0.5) & (paletteSize - 1)] |
+			   m_green[(long long)(mu * m_greenScale + 0.5) & (paletteSize - 1)] |
+			   m_blue[(long long)(mu * m_blueScale + 0.5) & (paletteSize - 1)] | paletteOpaque;
+	};
+
+private:
+	//Channel values already shifted into place in a little endian RGBA8
+	//word, so the three lookups only need or-ing together
+	uint32_t m_red[paletteSize];
+	uint32_t m_green[paletteSize];
+	uint32_t m_blue[paletteSize];
+
+	//Table entries per iteration for each channel
+	double m_redScale, m_greenScale, m_blueScale;
+
+	//The loop of colours at the current phase, and the inside colour after
+	//it
+	std::vector<uint32_t> m_cycle;
+
+
+};
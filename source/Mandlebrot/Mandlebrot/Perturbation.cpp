@@ -0,0 +1,608 @@
+#include "Perturbation.h"
+#include <cmath>
+#include <algorithm>
+
+//Largest part of a step the dz^2 term a bilinear step drops may be, the
+//rounding of a double, so skipping is as good as iterating
+static const double blaEpsilon = 1.0 / 9007199254740992.0;
+
+//Tables with fewer levels than this are dropped. Their steps skip a few
+//iterations at most, which saves less than looking them up costs
+static const size_t minBlaLevels = 4;
+
+//Views whose deltas would fall off the bottom of a double's exponent
+//range use FloatExp instead. Squared deltas go denormal well before this,
+//but a double with the odd slow denormal still beats FloatExp by 3-4x
+static const double extendedRangeLimit = 1e-290;
+
+//Most reference orbits tried on one view before glitches are left as is
+static const int maxReferences = 16;
+
+//Steps the reference orbit or a pixel takes between looks for a cancel
+static const int cancelCheckSteps = 1 << 10;
+
+static inline double toDouble(double d) { return d; }
+static inline double toDouble(const FloatExp& d) { return d.toDouble(); }
+
+static inline FloatExp toFloatExp(double d) { return FloatExp(d); }
+static inline FloatExp toFloatExp(const FloatExp& d) { return d; }
+
+static inline double magnitude(double re, double im) { return std::sqrt(re * re + im * im); }
+static inline FloatExp magnitude(const FloatExp& re, const FloatExp& im) { return sqrt(re * re + im * im); }
+
+/** Rounds an orbit point or offset to the number type of the deltas*/
+template <class T>
+static inline T fromBigFixed(const BigFixed& b);
+template <>
+inline double fromBigFixed<double>(const BigFixed& b) { return b.toDouble(); }
+template <>
+inline FloatExp fromBigFixed<FloatExp>(const BigFixed& b) { return b.toFloatExp(); }
+
+template <class T>
+static inline T fromFloatExp(const FloatExp& f);
+template <>
+inline double fromFloatExp<double>(const FloatExp& f) { return f.toDouble(); }
+template <>
+inline FloatExp fromFloatExp<FloatExp>(const FloatExp& f) { return f; }
+
+/** Saves a delta in a pixel state as two mantissas over the larger
+	exponent, a zero part takes the other part's*/
+static void storeDelta(PixelState& state, const FloatExp& re, const FloatExp& im)
+{
+	state.exponent = re.m == 0.0 ? im.e : (im.m == 0.0 ? re.e : std::max(re.e, im.e));
+	state.zr = DoubleDouble(std::ldexp(re.m, re.e - state.exponent));
+	state.zi = DoubleDouble(std::ldexp(im.m, im.e - state.exponent));
+}
+
+Perturbation::Perturbation()
+{
+	m_extendedRange = false;
+	m_length = 0;
+	m_maxIterations = 0;
+	m_reference = 0;
+	m_width = 0;
+	m_height = 0;
+	m_limbs = 2;
+	m_mu = nullptr;
+	m_states = nullptr;
+	m_stride = 0;
+	m_idle = true;
+	m_blaEnabled = true;
+	m_cancel = nullptr;
+	m_firstLength = 0;
+	m_references = 0;
+	m_glitches = 0;
+	m_blaLevels = 0;
+	m_iterated = 0;
+	m_rebases = 0;
+}
+
+Perturbation::~Perturbation()
+{
+}
+
+/** Renders a view of width x height pixels around the centre into
+	mu[y * stride + x], a row at a time*/
+void Perturbation::render(const BigFixed& centreRe, const BigFixed& centreIm, FloatExp pixelWidth, FloatExp pixelHeight,
+						  int width, int height, long long maxIterations, int threads, double* mu, PixelState* states, int stride)
+{
+	beginRender(centreRe, centreIm, pixelWidth, pixelHeight, width, height, maxIterations, mu, states, stride);
+
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+	for (int y = 0; y < height; ++y)
+	{
+		computeLine(0, y, width, false);
+	}
+
+	finishRender(threads);
+}
+
+/** Sets up a render of a view of width x height pixels around the centre
+	into mu[y * stride + x], or only the states if mu is null, and iterates
+	the centre as the first reference. Any
+	pixels may then be worked out with computeLine, and finishRender fixes
+	the glitches among them. With states from an earlier render of the
+	same view, pixels that reached the old limit carry on around the centre
+	and the rest are only reclassified*/
+void Perturbation::beginRender(const BigFixed& centreRe, const BigFixed& centreIm, FloatExp pixelWidth, FloatExp pixelHeight,
+							   int width, int height, long long maxIterations, double* mu, PixelState* states, int stride)
+{
+	m_width = width;
+	m_height = height;
+	m_pixelWidth = pixelWidth;
+	m_pixelHeight = pixelHeight;
+	m_maxIterations = maxIterations;
+	m_mu = mu;
+	m_stride = stride;
+
+	//A one off render starts every pixel from scratch
+	if (states)
+	{
+		m_scratch.clear();
+		m_states = states;
+	}
+	else
+	{
+		m_scratch.assign(height * stride, PixelState());
+		m_states = m_scratch.data();
+	}
+
+	m_glitched.assign(width * height, 0);
+	m_rebases = 0;
+	m_references = 0;
+	m_glitches = 0;
+	m_iterated = 0;
+	m_reference = 0;
+
+	//Lowering the limit, or a limit every pixel already finished under,
+	//needs no reference orbit at all
+	m_idle = true;
+	for (int y = 0; y < height && m_idle; ++y)
+	{
+		for (int x = 0; x < width && m_idle; ++x)
+		{
+			m_idle = !m_states[y * stride + x].needsWork(maxIterations);
+		}
+	}
+	if (m_idle)
+	{
+		return;
+	}
+
+	//Enough bits to place every pixel, with room to spare
+	m_limbs = BigFixed::limbsForBits(64 - std::min(pixelWidth.e, pixelHeight.e));
+	m_centreRe = centreRe;
+	m_centreIm = centreIm;
+	m_centreRe.setFractionLimbs(m_limbs);
+	m_centreIm.setFractionLimbs(m_limbs);
+
+	//Later references can sit anywhere in the view
+	m_maxDelta = sqrt(pixelWidth * pixelWidth * FloatExp((double)width * width) + pixelHeight * pixelHeight * FloatExp((double)height * height));
+
+	setReference(m_centreRe, m_centreIm, maxIterations, m_maxDelta);
+	m_firstLength = m_length;
+	m_blaLevels = (int)(m_extendedRange ? m_orbitExtended.bla.size() : m_orbit.bla.size());
+	m_references = 1;
+}
+
+/** Works out count pixels from (x, y) along a row or down a column
+	around the centre reference. Safe to call from several threads on
+	different pixels*/
+void Perturbation::computeLine(int x, int y, int count, bool column)
+{
+	//Offsets are built the same way for rows and columns, so a pixel
+	//comes out the same whichever it is worked out in
+	PerturbationRun run;
+	run.reBase = FloatExp(-m_width / 2.0) * m_pixelWidth;
+	run.imBase = FloatExp(-m_height / 2.0) * m_pixelHeight;
+	int iterated;
+
+	if (column)
+	{
+		run.reBase = run.reBase + FloatExp(x + 0.5) * m_pixelWidth;
+		run.reStep = FloatExp(0.0);
+		run.imStep = m_pixelHeight;
+		run.first = y;
+		run.count = count;
+
+		//Columns cut across the rows, so go through a copy
+		std::vector<double> mu(count);
+		std::vector<PixelState> states(count);
+		std::vector<char> glitched(count);
+		for (int i = 0; i < count; ++i)
+		{
+			states[i] = m_states[(y + i) * m_stride + x];
+		}
+		iterated = computeRun(run, mu.data(), states.data(), glitched.data());
+		for (int i = 0; i < count; ++i)
+		{
+			if (m_mu)
+			{
+				m_mu[(y + i) * m_stride + x] = mu[i];
+			}
+			m_states[(y + i) * m_stride + x] = states[i];
+			m_glitched[(y + i) * m_width + x] = glitched[i];
+		}
+	}
+	else
+	{
+		run.imBase = run.imBase + FloatExp(y + 0.5) * m_pixelHeight;
+		run.imStep = FloatExp(0.0);
+		run.reStep = m_pixelWidth;
+		run.first = x;
+		run.count = count;
+		iterated = computeRun(run, m_mu ? m_mu + y * m_stride + x : nullptr, m_states + y * m_stride + x, &m_glitched[y * m_width + x]);
+	}
+
+#pragma omp atomic
+	m_iterated += iterated;
+}
+
+/** Renders the glitched pixels again around the one that lasted longest
+	until none are left, or the references run out*/
+void Perturbation::finishRender(int threads)
+{
+	const int width = m_width;
+	const int height = m_height;
+	std::vector<int> pending;
+
+	for (int pass = 1; pass < maxReferences && !m_idle && !isCancelled(); ++pass)
+	{
+		//Gathers the glitched pixels and the one that lasted longest
+		pending.clear();
+		int best = -1;
+		for (int p = 0; p < width * height; ++p)
+		{
+			if (m_glitched[p])
+			{
+				if (best < 0 || m_states[p / width * m_stride + p % width].valueAt(m_maxIterations) > m_states[best / width * m_stride + best % width].valueAt(m_maxIterations))
+				{
+					best = p;
+				}
+				pending.push_back(p);
+			}
+		}
+		if (pending.empty())
+		{
+			break;
+		}
+
+		//Reference position in pixels from the centre
+		double refX = best % width + 0.5 - width / 2.0;
+		double refY = best / width + 0.5 - height / 2.0;
+		BigFixed refRe = m_centreRe + BigFixed(FloatExp(refX) * m_pixelWidth, m_limbs);
+		BigFixed refIm = m_centreIm + BigFixed(FloatExp(refY) * m_pixelHeight, m_limbs);
+
+		m_reference = pass;
+		setReference(refRe, refIm, m_maxIterations, m_maxDelta);
+		++m_references;
+
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+		for (int i = 0; i < (int)pending.size(); ++i)
+		{
+			//A run of one pixel, offset from the new reference
+			int x = pending[i] % width;
+			int y = pending[i] / width;
+			PixelState& state = m_states[y * m_stride + x];
+			PerturbationRun run;
+			run.reBase = FloatExp(x + 0.5 - width / 2.0 - refX) * m_pixelWidth;
+			run.reStep = FloatExp(0.0);
+			run.imBase = FloatExp(y - height / 2.0 - refY) * m_pixelHeight;
+			run.imStep = m_pixelHeight;
+			run.first = 0;
+			run.count = 1;
+
+			//Starts again from z = 0 around the new reference
+			state = PixelState();
+			state.reference = pass;
+			computeRun(run, m_mu ? &m_mu[y * m_stride + x] : nullptr, &state, &m_glitched[pending[i]]);
+		}
+	}
+
+	m_glitches = 0;
+	for (char glitched : m_glitched)
+	{
+		m_glitches += glitched ? 1 : 0;
+	}
+}
+
+/** Iterates the reference point at full precision and builds the
+	approximation tables. maxDelta is the furthest any pixel lies from the
+	reference*/
+void Perturbation::setReference(const BigFixed& re, const BigFixed& im, long long maxIterations, FloatExp maxDelta)
+{
+	m_maxIterations = maxIterations;
+	m_extendedRange = maxDelta < FloatExp(extendedRangeLimit);
+
+	//Only the table for the number type in use is kept
+	if (m_extendedRange)
+	{
+		m_orbit = PerturbationOrbit<double>();
+		computeOrbit(m_orbitExtended, re, im);
+		buildBla(m_orbitExtended, maxDelta);
+	}
+	else
+	{
+		m_orbitExtended = PerturbationOrbit<FloatExp>();
+		computeOrbit(m_orbit, re, im);
+		buildBla(m_orbit, maxDelta);
+	}
+}
+
+/** Iterates a run of pixels as deltas from the reference orbit and flags
+	the ones that outlived it. Returns the number of pixels iterated*/
+int Perturbation::computeRun(const PerturbationRun& run, double* mu, PixelState* states, char* glitched)
+{
+	long long rebases = 0;
+	int iterated;
+	if (m_extendedRange)
+	{
+		iterated = computeRunAs(m_orbitExtended, run, mu, states, glitched, rebases);
+	}
+	else
+	{
+		iterated = computeRunAs(m_orbit, run, mu, states, glitched, rebases);
+	}
+
+#pragma omp atomic
+	m_rebases += rebases;
+
+	return iterated;
+}
+
+/** Iterates Z = Z^2 + C at the precision of the reference point until it
+	escapes or reaches the limit, rounding each point for the deltas. A
+	cancel cuts the orbit short, the render is thrown away anyway*/
+template <class T>
+void Perturbation::computeOrbit(PerturbationOrbit<T>& orbit, const BigFixed& re, const BigFixed& im)
+{
+	BigFixed zr(0.0, re.getFractionLimbs());
+	BigFixed zi(0.0, re.getFractionLimbs());
+
+	orbit.re.clear();
+	orbit.im.clear();
+
+	for (int n = 0;; ++n)
+	{
+		orbit.re.push_back(fromBigFixed<T>(zr));
+		orbit.im.push_back(fromBigFixed<T>(zi));
+
+		double x = zr.toDouble();
+		double y = zi.toDouble();
+		if (n == m_maxIterations || x * x + y * y >= 4.0 || ((n & (cancelCheckSteps - 1)) == 0 && isCancelled()))
+		{
+			m_length = n;
+			return;
+		}
+
+		BigFixed zr2 = zr * zr;
+		BigFixed zi2 = zi * zi;
+		BigFixed zri = zr * zi;
+		zi = zri + zri + im;
+		zr = zr2 - zi2 + re;
+	}
+}
+
+/** Builds the bilinear approximation tables. Level zero is one iteration,
+	dz' = 2Z dz + dc, valid while dz^2 is within rounding of the rest of
+	the step for any dc in the view. Each level above
+	merges pairs of steps from the level below, so 2^l iterations can be
+	skipped in one go wherever the pixel's delta is within the radius.
+	Left empty when too few levels are usable to be worth it*/
+template <class T>
+void Perturbation::buildBla(PerturbationOrbit<T>& orbit, FloatExp maxDelta)
+{
+	typedef typename PerturbationOrbit<T>::BlaStep BlaStep;
+
+	const T dcMax = fromFloatExp<T>(maxDelta);
+	const T zero(0.0);
+
+	//A cancelled render never gets to use the tables
+	orbit.bla.clear();
+	if (isCancelled())
+	{
+		return;
+	}
+	orbit.bla.push_back(std::vector<BlaStep>(m_length));
+	for (int m = 0; m < m_length; ++m)
+	{
+		BlaStep& step = orbit.bla[0][m];
+		step.ar = orbit.re[m] + orbit.re[m];
+		step.ai = orbit.im[m] + orbit.im[m];
+		step.br = T(1.0);
+		step.bi = zero;
+
+		//|dz|^2 < epsilon |A dz| holds up to |dz| = epsilon |A|, less the
+		//most the |B| |dc| term can take off |A dz|, which gives
+		//(epsilon |A|^2 - |B| |dc|max) / |A|. None where Z is 0
+		T a = magnitude(step.ar, step.ai);
+		T radius = a > zero ? (T(blaEpsilon) * a * a - dcMax) / a : zero;
+		step.radius = radius < zero ? zero : radius;
+	}
+
+	while (orbit.bla.back().size() >= 2 && !isCancelled())
+	{
+		size_t level = orbit.bla.size() - 1;
+		size_t count = orbit.bla[level].size() / 2;
+		std::vector<BlaStep> merged(count);
+		bool usable = false;
+
+		for (size_t j = 0; j < count; ++j)
+		{
+			const BlaStep& x = orbit.bla[level][2 * j];
+			const BlaStep& y = orbit.bla[level][2 * j + 1];
+			BlaStep& z = merged[j];
+
+			//Applying x then y, a = ay ax and b = ay bx + by
+			z.ar = y.ar * x.ar - y.ai * x.ai;
+			z.ai = y.ar * x.ai + y.ai * x.ar;
+			z.br = y.ar * x.br - y.ai * x.bi + y.br;
+			z.bi = y.ar * x.bi + y.ai * x.br + y.bi;
+
+			//dz after x must still be inside y's radius
+			T ax = magnitude(x.ar, x.ai);
+			T bx = magnitude(x.br, x.bi);
+			T radius = zero;
+			if (ax > zero)
+			{
+				radius = (y.radius - bx * dcMax) / ax;
+			}
+			radius = radius < zero ? zero : radius;
+			z.radius = x.radius < radius ? x.radius : radius;
+			usable = usable || z.radius > zero;
+		}
+
+		//Radii only shrink going up, so a level no pixel can take ends
+		//the tables, and pixels of shallow views stop looking at once
+		if (!usable)
+		{
+			break;
+		}
+		orbit.bla.push_back(merged);
+	}
+
+	if (orbit.bla.size() < minBlaLevels)
+	{
+		orbit.bla.clear();
+	}
+}
+
+/** Iterates each pixel as dz' = (2Z + dz) dz + dc around the reference.
+	A pixel whose orbit passes closer to zero than the reference is rebased
+	onto the start of the reference so dz never swamps Z, which is what
+	causes the glitches of plain perturbation. A pixel that outlives an
+	escaping reference is rebased too, but has lost its precision and is
+	flagged as glitched. Pixels pick up from their state if it belongs to
+	this reference. Adds up the rebases and returns the pixels iterated*/
+template <class T>
+int Perturbation::computeRunAs(const PerturbationOrbit<T>& orbit, const PerturbationRun& run, double* mu, PixelState* states, char* glitched, long long& rebases)
+{
+	typedef typename PerturbationOrbit<T>::BlaStep BlaStep;
+
+	const T* refRe = orbit.re.data();
+	const T* refIm = orbit.im.data();
+	const int levels = (int)orbit.bla.size();
+	const bool useBla = m_blaEnabled && levels > 1;
+	const bool referenceEscaped = m_length < m_maxIterations;
+	const T four(4.0);
+	int iterated = 0;
+
+	for (int i = 0; i < run.count && !isCancelled(); ++i)
+	{
+		PixelState& state = states[i];
+		glitched[i] = 0;
+
+		//Pixels already finished at this limit only need reclassifying
+		if (!state.needsWork(m_maxIterations))
+		{
+			if (mu)
+			{
+				mu[i] = state.valueAt(m_maxIterations);
+			}
+			continue;
+		}
+		++iterated;
+
+		//A delta from another reference is no use here
+		if (state.reference != m_reference)
+		{
+			state = PixelState();
+			state.reference = m_reference;
+		}
+
+		FloatExp k(run.first + i + 0.5);
+		T dcr = fromFloatExp<T>(run.reBase + k * run.reStep);
+		T dci = fromFloatExp<T>(run.imBase + k * run.imStep);
+		T dzr = fromFloatExp<T>(FloatExp(state.zr.hi, state.exponent));
+		T dzi = fromFloatExp<T>(FloatExp(state.zi.hi, state.exponent));
+		T norm(0.0);
+		int m = state.orbitIndex;
+		long long n = state.iterations;
+		bool escaped = false;
+		int steps = 0;
+
+		for (;;)
+		{
+			if (n >= m_maxIterations)
+			{
+				break;
+			}
+
+			//A pixel can take millions of steps, so looks for a cancel now
+			//and then and leaves it part way
+			if (++steps == cancelCheckSteps)
+			{
+				steps = 0;
+				if (isCancelled())
+				{
+					break;
+				}
+			}
+			T zr = refRe[m] + dzr;
+			T zi = refIm[m] + dzi;
+			norm = zr * zr + zi * zi;
+			if (!(norm < four))
+			{
+				escaped = true;
+				break;
+			}
+
+			T deltaNorm = dzr * dzr + dzi * dzi;
+			if (norm < deltaNorm || m == m_length)
+			{
+				if (m == m_length && referenceEscaped)
+				{
+					glitched[i] = 1;
+				}
+
+				dzr = zr;
+				dzi = zi;
+				deltaNorm = norm;
+				m = 0;
+				++rebases;
+			}
+
+			//Climbs to the longest approximation step that is still valid.
+			//Radii only shrink going up, so the first failure ends the search
+			int level = 0;
+			if (useBla && m > 0)
+			{
+				while (level + 1 < levels && (m & ((2 << level) - 1)) == 0)
+				{
+					int j = m >> (level + 1);
+					if (j >= (int)orbit.bla[level + 1].size() || n + (2 << level) > m_maxIterations)
+					{
+						break;
+					}
+
+					const BlaStep& step = orbit.bla[level + 1][j];
+					if (!(deltaNorm < step.radius * step.radius))
+					{
+						break;
+					}
+					++level;
+				}
+			}
+
+			if (level > 0)
+			{
+				const BlaStep& step = orbit.bla[level][m >> level];
+				T nr = step.ar * dzr - step.ai * dzi + step.br * dcr - step.bi * dci;
+				T ni = step.ar * dzi + step.ai * dzr + step.br * dci + step.bi * dcr;
+				dzr = nr;
+				dzi = ni;
+				m += 1 << level;
+				n += 1 << level;
+				continue;
+			}
+
+			T tr = refRe[m] + refRe[m] + dzr;
+			T ti = refIm[m] + refIm[m] + dzi;
+			T nr = tr * dzr - ti * dzi + dcr;
+			T ni = tr * dzi + ti * dzr + dci;
+			dzr = nr;
+			dzi = ni;
+			++m;
+			++n;
+		}
+
+		//Same smoothing as the kernel, |z| = sqrt(|z|^2)
+		state.iterations = n;
+		if (escaped)
+		{
+			state.status = PixelStatus::Escaped;
+			state.mu = n - (std::log(2) / std::log(std::sqrt(toDouble(norm))));
+		}
+		else
+		{
+			storeDelta(state, toFloatExp(dzr), toFloatExp(dzi));
+			state.orbitIndex = m;
+		}
+		if (mu)
+		{
+			mu[i] = state.valueAt(m_maxIterations);
+		}
+	}
+
+	return iterated;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include "BigFixed.h"
+#include "FloatExp.h"
+#include "PixelState.h"
+#include <atomic>
+#include <vector>
+
+//A straight line of pixels given as offsets from the reference point.
+//Pixel k of the run sits at dc = (reBase + (k + 0.5) * reStep,
+//imBase + (k + 0.5) * imStep), like a KernelRun
+struct PerturbationRun
+{
+	FloatExp reBase;
+	FloatExp reStep;
+	FloatExp imBase;
+	FloatExp imStep;
+
+	//Index of the first pixel and number of pixels in the run
+	int first;
+	int count;
+};
+
+//Reference orbit points and approximation tables in one number type
+template <class T>
+struct PerturbationOrbit
+{
+	//Skips 2^level iterations at once, dz' = a * dz + b * dc, as long as
+	//|dz| is under radius
+	struct BlaStep
+	{
+		T ar, ai;
+		T br, bi;
+		T radius;
+	};
+
+	//Z_0 to Z_length of the reference orbit
+	std::vector<T> re, im;
+
+	//Level l holds one step for every 2^l iterations of the reference
+	std::vector< std::vector<BlaStep> > bla;
+};
+
+class Perturbation
+{
+
+public:
+	Perturbation();
+	~Perturbation();
+
+	void render(const BigFixed& centreRe, const BigFixed& centreIm, FloatExp pixelWidth, FloatExp pixelHeight,
+				int width, int height, long long maxIterations, int threads, double* mu, PixelState* states, int stride);
+	void beginRender(const BigFixed& centreRe, const BigFixed& centreIm, FloatExp pixelWidth, FloatExp pixelHeight,
+					 int width, int height, long long maxIterations, double* mu, PixelState* states, int stride);
+	void computeLine(int x, int y, int count, bool column);
+	void finishRender(int threads);
+	void setBla(bool enabled) { m_blaEnabled = enabled; };
+	void setCancel(const std::atomic<bool>* cancel) { m_cancel = cancel; };
+
+	bool getBla() { return m_blaEnabled; };
+	bool isCancelled() { return m_cancel && m_cancel->load(std::memory_order_relaxed); };
+	bool getExtendedRange() { return m_extendedRange; };
+	int getReferenceLength() { return m_firstLength; };
+	int getReferences() { return m_references; };
+	int getGlitches() { return m_glitches; };
+	long long getRebases() { return m_rebases; };
+	int getBlaLevels() { return m_blaLevels; };
+	int getIterated() { return m_iterated; };
+	PixelState* getStates() { return m_states; };
+	bool isGlitched(int x, int y) { return m_glitched[y * m_width + x] != 0; };
+
+private:
+	void setReference(const BigFixed& re, const BigFixed& im, long long maxIterations, FloatExp maxDelta);
+	int computeRun(const PerturbationRun& run, double* mu, PixelState* states, char* glitched);
+
+	template <class T>
+	void computeOrbit(PerturbationOrbit<T>& orbit, const BigFixed& re, const BigFixed& im);
+
+	template <class T>
+	void buildBla(PerturbationOrbit<T>& orbit, FloatExp maxDelta);
+
+	template <class T>
+	int computeRunAs(const PerturbationOrbit<T>& orbit, const PerturbationRun& run, double* mu, PixelState* states, char* glitched, long long& rebases);
+
+	//Reference orbit and tables, only the one in use is filled
+	PerturbationOrbit<double> m_orbit;
+	PerturbationOrbit<FloatExp> m_orbitExtended;
+
+	//Deltas too small for a double switch to FloatExp
+	bool m_extendedRange;
+
+	//Iterations before the current reference escaped, or the limit
+	int m_length;
+	long long m_maxIterations;
+
+	//Which reference of the render is in use, pixel states record it
+	int m_reference;
+
+	//The view being rendered
+	BigFixed m_centreRe, m_centreIm;
+	FloatExp m_pixelWidth, m_pixelHeight;
+	FloatExp m_maxDelta;
+	int m_width, m_height;
+	int m_limbs;
+
+	//Output rows, pixel states and pixels that outlived their reference.
+	//Pixel (x, y) is at y * m_stride + x, or y * m_width + x in m_glitched
+	double* m_mu;
+	PixelState* m_states;
+	int m_stride;
+	std::vector<PixelState> m_scratch;
+	std::vector<char> m_glitched;
+
+	//Every pixel was already finished at this limit
+	bool m_idle;
+
+	//Bilinear approximation skipping
+	bool m_blaEnabled;
+
+	//Set from another thread to stop the render part way, null if renders
+	//are never cancelled
+	const std::atomic<bool>* m_cancel;
+
+	//Statistics for the last render
+	int m_firstLength;
+	int m_references;
+	int m_glitches;
+	int m_blaLevels;
+	int m_iterated;
+	long long m_rebases;
+
+};
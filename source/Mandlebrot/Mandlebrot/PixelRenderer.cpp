@@ -0,0 +1,362 @@
+#include "PixelRenderer.h"
+#include "TileCache.h"
+#include <algorithm>
+#include <cmath>
+
+//Pixels handed to the kernel at once by computePoints
+const int pointChunk = 1024;
+
+/** Returns count unstarted states for a thread to work pixels out in when
+	the frame keeps none. Each thread reuses its own*/
+static PixelState* freshStates(int count)
+{
+	thread_local std::vector<PixelState> states;
+	states.assign(count, PixelState());
+	return states.data();
+}
+
+PixelRenderer::PixelRenderer()
+{
+	m_width = 0;
+	m_height = 0;
+	m_maxIterations = 0;
+	m_firstRow = 0;
+	m_frame = nullptr;
+	m_offset = 0;
+	m_states = nullptr;
+	m_kernel = nullptr;
+	m_pixelWidth = 0.0;
+	m_pixelHeight = 0.0;
+	m_level = -1;
+	m_latticeX = 0;
+	m_latticeY = 0;
+	m_perturbation = nullptr;
+	m_iterated = 0;
+}
+
+PixelRenderer::~PixelRenderer()
+{
+}
+
+/** Writes height rows of the frame from firstRow down, at an iteration
+	limit. Pixel (x, y) of the renderer is pixel (x, firstRow + y) of the
+	frame*/
+void PixelRenderer::setOutput(FrameBuffer* frame, int firstRow, int height, long long maxIterations)
+{
+	m_width = frame->getWidth();
+	m_height = height;
+	m_firstRow = firstRow;
+	m_maxIterations = maxIterations;
+	m_frame = frame;
+	m_offset = (size_t)firstRow * m_width;
+	m_states = frame->getStates() ? frame->getStates() + m_offset : nullptr;
+	m_iterated = 0;
+}
+
+/** Works out pixels with the kernel, the centre of frame pixel (x, y) is at
+	(left + (x + 0.5) * pixelWidth, top + (y + 0.5) * pixelHeight). Output
+	that starts part way down the frame keeps the frame's top, so its
+	pixels land on exactly the same points*/
+void PixelRenderer::setKernel(Kernel* kernel, DoubleDouble left, DoubleDouble top, double pixelWidth, double pixelHeight)
+{
+	m_kernel = kernel;
+	m_left = left;
+	m_top = top;
+	m_pixelWidth = pixelWidth;
+	m_pixelHeight = pixelHeight;
+	m_level = -1;
+	m_perturbation = nullptr;
+}
+
+/** Works out pixels with the kernel for a view on the lattice, whose top
+	left pixel is lattice pixel (latticeX, latticeY) of a level. Each pixel
+	lands on exactly the point it has in a cached tile worked out alone*/
+void PixelRenderer::setLattice(Kernel* kernel, int level, long long latticeX, long long latticeY)
+{
+	m_latticePixelWidth = TileCache::getPixelWidth(level);
+	m_latticePixelHeight = TileCache::getPixelHeight(level);
+	setKernel(kernel, DoubleDouble(latticeLeft) + TileCache::toDoubleDouble(latticeX) * m_latticePixelWidth,
+			  DoubleDouble(latticeTop) + TileCache::toDoubleDouble(latticeY) * m_latticePixelHeight, m_latticePixelWidth.hi, m_latticePixelHeight.hi);
+	m_level = level;
+	m_latticeX = latticeX;
+	m_latticeY = latticeY;
+}
+
+/** Works out pixels by perturbation instead, once it has begun the render
+	on the same rows of the frame. Its states are read from then on, which
+	are its own if the frame keeps none*/
+void PixelRenderer::setPerturbation(Perturbation* perturbation)
+{
+	m_perturbation = perturbation;
+	m_states = perturbation->getStates();
+}
+
+/** Fixes perturbation glitches once every pixel is worked out or filled*/
+void PixelRenderer::finish(int threads)
+{
+	if (!m_perturbation || isCancelled())
+	{
+		return;
+	}
+	m_perturbation->finishRender(threads);
+
+	//Glitched pixels could be anywhere
+#pragma omp parallel for num_threads(threads)
+	for (int y = 0; y < m_height; ++y)
+	{
+		storeValues(y * m_width, m_width);
+	}
+}
+
+/** Works out count pixels from (x, y) along a row or down a column. Safe to
+	call from several threads on different pixels. Does nothing once the
+	render is cancelled*/
+void PixelRenderer::computeLine(int x, int y, int count, bool column)
+{
+	if (count <= 0 || isCancelled())
+	{
+		return;
+	}
+
+	if (m_perturbation)
+	{
+		m_perturbation->computeLine(x, y, count, column);
+		if (column)
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				storeValues((y + i) * m_width + x, 1);
+			}
+		}
+		else
+		{
+			storeValues(y * m_width + x, count);
+		}
+		return;
+	}
+
+	//Lattice columns are placed a pixel at a time from their tiles' corners
+	if (m_level >= 0 && column)
+	{
+		int xs[pointChunk];
+		int ys[pointChunk];
+		for (int start = 0; start < count; start += pointChunk)
+		{
+			int points = std::min(pointChunk, count - start);
+			for (int i = 0; i < points; ++i)
+			{
+				xs[i] = x;
+				ys[i] = y + start + i;
+			}
+			int iterated = computeChunk(xs, ys, points);
+
+#pragma omp atomic
+			m_iterated += iterated;
+		}
+		return;
+	}
+
+	//Positions are built the same way for rows and columns, so a pixel
+	//comes out the same whichever it is worked out in
+	KernelRun run;
+	int iterated;
+	if (column)
+	{
+		run.reBase = m_left + DoubleDouble((x + 0.5f) * m_pixelWidth);
+		run.reStep = 0.0;
+		run.imBase = m_top;
+		run.imStep = m_pixelHeight;
+		run.first = m_firstRow + y;
+		run.count = count;
+
+		//Columns cut across the rows, so go through a copy
+		std::vector<PixelState> states(count);
+		for (int i = 0; i < count && m_states; ++i)
+		{
+			states[i] = m_states[(y + i) * m_width + x];
+		}
+		iterated = m_kernel->computeRun(run, m_maxIterations, nullptr, states.data());
+		for (int i = 0; i < count; ++i)
+		{
+			storeState((y + i) * m_width + x, states[i]);
+		}
+	}
+	else
+	{
+		//Lattice rows are cut where they cross into the next tile, each
+		//piece placed from its tile's corner
+		iterated = 0;
+		for (int done = 0; done < count; done += run.count)
+		{
+			run.reBase = m_left;
+			run.reStep = m_pixelWidth;
+			run.imBase = getIm(m_firstRow + y);
+			run.imStep = 0.0;
+			run.first = x + done;
+			run.count = count - done;
+			if (m_level >= 0)
+			{
+				long long pixel = m_latticeX + x + done;
+				long long corner = TileCache::findTile(pixel, cacheTileWidth) * cacheTileWidth;
+				run.reBase = DoubleDouble(latticeLeft) + TileCache::toDoubleDouble(corner) * m_latticePixelWidth;
+				run.first = (int)(pixel - corner);
+				run.count = std::min(count - done, cacheTileWidth - run.first);
+			}
+
+			int index = y * m_width + x + done;
+			if (m_states)
+			{
+				iterated += m_kernel->computeRun(run, m_maxIterations, nullptr, m_states + index);
+				storeValues(index, run.count);
+			}
+			else
+			{
+				PixelState* states = freshStates(run.count);
+				iterated += m_kernel->computeRun(run, m_maxIterations, nullptr, states);
+				for (int i = 0; i < run.count; ++i)
+				{
+					storeValue(index + i, states[i]);
+				}
+			}
+		}
+	}
+
+#pragma omp atomic
+	m_iterated += iterated;
+}
+
+/** Works out a scattered list of pixels (xs[i], ys[i]) on threads threads,
+	in vectors as full as a straight line would give*/
+void PixelRenderer::computePoints(const int* xs, const int* ys, int count, int threads)
+{
+	if (m_perturbation)
+	{
+#pragma omp parallel for schedule(dynamic, 16) num_threads(threads)
+		for (int i = 0; i < count; ++i)
+		{
+			computeLine(xs[i], ys[i], 1, false);
+		}
+		return;
+	}
+
+	if (isCancelled())
+	{
+		return;
+	}
+
+	int chunks = (count + pointChunk - 1) / pointChunk;
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+	for (int chunk = 0; chunk < chunks; ++chunk)
+	{
+		int start = chunk * pointChunk;
+		int iterated = computeChunk(xs + start, ys + start, std::min(pointChunk, count - start));
+
+#pragma omp atomic
+		m_iterated += iterated;
+	}
+}
+
+/** Works out the pixels (xs[i], ys[i]) in one call to the kernel. Returns
+	the number that needed iterating*/
+int PixelRenderer::computeChunk(const int* xs, const int* ys, int count)
+{
+	//Lattice pixels are iterated just as in a row, wherever they lie
+	double pixelSize = m_level >= 0 ? std::abs(m_pixelWidth) : std::max(std::abs(m_pixelWidth), std::abs(m_pixelHeight));
+	std::vector<DoubleDouble> re(count), im(count);
+	std::vector<PixelState> states(count);
+	for (int i = 0; i < count; ++i)
+	{
+		re[i] = getRe(xs[i]);
+		im[i] = getIm(m_firstRow + ys[i]);
+		if (m_states)
+		{
+			states[i] = m_states[ys[i] * m_width + xs[i]];
+		}
+	}
+
+	int iterated = m_kernel->computePoints(re.data(), im.data(), count, pixelSize, m_maxIterations, nullptr, states.data());
+	for (int i = 0; i < count; ++i)
+	{
+		storeState(ys[i] * m_width + xs[i], states[i]);
+	}
+	return iterated;
+}
+
+/** Returns the real part of the centre of the pixels in column x, the
+	same as a row gives them*/
+DoubleDouble PixelRenderer::getRe(int x)
+{
+	if (m_level < 0)
+	{
+		return m_left + DoubleDouble((x + 0.5f) * m_pixelWidth);
+	}
+	long long pixel = m_latticeX + x;
+	long long corner = TileCache::findTile(pixel, cacheTileWidth) * cacheTileWidth;
+	return DoubleDouble(latticeLeft) + TileCache::toDoubleDouble(corner) * m_latticePixelWidth + DoubleDouble(((int)(pixel - corner) + 0.5f) * m_pixelWidth);
+}
+
+/** Returns the imaginary part of the centre of the pixels in a row of the
+	frame*/
+DoubleDouble PixelRenderer::getIm(int row)
+{
+	if (m_level < 0)
+	{
+		return m_top + DoubleDouble((row + 0.5f) * m_pixelHeight);
+	}
+	long long pixel = m_latticeY + row;
+	long long corner = TileCache::findTile(pixel, cacheTileHeight) * cacheTileHeight;
+	return DoubleDouble(latticeTop) + TileCache::toDoubleDouble(corner) * m_latticePixelHeight + DoubleDouble(((int)(pixel - corner) + 0.5f) * m_pixelHeight);
+}
+
+/** Works out every pixel a tile at a time on the pool, so each thread
+	keeps to one patch of the buffers and threads that run out of tiles
+	take them from the others. Given the predicted cost of every tile,
+	the threads start with tiles of equal cost rather than equal number*/
+void PixelRenderer::computeTiles(ThreadPool& pool, int threads, const double* costs)
+{
+	pool.run(ThreadPool::countTiles(m_width, m_height), threads, [this](int index)
+	{
+		FrameTile tile = ThreadPool::getTile(index, m_width, m_height);
+		for (int y = tile.top; y < tile.bottom; ++y)
+		{
+			//Every pixel in a row shares the imaginary part of c
+			computeLine(tile.left, y, tile.right - tile.left, false);
+		}
+	}, costs);
+}
+
+/** Returns the number of pixels that needed iterating*/
+int PixelRenderer::getIterated()
+{
+	return m_perturbation ? m_perturbation->getIterated() : m_iterated;
+}
+
+/** Encodes the band and mu of count pixels from index on into the frame,
+	from their states. The kernel only writes the states, so this is the
+	one pass over the pixels after it*/
+void PixelRenderer::storeValues(int index, int count)
+{
+	for (int i = index; i < index + count; ++i)
+	{
+		storeValue(i, m_states[i]);
+	}
+}
+
+/** Encodes the band and mu of a pixel into the frame from a state*/
+void PixelRenderer::storeValue(int index, const PixelState& state)
+{
+	double mu = state.valueAt(m_maxIterations);
+	m_frame->setMu(m_offset + index, (uint32_t)(mu == (double)m_maxIterations ? m_maxIterations : state.iterations), mu);
+}
+
+/** Keeps a pixel's state worked out apart from the frame's, if the frame
+	keeps states, and encodes its band and mu*/
+void PixelRenderer::storeState(int index, const PixelState& state)
+{
+	if (m_states)
+	{
+		m_states[index] = state;
+	}
+	storeValue(index, state);
+}
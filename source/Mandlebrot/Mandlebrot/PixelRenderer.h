@@ -0,0 +1,97 @@
+#pragma once
+#include "FrameBuffer.h"
+#include "Kernel.h"
+#include "Perturbation.h"
+#include "PixelState.h"
+#include "ThreadPool.h"
+#include <vector>
+
+//How a render picks the pixels to iterate
+enum class FillMode
+{
+	//Every pixel
+	BruteForce,
+
+	//Mariani-Silver, fills tiles with a border in one band
+	Subdivision,
+
+	//Follows the edges between bands and fills what they enclose
+	BoundaryTrace
+};
+
+//Works out any row or column of pixels of one view into the rows of a
+//frame, with the kernel or by perturbation, so the fill strategies can
+//pick which pixels need iterating
+class PixelRenderer
+{
+
+public:
+	PixelRenderer();
+	~PixelRenderer();
+
+	void setOutput(FrameBuffer* frame, int firstRow, int height, long long maxIterations);
+	void setKernel(Kernel* kernel, DoubleDouble left, DoubleDouble top, double pixelWidth, double pixelHeight);
+	void setLattice(Kernel* kernel, int level, long long latticeX, long long latticeY);
+	void setPerturbation(Perturbation* perturbation);
+	void finish(int threads);
+	void computeLine(int x, int y, int count, bool column);
+	void computePoints(const int* xs, const int* ys, int count, int threads);
+	void computeTiles(ThreadPool& pool, int threads, const double* costs);
+	int getIterated();
+
+	/** Returns true once the render has been cancelled, the pixels left are
+		not worth working out*/
+	bool isCancelled() { return m_perturbation ? m_perturbation->isCancelled() : m_kernel && m_kernel->isCancelled(); };
+
+	/** Sets a pixel without iterating it*/
+	void fill(int x, int y, const PixelState& state) { storeState(y * m_width + x, state); };
+
+	/** Returns the iteration a worked out pixel escaped on, or the limit if
+		it is inside at this limit*/
+	long long getBand(int x, int y) { return m_frame->getIterations()[m_offset + y * m_width + x]; };
+
+	/** Returns false for pixels perturbation has flagged as glitched, whose
+		values are wrong until finishRender*/
+	bool isTrusted(int x, int y) { return !m_perturbation || !m_perturbation->isGlitched(x, y); };
+
+	int getWidth() { return m_width; };
+	int getHeight() { return m_height; };
+	long long getMaxIterations() { return m_maxIterations; };
+	double getMu(int x, int y) { return m_frame->getMu(m_offset + y * m_width + x); };
+
+private:
+	DoubleDouble getRe(int x);
+	DoubleDouble getIm(int row);
+	int computeChunk(const int* xs, const int* ys, int count);
+	void storeValues(int index, int count);
+	void storeValue(int index, const PixelState& state);
+	void storeState(int index, const PixelState& state);
+
+	//Rows of the frame written to, pixel (x, y) at y * m_width + x. The
+	//states are the frame's, perturbation's or null if neither keeps any
+	int m_width, m_height;
+	int m_firstRow;
+	long long m_maxIterations;
+	FrameBuffer* m_frame;
+	size_t m_offset;
+	PixelState* m_states;
+
+	//Kernel and where its view sits, used unless perturbation is set
+	Kernel* m_kernel;
+	DoubleDouble m_left, m_top;
+	double m_pixelWidth, m_pixelHeight;
+
+	//Level of a view on the lattice, or -1, and the lattice pixel of its
+	//top left corner. Its pixels are placed from the corner of the cached
+	//tile they fall in, the way the tile's own are
+	int m_level;
+	long long m_latticeX, m_latticeY;
+	DoubleDouble m_latticePixelWidth, m_latticePixelHeight;
+
+	//Deep zoom engine, which must have begun the render
+	Perturbation* m_perturbation;
+
+	//Pixels that needed iterating
+	int m_iterated;
+
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include "DoubleDouble.h"
+
+//How far a pixel has got
+enum class PixelStatus : unsigned char
+{
+	//Still going, z holds where it got to
+	Running,
+
+	//Left the radius 2 circle, mu holds the smoothed count
+	Escaped,
+
+	//Caught by the interior checks, inside at any limit
+	Inside
+};
+
+//Progress of one pixel, kept between renders of the same view so that
+//raising the iteration limit only carries on the pixels that reached the
+//old one and lowering it only has to reclassify
+struct PixelState
+{
+	//z, or for perturbation the delta from the reference orbit, as
+	//(zr, zi) * 2^exponent so tiny deltas fit too
+	DoubleDouble zr, zi;
+	int exponent;
+
+	//Reference orbit the delta belongs to and the position along it
+	int reference;
+	int orbitIndex;
+
+	//Sits in the padding before iterations, keeping a state to 64 bytes
+	PixelStatus status;
+
+	//Iterations done so far, or the one it escaped on
+	long long iterations;
+
+	//Smoothed iteration count once escaped
+	double mu;
+
+	PixelState() : exponent(0), reference(0), orbitIndex(0), status(PixelStatus::Running), iterations(0), mu(0.0) {};
+
+	/** Returns true if the pixel needs more iterations to reach the limit*/
+	bool needsWork(long long maxIterations) const { return status == PixelStatus::Running && iterations < maxIterations; };
+
+	/** Returns the pixel's mu at a limit, anything that has not escaped by
+		then counts as inside*/
+	double valueAt(long long maxIterations) const { return status == PixelStatus::Escaped && iterations < maxIterations ? mu : (double)maxIterations; };
+};
@@ -0,0 +1,224 @@
+#include "Progressive.h"
+#include <algorithm>
+
+//Grid spacing of each pass, coarsest first. Tile sizes are multiples of
+//the first, so every tile starts on every grid. A pass between the two
+//would be run 2 pixels apart, and cost more than it shows
+static const int passSteps[] = { 4, 1 };
+static const int passes = sizeof(passSteps) / sizeof(passSteps[0]);
+
+Progressive::Progressive()
+{
+	m_width = 0;
+	m_height = 0;
+	m_tiles = 0;
+	m_next = 0;
+	m_passes = 0;
+}
+
+Progressive::~Progressive()
+{
+}
+
+/** Gets ready to render a width x height view, working from pixel
+	(focusX, focusY) outwards. Call before the render is shown anywhere,
+	it forgets the progress of the last one*/
+void Progressive::begin(int width, int height, int focusX, int focusY)
+{
+	int tiles = ThreadPool::countTiles(width, height);
+	if (tiles != m_tiles)
+	{
+		m_tileSteps.reset(new std::atomic<int>[tiles]);
+		m_tiles = tiles;
+	}
+	m_width = width;
+	m_height = height;
+
+	//Nearest tile centre first
+	focusX = std::max(0, std::min(focusX, width - 1));
+	focusY = std::max(0, std::min(focusY, height - 1));
+	std::vector<long long> distances(tiles);
+	m_order.resize(tiles);
+	for (int i = 0; i < tiles; ++i)
+	{
+		FrameTile tile = ThreadPool::getTile(i, width, height);
+		long long dx = tile.left + tile.right - 2 * focusX;
+		long long dy = tile.top + tile.bottom - 2 * focusY;
+		distances[i] = dx * dx + dy * dy;
+		m_order[i] = i;
+		m_tileSteps[i] = 0;
+	}
+	std::stable_sort(m_order.begin(), m_order.end(), [&distances](int a, int b) { return distances[a] < distances[b]; });
+	m_passes = 0;
+}
+
+/** Returns the number of passes a render takes*/
+int Progressive::getPassCount()
+{
+	return passes;
+}
+
+/** Works out every pixel of the view a pass at a time on the pool, calling
+	finished, if set, with each tile and the grid step it is done to as it
+	is. Stops between passes once the render is cancelled*/
+void Progressive::render(PixelRenderer& pixels, ThreadPool& pool, int threads, const std::function<void(int, int)>& finished)
+{
+	for (int pass = 0; pass < passes && !pixels.isCancelled(); ++pass)
+	{
+		const int step = passSteps[pass];
+		m_next = 0;
+
+		//Threads take tasks in any order, so each task takes the nearest
+		//tile nobody has yet instead of the tile its number says
+		pool.run(m_tiles, threads, [this, &pixels, &finished, step, pass](int)
+		{
+			int tile = m_order[m_next++];
+			computeTile(pixels, tile, step, pass > 0 ? passSteps[pass - 1] : 0);
+			m_tileSteps[tile].store(step, std::memory_order_release);
+			if (finished && !pixels.isCancelled())
+			{
+				finished(tile, step);
+			}
+		});
+
+		if (!pixels.isCancelled())
+		{
+			m_passes.store(pass + 1, std::memory_order_release);
+		}
+	}
+}
+
+/** Works out the pixels of a tile on a grid step pixels apart, less the
+	ones on the grid coarser pixels apart an earlier pass did, if any*/
+void Progressive::computeTile(PixelRenderer& pixels, int tile, int step, int coarser)
+{
+	FrameTile area = ThreadPool::getTile(tile, m_width, m_height);
+	std::vector<int> xs, ys;
+	for (int y = area.top; y < area.bottom; y += step)
+	{
+		//Whole rows run faster as a line than as scattered points
+		bool coarseRow = coarser > 0 && y % coarser == 0;
+		if (step == 1 && !coarseRow)
+		{
+			pixels.computeLine(area.left, y, area.right - area.left, false);
+			continue;
+		}
+
+		//The rest of the tile is gathered into one call, so the kernel's
+		//vectors are as full as they can be. Tiles start on every grid, so
+		//the pixels done already are where x is a multiple of the coarser
+		for (int x = area.left; x < area.right; x += step)
+		{
+			if (coarseRow && x % coarser == 0)
+			{
+				continue;
+			}
+			xs.push_back(x);
+			ys.push_back(y);
+		}
+	}
+
+	//Already on one of the pool's threads
+	pixels.computePoints(xs.data(), ys.data(), (int)xs.size(), 1);
+}
+
+/** Checks that a view rendered in passes comes out the same as one
+	rendered in one go, and that every tile is handed back once a pass,
+	the whole of the first pass before any of the last, and nearest the
+	focus first within a pass. Adds a line to report for each that fails.
+	Returns true if all pass*/
+bool Progressive::check(std::string& report)
+{
+	bool passed = true;
+	auto fail = [&](const std::string& what)
+	{
+		report += "Progressive: " + what + "\n";
+		passed = false;
+	};
+
+	//A few tiles each way of seahorse valley, focused off centre so the
+	//order is not the one the tiles are numbered in
+	const int width = ThreadPool::getTileWidth() * 5;
+	const int height = ThreadPool::getTileHeight() * 4;
+	const int focusX = width * 3 / 4;
+	const int focusY = height / 5;
+	const double pixelSize = 0.02 / width;
+	DoubleDouble left = DoubleDouble(-0.745) - DoubleDouble(0.01);
+	DoubleDouble top = DoubleDouble(0.113) - DoubleDouble(pixelSize * height / 2.0);
+
+	Kernel kernel;
+	ThreadPool pool(1);
+	FrameBuffer whole, passes;
+	whole.create(width, height);
+	passes.create(width, height);
+	PixelRenderer pixels;
+	pixels.setKernel(&kernel, left, top, pixelSize, pixelSize);
+	pixels.setOutput(&whole, 0, height, 1000);
+	pixels.computeTiles(pool, 1, nullptr);
+
+	//Each tile handed back, with its step and distance from the focus as
+	//begin measures it
+	struct Handed
+	{
+		int tile;
+		int step;
+		long long distance;
+	};
+	std::vector<Handed> handed;
+	Progressive progressive;
+	progressive.begin(width, height, focusX, focusY);
+	pixels.setOutput(&passes, 0, height, 1000);
+	progressive.render(pixels, pool, 1, [&](int tile, int step)
+	{
+		FrameTile area = ThreadPool::getTile(tile, width, height);
+		long long dx = area.left + area.right - 2 * focusX;
+		long long dy = area.top + area.bottom - 2 * focusY;
+		handed.push_back({ tile, step, dx * dx + dy * dy });
+	});
+
+	const int tiles = ThreadPool::countTiles(width, height);
+	if ((int)handed.size() != tiles * progressive.getPassCount() || progressive.getPasses() != progressive.getPassCount())
+	{
+		fail("a render did not hand back every tile once a pass");
+	}
+	if (handed.empty())
+	{
+		return false;
+	}
+	FrameTile first = ThreadPool::getTile(handed[0].tile, width, height);
+	if (focusX < first.left || focusX >= first.right || focusY < first.top || focusY >= first.bottom)
+	{
+		fail("the first tile handed back does not hold the focus");
+	}
+	for (size_t i = 1; i < handed.size(); ++i)
+	{
+		if (handed[i].step > handed[i - 1].step)
+		{
+			fail("a tile of the first pass was handed back after one of the last");
+			break;
+		}
+		if (handed[i].step == handed[i - 1].step && handed[i].distance < handed[i - 1].distance)
+		{
+			fail("a tile was handed back before one nearer the focus");
+			break;
+		}
+	}
+	for (int i = 0; i < tiles; ++i)
+	{
+		if (progressive.getTileStep(i) != 1)
+		{
+			fail("a tile was not marked done to every pixel");
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < (size_t)width * height; ++i)
+	{
+		if (whole.getIterations()[i] != passes.getIterations()[i] || whole.getFractions()[i] != passes.getFractions()[i])
+		{
+			fail("a render in passes differs from one in one go");
+			break;
+		}
+	}
+	return passed;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "PixelRenderer.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Progressive rendering of every pixel. The view is worked out in passes,
+//every 4th pixel of every 4th row first, then everything left. No pixel
+//is worked out twice, but pixels far apart share the kernel's vectors
+//less well, so the first pass costs more than its sixteenth and the whole
+//more than one pass. On one thread, the fastest of several goes at the
+//benchmark's views took this much over one pass: home 7 to 15%, seahorse
+//valley 0 to 9%, elephant valley -5 to 14% (in the noise), period 3
+//minibrot 6 to 8%, spiral 0 to 5%, cardioid cusp 13 to 15% and seahorse
+//1e-9 -1 to 2%. The cheap views lose most, where the scattered points of
+//the last pass's coarse rows weigh most against the rest. Working those
+//rows out as whole lines again cost more still. A picture at a sixteenth
+//of the resolution is ready at a tenth of the time all the same. Within a
+//pass the tiles nearest the focus go first.
+//Another thread may watch the tiles finish and show what is done so far,
+//or be handed each tile as it finishes
+class Progressive
+{
+
+public:
+	Progressive();
+	~Progressive();
+
+	void begin(int width, int height, int focusX, int focusY);
+	void render(PixelRenderer& pixels, ThreadPool& pool, int threads, const std::function<void(int, int)>& finished);
+
+	/** Returns the number of passes finished*/
+	int getPasses() { return m_passes.load(std::memory_order_acquire); };
+	int getPassCount();
+
+	/** Returns the spacing of the finest grid of a tile worked out so far,
+		0 for none. The pixels on it may be read from another thread once
+		this says so*/
+	int getTileStep(int tile) { return m_tileSteps[tile].load(std::memory_order_acquire); };
+
+	static bool check(std::string& report);
+
+private:
+	void computeTile(PixelRenderer& pixels, int tile, int step, int coarser);
+
+	//Size of the view in pixels and tiles
+	int m_width, m_height;
+	int m_tiles;
+
+	//Tiles from nearest the focus to furthest, and the next to hand out
+	std::vector<int> m_order;
+	std::atomic<int> m_next;
+
+	//Progress of every tile and of the render
+	std::unique_ptr<std::atomic<int>[]> m_tileSteps;
+	std::atomic<int> m_passes;
+
+};
@@ -1,5 +1,8 @@
 #include "RenderLoop.h"
 
+//Pixels a second the view moves while a numpad arrow is held
+static const float panKeySpeed = 600.0f;
+
 RenderLoop::RenderLoop(sf::RenderWindow* hwnd, Input* dnwh)
 {
 	//Initialises window and input
@@ -25,11 +28,18 @@ RenderLoop::RenderLoop(sf::RenderWindow* hwnd, Input* dnwh)
 	string infoSix = "Press Up/Down to increase/decrease number of threads";
 	string infoSeven = "Press R to go back to the original view";
 	string infoEight = "Press Q to redraw mandelbrot set";
+	string infoNine = "Press S to switch kernel instruction set";
+	string infoTen = "Press P to switch precision";
+	string infoEleven = "Press F to switch fill strategy, V to check it against every pixel";
+	string infoTwelve = "Press H to switch between palette and histogram colouring, C to cycle the colours";
+	string infoThirteen = "Press T to tune threads, instruction set and tiles for this machine";
+	string infoFourteen = "Press Left/Right to go back/forward through the views";
+	string infoFifteen = "Drag with right mouse or press the numpad arrows to move the view";
 	
 	//Initialises controls text
 	m_controlsText.setCharacterSize(18);
 	m_controlsText.setFont(m_font);
-	m_controlsText.setString(infoOne + "\n" + infoTwo + "\n" + infoThree + "\n" + infoFour + "\n" + infoFive + "\n" + infoSix + "\n" + infoSeven + "\n" + infoEight);
+	m_controlsText.setString(infoOne + "\n" + infoTwo + "\n" + infoThree + "\n" + infoFour + "\n" + infoFive + "\n" + infoSix + "\n" + infoSeven + "\n" + infoEight + "\n" + infoNine + "\n" + infoTen + "\n" + infoEleven + "\n" + infoTwelve + "\n" + infoThirteen + "\n" + infoFourteen + "\n" + infoFifteen);
 	m_controlsText.setPosition(10, 5);
 
 	//Initialises controls shape
@@ -40,7 +50,7 @@ RenderLoop::RenderLoop(sf::RenderWindow* hwnd, Input* dnwh)
 	//Initialises mandlebrot info text
 	m_mandlebrotInfoText.setCharacterSize(18);
 	m_mandlebrotInfoText.setFont(m_font);
-	m_mandlebrotInfoText.setString(std::string("Rendering parameters\n \n") + "Precision level: " + m_mbrot.getResolution() + "\n" + "Fractal rendered in 1000 ms" + "\n" + m_mbrot.getColourFrequencies() + "\n" + m_mbrot.getNumberOfThreads());
+	m_mandlebrotInfoText.setString(std::string("Rendering parameters\n \n") + "Precision level: " + m_mbrot.getResolution() + "\n" + "Fractal rendered in 1000 ms" + "\n" + m_mbrot.getColourFrequencies() + "\n" + m_mbrot.getNumberOfThreads() + m_mbrot.getThreadStats() + m_mbrot.getPipelineStats() + m_mbrot.getSpeculation() + m_mbrot.getTileCacheStats() + m_mbrot.getHistoryStats() + m_mbrot.getKernelIsa() + m_mbrot.getTuning() + m_mbrot.getPrecision() + m_mbrot.getZoomWidth() + m_mbrot.getIteratedPixels() + m_mbrot.getFillMode());
 	m_mandlebrotInfoText.setPosition(5, (m_window->getSize().y - m_mandlebrotInfoText.getLocalBounds().height) + 50);
 
 	//Initialises mandlebrot info shape
@@ -48,18 +58,22 @@ RenderLoop::RenderLoop(sf::RenderWindow* hwnd, Input* dnwh)
 	m_mandlebrotInfoShape.setPosition(m_mandlebrotInfoText.getPosition().x - 5, m_mandlebrotInfoText.getPosition().y);
 	m_mandlebrotInfoShape.setFillColor(m_shapeColour);
 
-	//Initialise loading text
-	m_loadingText.setFont(m_font);
-	m_loadingText.setCharacterSize(30);
-	m_loadingText.setString("Loading.....");
-	m_loadingText.setPosition(sf::Vector2f((m_window->getSize().x / 2.0f) - (m_loadingText.getGlobalBounds().width / 2.0f), (m_window->getSize().y / 2.0f) - (m_loadingText.getGlobalBounds().height / 2.0f)));
+	//Initialise rendering text, shown in the top right while a render runs
+	m_renderingText.setFont(m_font);
+	m_renderingText.setCharacterSize(18);
+	m_renderingText.setString("Rendering...");
+	m_renderingText.setPosition(m_window->getSize().x - m_renderingText.getGlobalBounds().width - 15, 5);
+
+	//Initialise rendering text shape
+	m_renderingShape.setSize(sf::Vector2f(m_renderingText.getGlobalBounds().width + 25, m_renderingText.getGlobalBounds().height + 25));
+	m_renderingShape.setPosition(m_renderingText.getPosition().x - 10, -5);
+	m_renderingShape.setFillColor(m_shapeColour);
 
-	//Initialise loading screen shape
-	m_loadingScreenShape.setSize(sf::Vector2f(m_window->getSize()));
-	m_loadingScreenShape.setFillColor(m_shapeColour);
+	//Scheduling tuned for this machine, tuned again once the view is up if
+	//the machine changed
+	m_retune = !m_mbrot.loadTuning();
 
-	//Displays loading message whilst set is created
-	pause();
+	//The set is worked out in the background, the window carries on
 	m_mbrot.computeMandelbrot();
 }
 
@@ -71,11 +85,31 @@ RenderLoop::~RenderLoop()
 /** Updates core data*/
 void RenderLoop::update()
 {
+	//Renders work outwards from the cursor when it is over the window
+	sf::Vector2i mouse = sf::Mouse::getPosition(*m_window);
+	bool inside = mouse.x >= 0 && mouse.y >= 0 && mouse.x < (int)m_window->getSize().x && mouse.y < (int)m_window->getSize().y;
+	m_mbrot.setFocus(inside ? mouse.x : -1, mouse.y);
+
+	//Shows a render as soon as it finishes, and its passes until then
+	m_mbrot.presentFrame();
+	if (m_retune && !m_mbrot.isRendering())
+	{
+		m_retune = false;
+		m_mbrot.autoTune();
+	}
+
+	//Shows how long the render in progress should take yet
+	m_renderingText.setString(m_mbrot.getTimeLeft());
+	m_renderingText.setPosition(m_window->getSize().x - m_renderingText.getGlobalBounds().width - 15, 5);
+	m_renderingShape.setSize(sf::Vector2f(m_renderingText.getGlobalBounds().width + 25, m_renderingText.getGlobalBounds().height + 25));
+	m_renderingShape.setPosition(m_renderingText.getPosition().x - 10, -5);
+
 	//Update mandlebrot info text
 	m_mandlebrotInfoText.setString(std::string("Rendering parameters\n") +  "Resolution: " + m_mbrot.getResolution() +
-											   "\n" +  "Fractal rendered in " + m_mbrot.getLastRenderingTime() + " ms" +
+											   "\n" +  "Fractal rendered in " + m_mbrot.getLastRenderingTime() + " ms" + m_mbrot.getPredictedTime() + m_mbrot.getOnScreenTime() +
 										       "\n" + m_mbrot.getColourFrequencies() + 
-											   m_mbrot.getNumberOfThreads());
+											   m_mbrot.getNumberOfThreads() + m_mbrot.getThreadStats() + m_mbrot.getPipelineStats() + m_mbrot.getSpeculation() + m_mbrot.getTileCacheStats() + m_mbrot.getHistoryStats() + m_mbrot.getKernelIsa() + m_mbrot.getTuning() + m_mbrot.getPrecision() +
+											   m_mbrot.getZoomWidth() + m_mbrot.getIteratedPixels() + m_mbrot.getFillMode());
 }
 
 /** Handles user input*/
@@ -87,7 +121,9 @@ void RenderLoop::handleInput(float dt)
 	}
 	//Resets mandlebrot set
 	else if (m_input->isKeyDown(sf::Keyboard::R)) {
+		m_input->setKeyUp(sf::Keyboard::R);
 		m_mbrot.resetResolution();
+		m_mbrot.setFocus(-1, -1);
 		m_mbrot.computeMandelbrot();
 	}
 	//Decreases resolution
@@ -100,7 +136,7 @@ void RenderLoop::handleInput(float dt)
 	}
 	//Redraws mandlebrot set
 	else if (m_input->isKeyDown(sf::Keyboard::Q)) {
-		pause();
+		m_input->setKeyUp(sf::Keyboard::Q);
 		m_mbrot.computeMandelbrot();
 	}
 	//Increases colour frequency one
@@ -141,14 +177,69 @@ void RenderLoop::handleInput(float dt)
 	else if (m_input->isKeyDown(sf::Keyboard::Down)) {
 		m_mbrot.decreaseThreads(dt);
 	}
+	//Switches kernel instruction set and redraws
+	else if (m_input->isKeyDown(sf::Keyboard::S)) {
+		m_input->setKeyUp(sf::Keyboard::S);
+		m_mbrot.nextKernelIsa();
+		m_mbrot.computeMandelbrot();
+	}
+	//Goes back or forward to a view that was on screen before
+	else if (m_input->isKeyDown(sf::Keyboard::Left)) {
+		m_input->setKeyUp(sf::Keyboard::Left);
+		m_mbrot.navigate(-1);
+	}
+	else if (m_input->isKeyDown(sf::Keyboard::Right)) {
+		m_input->setKeyUp(sf::Keyboard::Right);
+		m_mbrot.navigate(1);
+	}
+	//Tunes the scheduling for this machine in the background, the view is
+	//drawn again once it is done
+	else if (m_input->isKeyDown(sf::Keyboard::T)) {
+		m_input->setKeyUp(sf::Keyboard::T);
+		m_mbrot.autoTune();
+	}
+	//Switches precision tier and redraws
+	else if (m_input->isKeyDown(sf::Keyboard::P)) {
+		m_input->setKeyUp(sf::Keyboard::P);
+		m_mbrot.nextPrecision();
+		m_mbrot.computeMandelbrot();
+	}
+	//Switches fill strategy and redraws
+	else if (m_input->isKeyDown(sf::Keyboard::F)) {
+		m_input->setKeyUp(sf::Keyboard::F);
+		m_mbrot.nextFillMode();
+		m_mbrot.computeMandelbrot();
+	}
+	//Checks the fill strategy against every pixel and redraws
+	else if (m_input->isKeyDown(sf::Keyboard::V)) {
+		m_input->setKeyUp(sf::Keyboard::V);
+		m_mbrot.toggleFillCheck();
+		m_mbrot.computeMandelbrot();
+	}
+	//Colours by histogram or by mu
+	else if (m_input->isKeyDown(sf::Keyboard::H)) {
+		m_input->setKeyUp(sf::Keyboard::H);
+		m_mbrot.toggleColourMode();
+	}
+	//Starts or stops the colours cycling
+	else if (m_input->isKeyDown(sf::Keyboard::C)) {
+		m_input->setKeyUp(sf::Keyboard::C);
+		m_mbrot.toggleCycling();
+	}
+	//Moves the view with the right mouse or the numpad
+	pan(dt);
+
 	//Computes new set if an area has been selected
 	if (m_drawMandelbrot) {
-		pause();
 		eraseRectangle();
+		m_mbrot.setFocus(-1, -1);
 		m_mbrot.computeMandelbrot();
 		m_drawMandelbrot = false;
 	}
 
+	//Moves the colours along while cycling
+	m_mbrot.cycleColours(dt);
+
 }
 
 /** Renders drawable sprites and text to screen*/
@@ -164,6 +255,11 @@ void RenderLoop::render()
 	m_window->draw(m_mandlebrotInfoShape);
 	m_window->draw(m_controlsText);
 	m_window->draw(m_mandlebrotInfoText);
+	if (m_mbrot.isRendering())
+	{
+		m_window->draw(m_renderingShape);
+		m_window->draw(m_renderingText);
+	}
 
 	endDraw();
 }
@@ -191,14 +287,14 @@ void RenderLoop::eraseRectangle()
 void RenderLoop::scaleZoom()
 {
 	//Gets current dimensions
-	double left = m_mbrot.getMbrotDimensions().left;
-	double right = m_mbrot.getMbrotDimensions().right;
-	double top = m_mbrot.getMbrotDimensions().top;
-	double bottom = m_mbrot.getMbrotDimensions().bottom;
+	BigFixed left = m_mbrot.getMbrotDimensions().left;
+	BigFixed right = m_mbrot.getMbrotDimensions().right;
+	BigFixed top = m_mbrot.getMbrotDimensions().top;
+	BigFixed bottom = m_mbrot.getMbrotDimensions().bottom;
 
 	//Calculates scaling values
-	double scaleX = (right - left) / (double)VIEW_WIDTH;
-	double scaleY = (bottom - top) / (double)VIEW_HEIGHT;
+	BigFixed scaleX = (right - left) / (double)VIEW_WIDTH;
+	BigFixed scaleY = (bottom - top) / (double)VIEW_HEIGHT;
 
 	//Checks that selection rectangle is a reasonable size
 	if (std::abs(m_mousePosOne.x - m_mousePosTwo.x) > 15 && std::abs(m_mousePosOne.y - m_mousePosTwo.y) > 15)
@@ -219,26 +315,86 @@ void RenderLoop::scaleZoom()
 		}
 
 		//Calculates new mandlebrot dimensions
-		right = (double)(m_mousePosTwo.x * scaleX) + left;
-		bottom = (double)(m_mousePosTwo.y * scaleY) + top;
-		left = (double)(m_mousePosOne.x * scaleX) + left;
-		top = (double)(m_mousePosOne.y * scaleY) + top;
+		right = BigFixed(m_mousePosTwo.x) * scaleX + left;
+		bottom = BigFixed(m_mousePosTwo.y) * scaleY + top;
+		left = BigFixed(m_mousePosOne.x) * scaleX + left;
+		top = BigFixed(m_mousePosOne.y) * scaleY + top;
 
 		//Sets draw to true
 		m_drawMandelbrot = true;
 
-		//Sets new dimensions
+		//Sets new dimensions, on the lattice so zooming back there finds
+		//the tiles and the ones worked out ahead around the cursor
 		m_mbrot.setMbrotDimensions(left, right, top, bottom);
+		m_mbrot.moveOntoLattice();
+	}
+}
+
+/** Moves the view along with the mouse dragging it, or panKeySpeed
+	pixels a second the way a numpad arrow points, working out only the
+	strips it uncovers, and ends the pan once neither is held*/
+void RenderLoop::pan(float dt)
+{
+	int dx = 0;
+	int dy = 0;
+	bool dragging = m_input->isMouseRightDown();
+	if (dragging)
+	{
+		sf::Vector2i mouse = sf::Mouse::getPosition(*m_window);
+		if (m_panning)
+		{
+			dx = mouse.x - m_panFrom.x;
+			dy = mouse.y - m_panFrom.y;
+		}
+		m_panFrom = mouse;
+	}
+
+	int step = std::max(1, (int)(panKeySpeed * dt));
+	bool keys = false;
+	if (m_input->isKeyDown(sf::Keyboard::Numpad4)) {
+		dx += step;
+		keys = true;
+	}
+	if (m_input->isKeyDown(sf::Keyboard::Numpad6)) {
+		dx -= step;
+		keys = true;
+	}
+	if (m_input->isKeyDown(sf::Keyboard::Numpad8)) {
+		dy += step;
+		keys = true;
 	}
+	if (m_input->isKeyDown(sf::Keyboard::Numpad2)) {
+		dy -= step;
+		keys = true;
+	}
+
+	m_mbrot.pan(dx, dy);
+	if (m_panning && !dragging && !keys)
+	{
+		m_mbrot.finishPan();
+	}
+	m_panning = dragging || keys;
+}
+
+/** Jumps to the view of the lattice nearest a location given as decimals,
+	so a start there can read its tiles from the store, and draws it*/
+void RenderLoop::setLocation(const string& re, const string& im, const string& width)
+{
+	m_mbrot.setLocation(re, im, width);
+	m_mbrot.moveOntoLattice();
+	m_mbrot.computeMandelbrot();
+}
+
+/** Sets how high the iteration limit may be raised*/
+void RenderLoop::setIterationsCap(long long cap)
+{
+	m_mbrot.setIterationsCap(cap);
 }
 
-/** Draws loading screen and gives user feedback*/
-void RenderLoop::pause()
+/** Sets how many MB of computed tiles are kept*/
+void RenderLoop::setCacheBudget(long long megabytes)
 {
-	//Draws loading screen
-    m_window->draw(m_loadingScreenShape);
-	m_window->draw(m_loadingText);
-    endDraw();
+	m_mbrot.setCacheBudget(megabytes);
 }
 
 /** Clears window for drawing*/
@@ -14,7 +14,10 @@ public:
 	void drawRectangle();
 	void eraseRectangle();
 	void scaleZoom();
-	void pause();
+	void pan(float dt);
+	void setLocation(const string& re, const string& im, const string& width);
+	void setIterationsCap(long long cap);
+	void setCacheBudget(long long megabytes);
 
 private:
 	void beginDraw();
@@ -31,10 +34,10 @@ private:
 	sf::Font m_font;
 	sf::Text m_controlsText;
 	sf::Text m_mandlebrotInfoText;
-	sf::Text m_loadingText;
+	sf::Text m_renderingText;
 	sf::RectangleShape m_controlsShape;
 	sf::RectangleShape m_mandlebrotInfoShape;
-	sf::RectangleShape m_loadingScreenShape;
+	sf::RectangleShape m_renderingShape;
 	sf::Color m_shapeColour;
 
 	//For drawing new set
@@ -45,5 +48,14 @@ private:
 	sf::RectangleShape m_select;
 	sf::Vector2f m_mousePosOne, m_mousePosTwo;
 
+	//Whether the view was being panned last time, and where the mouse
+	//dragging it was
+	bool m_panning = false;
+	sf::Vector2i m_panFrom;
+
+	//Whether the tuning profile was for another machine, and is to be tuned
+	//again once the first view is on screen
+	bool m_retune = false;
+
 };
 
@@ -0,0 +1,267 @@
+#pragma once
+
+//AVX-512 intrinsics only arrived in Visual Studio 2017 15.3
+#if !defined(_MSC_VER) || _MSC_VER >= 1911
+#define MBROT_HAVE_AVX512 1
+#endif
+
+//Settings shared by every run in a render
+struct KernelOptions
+{
+	//Iterations to run on top of where each point starts
+	int maxIterations;
+
+	//Stops orbits early once they settle into a cycle
+	bool interiorChecks;
+
+	//How close two orbit points must be to count as a cycle
+	double periodTolerance;
+};
+
+//Vectorised kernels, one per instruction set and number type. Each
+//iterates the points c = (cre[i], cim[i]) on from z = (zre[i], zim[i])
+//and writes the iterations run and the final |z|^2 of every point, or -1
+//for a point caught cycling. Points that reach the limit have their z
+//written back so they can be carried on later
+void iteratePointsSSE2(const float* cre, const float* cim, float* zre, float* zim, int count, const KernelOptions& options, int* iterations, float* norms);
+void iteratePointsSSE2(const double* cre, const double* cim, double* zre, double* zim, int count, const KernelOptions& options, int* iterations, double* norms);
+void iteratePointsAVX2(const float* cre, const float* cim, float* zre, float* zim, int count, const KernelOptions& options, int* iterations, float* norms);
+void iteratePointsAVX2(const double* cre, const double* cim, double* zre, double* zim, int count, const KernelOptions& options, int* iterations, double* norms);
+#if defined(MBROT_HAVE_AVX512)
+void iteratePointsAVX512(const float* cre, const float* cim, float* zre, float* zim, int count, const KernelOptions& options, int* iterations, float* norms);
+void iteratePointsAVX512(const double* cre, const double* cim, double* zre, double* zim, int count, const KernelOptions& options, int* iterations, double* norms);
+#endif
+
+//Bitmask with one bit per lane of a group
+typedef unsigned long long LaneMask;
+
+//Independent packs iterated side by side to hide multiply latency
+static const int packsInFlight = 2;
+
+/** Iterates one group of packsInFlight packs until every lane in active
+	has escaped, reached the limit or (with CheckCycles) come back to within
+	tolerance of the point saved at the last power of two, Brent style.
+	Pack wraps one vector register of Pack::Real and provides load, store,
+	set1, arithmetic and escaped()/less(), which return lane bitmasks of
+	a >= b and a < b. Lanes start from zre/zim and the ones that reach the
+	limit leave their z there. Lanes that finish are recorded and parked at
+	z = c = 0, which is a fixed point, so the loop never has to blend and
+	never runs on infinities. Returns the lanes caught cycling and sets
+	reachedLimit to the lanes that ran to maxIterations*/
+template <class Pack, bool CheckCycles>
+inline LaneMask iterateGroup(const typename Pack::Real* cre, const typename Pack::Real* cim, typename Pack::Real* zre, typename Pack::Real* zim,
+							 LaneMask active, int used, const KernelOptions& options, int* iterations, typename Pack::Real* norms, LaneMask& reachedLimit)
+{
+	typedef typename Pack::Real Real;
+	const int lanes = Pack::Lanes;
+	const int groupSize = lanes * packsInFlight;
+	const int maxIterations = options.maxIterations;
+
+	alignas(64) Real mag[groupSize];
+	alignas(64) Real park[4][groupSize];
+	LaneMask inside = 0;
+	reachedLimit = 0;
+
+	Pack cr[packsInFlight], ci[packsInFlight], zr[packsInFlight], zi[packsInFlight];
+	Pack savedR[packsInFlight], savedI[packsInFlight];
+	for (int p = 0; p < packsInFlight; ++p)
+	{
+		cr[p] = Pack::load(cre + p * lanes);
+		ci[p] = Pack::load(cim + p * lanes);
+		zr[p] = Pack::load(zre + p * lanes);
+		zi[p] = Pack::load(zim + p * lanes);
+		savedR[p] = zr[p];
+		savedI[p] = zi[p];
+	}
+
+	const Pack four = Pack::set1(4.0);
+	const Pack toleranceSq = Pack::set1(options.periodTolerance * options.periodTolerance);
+	int nextSave = 1;
+
+	for (int n = 0; n < maxIterations; ++n)
+	{
+		Pack zr2[packsInFlight], zi2[packsInFlight];
+		LaneMask escaped = 0;
+
+		for (int p = 0; p < packsInFlight; ++p)
+		{
+			zr2[p] = zr[p] * zr[p];
+			zi2[p] = zi[p] * zi[p];
+			escaped |= (LaneMask)Pack::escaped(zr2[p] + zi2[p], four) << (p * lanes);
+		}
+
+		//Records lanes the first time they leave the radius 2 circle
+		escaped &= active;
+		if (escaped)
+		{
+			for (int p = 0; p < packsInFlight; ++p)
+			{
+				Pack::store(mag + p * lanes, zr2[p] + zi2[p]);
+			}
+			for (int i = 0; i < used; ++i)
+			{
+				if (escaped & (1ull << i))
+				{
+					iterations[i] = n;
+					norms[i] = mag[i];
+				}
+			}
+			active &= ~escaped;
+			if (!active)
+			{
+				return inside;
+			}
+
+			//Parks the escaped lanes before they overflow
+			for (int p = 0; p < packsInFlight; ++p)
+			{
+				Pack::store(park[0] + p * lanes, zr[p]);
+				Pack::store(park[1] + p * lanes, zi[p]);
+				Pack::store(park[2] + p * lanes, cr[p]);
+				Pack::store(park[3] + p * lanes, ci[p]);
+			}
+			for (int i = 0; i < used; ++i)
+			{
+				if (escaped & (1ull << i))
+				{
+					park[0][i] = park[1][i] = park[2][i] = park[3][i] = 0.0;
+				}
+			}
+			for (int p = 0; p < packsInFlight; ++p)
+			{
+				zr[p] = Pack::load(park[0] + p * lanes);
+				zi[p] = Pack::load(park[1] + p * lanes);
+				cr[p] = Pack::load(park[2] + p * lanes);
+				ci[p] = Pack::load(park[3] + p * lanes);
+				zr2[p] = zr[p] * zr[p];
+				zi2[p] = zi[p] * zi[p];
+			}
+		}
+
+		for (int p = 0; p < packsInFlight; ++p)
+		{
+			zi[p] = (zr[p] + zr[p]) * zi[p] + ci[p];
+			zr[p] = zr2[p] - zi2[p] + cr[p];
+		}
+
+		if (CheckCycles)
+		{
+			//Lanes whose orbit has come back round to the saved point
+			LaneMask cycled = 0;
+			for (int p = 0; p < packsInFlight; ++p)
+			{
+				Pack dr = zr[p] - savedR[p];
+				Pack di = zi[p] - savedI[p];
+				cycled |= (LaneMask)Pack::less(dr * dr + di * di, toleranceSq) << (p * lanes);
+			}
+
+			cycled &= active;
+			if (cycled)
+			{
+				for (int i = 0; i < used; ++i)
+				{
+					if (cycled & (1ull << i))
+					{
+						iterations[i] = maxIterations;
+						norms[i] = -1.0;
+					}
+				}
+				inside |= cycled;
+				active &= ~cycled;
+				if (!active)
+				{
+					return inside;
+				}
+			}
+
+			if (n + 1 == nextSave)
+			{
+				for (int p = 0; p < packsInFlight; ++p)
+				{
+					savedR[p] = zr[p];
+					savedI[p] = zi[p];
+				}
+				nextSave *= 2;
+			}
+		}
+	}
+
+	//Whatever is still active reached the iteration limit
+	for (int p = 0; p < packsInFlight; ++p)
+	{
+		Pack::store(mag + p * lanes, zr[p] * zr[p] + zi[p] * zi[p]);
+		Pack::store(zre + p * lanes, zr[p]);
+		Pack::store(zim + p * lanes, zi[p]);
+	}
+	for (int i = 0; i < used; ++i)
+	{
+		if (active & (1ull << i))
+		{
+			iterations[i] = maxIterations;
+			norms[i] = mag[i];
+		}
+	}
+
+	reachedLimit = active;
+	return inside;
+}
+
+/** Iterates a list of points a group at a time. With interior checks on,
+	orbits that settle into a cycle are stopped as inside the set. The cycle
+	check costs about as much as an iteration, so like Fractint it is only
+	switched on when the group before ran points to the limit. It stays on
+	while it keeps catching cycles and drops out after a group where it
+	caught none, which halves its cost along bands of slow escaping
+	exterior points*/
+template <class Pack>
+inline void iteratePoints(const typename Pack::Real* cre, const typename Pack::Real* cim, typename Pack::Real* zre, typename Pack::Real* zim,
+						  int count, const KernelOptions& options, int* iterations, typename Pack::Real* norms)
+{
+	typedef typename Pack::Real Real;
+	const int groupSize = Pack::Lanes * packsInFlight;
+
+	alignas(64) Real groupRe[groupSize];
+	alignas(64) Real groupIm[groupSize];
+	alignas(64) Real groupZr[groupSize];
+	alignas(64) Real groupZi[groupSize];
+
+	//The first group always checks for cycles
+	bool checkCycles = options.interiorChecks;
+
+	for (int start = 0; start < count; start += groupSize)
+	{
+		int used = count - start < groupSize ? count - start : groupSize;
+		LaneMask active = (1ull << used) - 1ull;
+
+		//Pads a short group by repeating its last point
+		for (int i = 0; i < groupSize; ++i)
+		{
+			groupRe[i] = cre[start + (i < used ? i : used - 1)];
+			groupIm[i] = cim[start + (i < used ? i : used - 1)];
+			groupZr[i] = zre[start + (i < used ? i : used - 1)];
+			groupZi[i] = zim[start + (i < used ? i : used - 1)];
+		}
+
+		LaneMask reachedLimit;
+		if (checkCycles)
+		{
+			LaneMask cycled = iterateGroup<Pack, true>(groupRe, groupIm, groupZr, groupZi, active, used, options, iterations + start, norms + start, reachedLimit);
+			checkCycles = cycled != 0;
+		}
+		else
+		{
+			iterateGroup<Pack, false>(groupRe, groupIm, groupZr, groupZi, active, used, options, iterations + start, norms + start, reachedLimit);
+			checkCycles = options.interiorChecks && reachedLimit != 0;
+		}
+
+		//Hands back where the points that reached the limit got to
+		for (int i = 0; i < used; ++i)
+		{
+			if (reachedLimit & (1ull << i))
+			{
+				zre[start + i] = groupZr[i];
+				zim[start + i] = groupZi[i];
+			}
+		}
+	}
+}
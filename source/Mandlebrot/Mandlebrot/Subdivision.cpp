@@ -0,0 +1,249 @@
+#include "Subdivision.h"
+#include <algorithm>
+#include <vector>
+
+//Pixels between the grid lines the view is first cut along
+static const int tileSize = 64;
+
+//Tiles with fewer pixels than this across are worked out pixel by pixel,
+//the border checks would cost more than they save
+static const int smallestSplit = 6;
+
+Subdivision::Subdivision()
+{
+	m_skipped = 0.0;
+}
+
+Subdivision::~Subdivision()
+{
+}
+
+/** Works out the grid lines of the view, then fills or splits each tile
+	between them. Tiles share their borders but never their insides, so
+	they are handed out to the threads one at a time*/
+void Subdivision::render(PixelRenderer& pixels, int threads)
+{
+	const int width = pixels.getWidth();
+	const int height = pixels.getHeight();
+
+	//Grid lines every tileSize pixels, and along the far edges
+	std::vector<int> columns, rows;
+	for (int x = 0; x < width - 1; x += tileSize)
+	{
+		columns.push_back(x);
+	}
+	columns.push_back(width - 1);
+	for (int y = 0; y < height - 1; y += tileSize)
+	{
+		rows.push_back(y);
+	}
+	rows.push_back(height - 1);
+
+	const int gaps = (int)columns.size() - 1;
+	const int bands = (int)rows.size() - 1;
+
+	//Whole grid rows first, they lie along the frame, then the columns in
+	//the gaps between them
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+	for (int i = 0; i < (int)rows.size(); ++i)
+	{
+		pixels.computeLine(0, rows[i], width, false);
+	}
+
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+	for (int i = 0; i < (int)columns.size() * bands; ++i)
+	{
+		int top = rows[i % bands];
+		int bottom = rows[i % bands + 1];
+		pixels.computeLine(columns[i / bands], top + 1, bottom - top - 1, true);
+	}
+
+	std::vector<Tile> tiles;
+	for (int i = 0; i < gaps * bands; ++i)
+	{
+		Tile tile = { columns[i % gaps], rows[i / gaps], columns[i % gaps + 1], rows[i / gaps + 1] };
+		tiles.push_back(tile);
+	}
+
+	int filled = 0;
+	std::vector<TileAction> actions;
+	std::vector<Tile> next, busy;
+	std::vector<int> xs, ys;
+
+	for (int generation = 0; !tiles.empty() && !pixels.isCancelled(); ++generation)
+	{
+		//Tiles never share their insides, so they can be filled in parallel
+		actions.resize(tiles.size());
+#pragma omp parallel for schedule(dynamic, 4) num_threads(threads) reduction(+:filled)
+		for (int i = 0; i < (int)tiles.size(); ++i)
+		{
+			actions[i] = checkTile(pixels, tiles[i], filled);
+		}
+
+		//The second generation is the quarters of the grid tiles, four to
+		//a tile in order. Where none was filled the tile is busy, and its
+		//quarters are worked out as rows instead of split again
+		busy.clear();
+		for (int i = 0; generation == 1 && i + 3 < (int)tiles.size(); i += 4)
+		{
+			bool anyFilled = false;
+			for (int quarter = i; quarter < i + 4; ++quarter)
+			{
+				anyFilled = anyFilled || actions[quarter] == TileAction::Filled;
+			}
+			if (!anyFilled)
+			{
+				Tile tile = { tiles[i].left, tiles[i].top, tiles[i + 3].right, tiles[i + 3].bottom };
+				busy.push_back(tile);
+				std::fill(actions.begin() + i, actions.begin() + i + 4, TileAction::Done);
+			}
+		}
+
+		//Gathers the crosses of split tiles and the insides of small ones
+		next.clear();
+		xs.clear();
+		ys.clear();
+		for (int i = 0; i < (int)tiles.size(); ++i)
+		{
+			const Tile& tile = tiles[i];
+			if (actions[i] == TileAction::Compute)
+			{
+				for (int x = tile.left + 1; x < tile.right; ++x)
+				{
+					for (int y = tile.top + 1; y < tile.bottom; ++y)
+					{
+						xs.push_back(x);
+						ys.push_back(y);
+					}
+				}
+			}
+			else if (actions[i] == TileAction::Split)
+			{
+				int midX = (tile.left + tile.right) / 2;
+				int midY = (tile.top + tile.bottom) / 2;
+				for (int y = tile.top + 1; y < tile.bottom; ++y)
+				{
+					xs.push_back(midX);
+					ys.push_back(y);
+				}
+				for (int x = tile.left + 1; x < tile.right; ++x)
+				{
+					if (x != midX)
+					{
+						xs.push_back(x);
+						ys.push_back(midY);
+					}
+				}
+
+				Tile quarters[4] = {
+					{ tile.left, tile.top, midX, midY },
+					{ midX, tile.top, tile.right, midY },
+					{ tile.left, midY, midX, tile.bottom },
+					{ midX, midY, tile.right, tile.bottom } };
+				next.insert(next.end(), quarters, quarters + 4);
+			}
+		}
+
+		pixels.computePoints(xs.data(), ys.data(), (int)xs.size(), threads);
+
+		//Rows either side of the cross, which is worked out already
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+		for (int i = 0; i < (int)busy.size(); ++i)
+		{
+			const Tile& tile = busy[i];
+			int midX = (tile.left + tile.right) / 2;
+			int midY = (tile.top + tile.bottom) / 2;
+			for (int y = tile.top + 1; y < tile.bottom; ++y)
+			{
+				if (y != midY)
+				{
+					pixels.computeLine(tile.left + 1, y, midX - tile.left - 1, false);
+					pixels.computeLine(midX + 1, y, tile.right - midX - 1, false);
+				}
+			}
+		}
+		tiles.swap(next);
+	}
+
+	m_skipped = filled / (double)(width * height);
+}
+
+/** Looks at a tile whose border pixels are already worked out, and fills
+	it if the border is in one band. Otherwise says whether it needs
+	splitting or is small enough to just work out*/
+Subdivision::TileAction Subdivision::checkTile(PixelRenderer& pixels, const Tile& tile, int& filled)
+{
+	const int left = tile.left;
+	const int top = tile.top;
+	const int right = tile.right;
+	const int bottom = tile.bottom;
+
+	//No pixels between the borders
+	if (right - left < 2 || bottom - top < 2)
+	{
+		return TileAction::Done;
+	}
+
+	//Checks every border pixel is trustworthy and in one band
+	long long band = pixels.getBand(left, top);
+	bool uniform = true;
+	for (int x = left; x <= right && uniform; ++x)
+	{
+		uniform = pixels.isTrusted(x, top) && pixels.isTrusted(x, bottom) && pixels.getBand(x, top) == band && pixels.getBand(x, bottom) == band;
+	}
+	for (int y = top + 1; y < bottom && uniform; ++y)
+	{
+		uniform = pixels.isTrusted(left, y) && pixels.isTrusted(right, y) && pixels.getBand(left, y) == band && pixels.getBand(right, y) == band;
+	}
+
+	if (uniform)
+	{
+		filled += fillTile(pixels, left, top, right, bottom, band);
+		return TileAction::Filled;
+	}
+
+	//Small tiles are just worked out
+	if (right - left < smallestSplit || bottom - top < smallestSplit)
+	{
+		return TileAction::Compute;
+	}
+
+	return TileAction::Split;
+}
+
+/** Fills the inside of a tile whose border is all in one band. Inside the
+	set is filled as is. An escaped band is blended in from the border, a
+	Coons patch, so the smooth colouring carries on across the tile*/
+int Subdivision::fillTile(PixelRenderer& pixels, int left, int top, int right, int bottom, long long band)
+{
+	const long long maxIterations = pixels.getMaxIterations();
+
+	//Left unstarted, so a higher limit works them out properly
+	PixelState inside;
+
+	PixelState escaped;
+	escaped.status = PixelStatus::Escaped;
+	escaped.iterations = band;
+
+	for (int y = top + 1; y < bottom; ++y)
+	{
+		double v = (y - top) / (double)(bottom - top);
+		for (int x = left + 1; x < right; ++x)
+		{
+			if (band == maxIterations)
+			{
+				pixels.fill(x, y, inside);
+				continue;
+			}
+
+			double u = (x - left) / (double)(right - left);
+			double edges = (1.0 - v) * pixels.getMu(x, top) + v * pixels.getMu(x, bottom) + (1.0 - u) * pixels.getMu(left, y) + u * pixels.getMu(right, y);
+			double corners = (1.0 - u) * (1.0 - v) * pixels.getMu(left, top) + u * (1.0 - v) * pixels.getMu(right, top) +
+							 (1.0 - u) * v * pixels.getMu(left, bottom) + u * v * pixels.getMu(right, bottom);
+			escaped.mu = edges - corners;
+			pixels.fill(x, y, escaped);
+		}
+	}
+
+	return (right - left - 1) * (bottom - top - 1);
+}
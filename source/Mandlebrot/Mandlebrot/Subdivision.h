@@ -0,0 +1,47 @@
+#pragma once
+#include "PixelRenderer.h"
+
+//Mariani-Silver rendering. The view is cut into tiles whose borders are
+//worked out first. A tile whose whole border sits in one iteration band
+//is filled without iterating its inside, since the set is connected and
+//so nothing from another band can be in there. Otherwise the tile is
+//split in four by a cross of new pixels and each quarter checked again.
+//Tiles are worked through a generation at a time, so the new pixels of
+//every tile in a generation go to the kernel together in full vectors.
+//A tile whose first split fills none of its quarters is busy all over,
+//so the rest of it is worked out a row at a time instead, which the
+//kernel runs faster than the same pixels scattered
+class Subdivision
+{
+
+public:
+	Subdivision();
+	~Subdivision();
+
+	void render(PixelRenderer& pixels, int threads);
+
+	double getSkipped() { return m_skipped; };
+
+private:
+	//A tile spans the pixels between its border lines, which are worked out
+	struct Tile
+	{
+		int left, top, right, bottom;
+	};
+
+	//What a generation does with each tile
+	enum class TileAction
+	{
+		Done,
+		Filled,
+		Split,
+		Compute
+	};
+
+	TileAction checkTile(PixelRenderer& pixels, const Tile& tile, int& filled);
+	int fillTile(PixelRenderer& pixels, int left, int top, int right, int bottom, long long band);
+
+	//Share of the pixels in the last render that were filled
+	double m_skipped;
+
+};
@@ -0,0 +1,301 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+//Tile size in pixels. A tile's mu fits in L1 and its pixel states in L2,
+//and its rows are whole cache lines of every plane of the frame. The
+//tuner may pick another size for the machine
+static int tileWidth = 64;
+static int tileHeight = 32;
+
+ThreadPool::ThreadPool(int threads)
+{
+	m_task = nullptr;
+	m_active = 0;
+	m_run = 0;
+	m_working = 0;
+	m_quit = false;
+	m_remaining = 0;
+
+	threads = std::max(1, threads);
+	for (int i = 0; i < threads; ++i)
+	{
+		m_workers.push_back(std::unique_ptr<Worker>(new Worker()));
+	}
+	resetStats();
+	for (int i = 1; i < threads; ++i)
+	{
+		m_threads.push_back(std::thread(&ThreadPool::wait, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+/** Calls task(0) to task(tasks - 1) on the first threads threads of the
+	pool, the calling thread being one of them, and returns once they
+	have all finished*/
+void ThreadPool::run(int tasks, int threads, const std::function<void(int)>& task)
+{
+	run(tasks, threads, task, nullptr);
+}
+
+/** Runs tasks as above, splitting them between the threads by their
+	predicted costs so each block of neighbouring tasks should take about
+	as long as the others. Null costs splits them evenly by count*/
+void ThreadPool::run(int tasks, int threads, const std::function<void(int)>& task, const double* costs)
+{
+	if (tasks <= 0)
+	{
+		return;
+	}
+	threads = std::max(1, std::min(threads, getSize()));
+
+	//Hands each thread a block of neighbouring tasks
+	std::vector<int> blocks = splitTasks(tasks, threads, costs);
+	for (int i = 0; i < threads; ++i)
+	{
+		Worker& worker = *m_workers[i];
+		std::lock_guard<std::mutex> guard(worker.lock);
+		worker.tasks.clear();
+		for (int t = blocks[i]; t < blocks[i + 1]; ++t)
+		{
+			worker.tasks.push_back(t);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_task = &task;
+		m_active = threads;
+		m_working = threads - 1;
+		m_remaining = tasks;
+		++m_run;
+	}
+	m_wake.notify_all();
+
+	work(0);
+
+	std::unique_lock<std::mutex> guard(m_lock);
+	m_finished.wait(guard, [this] { return m_working == 0; });
+	m_task = nullptr;
+}
+
+/** Splits tasks into threads blocks of neighbouring tasks, of equal count
+	or of about equal cost if the costs are given. Block i is tasks
+	blocks[i] to blocks[i + 1] - 1. A task goes to the block whose share
+	of the total cost its middle falls in*/
+std::vector<int> ThreadPool::splitTasks(int tasks, int threads, const double* costs)
+{
+	double total = 0.0;
+	for (int t = 0; costs && t < tasks; ++t)
+	{
+		total += costs[t];
+	}
+
+	std::vector<int> blocks(threads + 1, 0);
+	double reached = 0.0;
+	for (int i = 0; i < threads; ++i)
+	{
+		int last = (int)((long long)tasks * (i + 1) / threads);
+		if (total > 0.0)
+		{
+			double share = total * (i + 1) / threads;
+			for (last = blocks[i]; last < tasks && (i == threads - 1 || reached + costs[last] / 2.0 < share); ++last)
+			{
+				reached += costs[last];
+			}
+		}
+		blocks[i + 1] = last;
+	}
+	return blocks;
+}
+
+/** Clears every thread's busy and idle times*/
+void ThreadPool::resetStats()
+{
+	for (std::unique_ptr<Worker>& worker : m_workers)
+	{
+		worker->stats.busy = 0.0;
+		worker->stats.idle = 0.0;
+		worker->stats.tasks = 0;
+		worker->stats.steals = 0;
+	}
+}
+
+/** Returns a thread's statistics since they were last reset*/
+ThreadStats ThreadPool::getStats(int thread)
+{
+	return m_workers[thread]->stats;
+}
+
+/** Returns the spread of busy time over the first threads threads, so an
+	uneven split or threads starved of work show up*/
+std::string ThreadPool::getStatsSummary(int threads)
+{
+	threads = std::max(1, std::min(threads, getSize()));
+	double least = 1.0;
+	double total = 0.0;
+	int steals = 0;
+	for (int i = 0; i < threads; ++i)
+	{
+		const ThreadStats& stats = m_workers[i]->stats;
+		double busy = stats.busy + stats.idle > 0.0 ? stats.busy / (stats.busy + stats.idle) : 0.0;
+		least = std::min(least, busy);
+		total += busy;
+		steals += stats.steals;
+	}
+
+	std::stringstream ss;
+	ss << std::fixed;
+	ss.precision(1);
+	ss << "Threads busy: " << 100.0 * total / threads << "% average, " << 100.0 * least << "% least, " << steals << " steals\n";
+	return ss.str();
+}
+
+/** Sets the size of the tiles frames are cut into. Tiles must stay whole
+	cache lines wide and a multiple of 8 pixels each way, for the grids of
+	the progressive passes and the cost probe. Only call with no run in
+	progress and nothing holding on to tile numbers*/
+void ThreadPool::setTileSize(int width, int height)
+{
+	tileWidth = std::max(16, width / 16 * 16);
+	tileHeight = std::max(8, height / 8 * 8);
+}
+
+/** Returns the tile width in pixels*/
+int ThreadPool::getTileWidth()
+{
+	return tileWidth;
+}
+
+/** Returns the tile height in pixels*/
+int ThreadPool::getTileHeight()
+{
+	return tileHeight;
+}
+
+/** Returns the number of tiles a frame is cut into*/
+int ThreadPool::countTiles(int width, int height)
+{
+	return ((width + tileWidth - 1) / tileWidth) * ((height + tileHeight - 1) / tileHeight);
+}
+
+/** Returns a tile of a frame. Tiles go across then down, so neighbouring
+	tasks share rows of the image*/
+FrameTile ThreadPool::getTile(int index, int width, int height)
+{
+	int across = (width + tileWidth - 1) / tileWidth;
+	FrameTile tile;
+	tile.left = (index % across) * tileWidth;
+	tile.top = (index / across) * tileHeight;
+	tile.right = std::min(tile.left + tileWidth, width);
+	tile.bottom = std::min(tile.top + tileHeight, height);
+	return tile;
+}
+
+/** Returns the index of the tile pixel (x, y) of a frame is in*/
+int ThreadPool::findTile(int x, int y, int width)
+{
+	return (y / tileHeight) * ((width + tileWidth - 1) / tileWidth) + x / tileWidth;
+}
+
+/** Loop of a pool thread, sleeping until a run it is part of starts*/
+void ThreadPool::wait(int index)
+{
+	long long seen = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> guard(m_lock);
+			m_wake.wait(guard, [this, seen] { return m_quit || m_run != seen; });
+			if (m_quit)
+			{
+				return;
+			}
+			seen = m_run;
+			if (index >= m_active)
+			{
+				continue;
+			}
+		}
+
+		work(index);
+
+		std::lock_guard<std::mutex> guard(m_lock);
+		if (--m_working == 0)
+		{
+			m_finished.notify_all();
+		}
+	}
+}
+
+/** Runs tasks until every task of the run is finished*/
+void ThreadPool::work(int index)
+{
+	typedef std::chrono::steady_clock Clock;
+	ThreadStats& stats = m_workers[index]->stats;
+	Clock::time_point start = Clock::now();
+	double busy = 0.0;
+
+	while (m_remaining > 0)
+	{
+		int task;
+		if (!takeTask(index, task))
+		{
+			//The last tasks are still running elsewhere
+			std::this_thread::yield();
+			continue;
+		}
+
+		Clock::time_point begun = Clock::now();
+		(*m_task)(task);
+		busy += std::chrono::duration<double, std::milli>(Clock::now() - begun).count();
+		++stats.tasks;
+		--m_remaining;
+	}
+
+	stats.busy += busy;
+	stats.idle += std::chrono::duration<double, std::milli>(Clock::now() - start).count() - busy;
+}
+
+/** Takes the next task off the thread's own deque, or steals the last one
+	off another thread's. Returns false if there is none left to take*/
+bool ThreadPool::takeTask(int index, int& task)
+{
+	{
+		Worker& own = *m_workers[index];
+		std::lock_guard<std::mutex> guard(own.lock);
+		if (!own.tasks.empty())
+		{
+			task = own.tasks.front();
+			own.tasks.pop_front();
+			return true;
+		}
+	}
+
+	for (int i = 1; i < m_active; ++i)
+	{
+		Worker& victim = *m_workers[(index + i) % m_active];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.tasks.empty())
+		{
+			task = victim.tasks.back();
+			victim.tasks.pop_back();
+			++m_workers[index]->stats.steals;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//A rectangle of the frame, right and bottom exclusive, small enough for
+//its mu and pixel states to stay in cache while a thread works on it
+struct FrameTile
+{
+	int left, top, right, bottom;
+};
+
+//Time one thread of the pool spent on tasks and waiting for them
+struct ThreadStats
+{
+	double busy;
+	double idle;
+	int tasks;
+	int steals;
+};
+
+//Runs numbered tasks on threads that are started once and kept from one
+//render to the next, so changing the thread count costs nothing. Each
+//thread starts with its own deque of neighbouring tasks, as many as the
+//others or as costly if the costs are known, and steals from the far end
+//of another's once its own runs out
+class ThreadPool
+{
+
+public:
+	ThreadPool(int threads);
+	~ThreadPool();
+
+	void run(int tasks, int threads, const std::function<void(int)>& task);
+	void run(int tasks, int threads, const std::function<void(int)>& task, const double* costs);
+	void resetStats();
+
+	int getSize() { return (int)m_workers.size(); };
+	ThreadStats getStats(int thread);
+	std::string getStatsSummary(int threads);
+
+	static std::vector<int> splitTasks(int tasks, int threads, const double* costs);
+	static void setTileSize(int width, int height);
+	static int getTileWidth();
+	static int getTileHeight();
+	static int countTiles(int width, int height);
+	static FrameTile getTile(int index, int width, int height);
+	static int findTile(int x, int y, int width);
+
+private:
+	//A thread's own tasks and its statistics
+	struct Worker
+	{
+		std::deque<int> tasks;
+		std::mutex lock;
+		ThreadStats stats;
+	};
+
+	void wait(int index);
+	void work(int index);
+	bool takeTask(int index, int& task);
+
+	//Worker 0 is the thread that calls run, the rest have a thread each
+	std::vector< std::unique_ptr<Worker> > m_workers;
+	std::vector<std::thread> m_threads;
+
+	//The run in progress, threads past m_active sit it out
+	std::mutex m_lock;
+	std::condition_variable m_wake;
+	std::condition_variable m_finished;
+	const std::function<void(int)>* m_task;
+	int m_active;
+	long long m_run;
+	int m_working;
+	bool m_quit;
+
+	//Tasks of the run not finished yet
+	std::atomic<int> m_remaining;
+
+};
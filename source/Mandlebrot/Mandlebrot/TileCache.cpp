@@ -0,0 +1,217 @@
+#include "TileCache.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+//Bytes of pixels a tile holds
+static const size_t tileBytes = cacheTileWidth * cacheTileHeight * (sizeof(uint32_t) + sizeof(uint16_t));
+
+//Budget until one is set, about 20000 tiles or 35 views' worth
+static const size_t defaultBudget = 256 << 20;
+
+TileCache::TileCache()
+{
+	m_budget = defaultBudget;
+	m_bytes = 0;
+	m_hits = 0;
+	m_misses = 0;
+	m_aheadUsed = 0;
+}
+
+TileCache::~TileCache()
+{
+}
+
+/** Returns a tile, marking it the most recently used, or nullptr if it is
+	not cached*/
+const CachedTile* TileCache::find(const TileKey& key)
+{
+	auto found = m_tiles.find(key);
+	if (found == m_tiles.end())
+	{
+		++m_misses;
+		return nullptr;
+	}
+	++m_hits;
+	if (found->second.ahead)
+	{
+		found->second.ahead = false;
+		++m_aheadUsed;
+	}
+	m_order.splice(m_order.begin(), m_order, found->second.used);
+	return &found->second.tile;
+}
+
+/** Keeps a tile's pixels, taken from rows stride pixels apart, evicting
+	the least recently used tiles until it fits in the budget. Ahead marks
+	a tile worked out before a render asked for it. Returns whether the
+	tile is new to the cache*/
+bool TileCache::store(const TileKey& key, const uint32_t* bands, const uint16_t* fractions, int stride, bool ahead)
+{
+	if (contains(key))
+	{
+		return false;
+	}
+	while (!m_order.empty() && m_bytes + tileBytes > m_budget)
+	{
+		m_tiles.erase(m_order.back());
+		m_order.pop_back();
+		m_bytes -= tileBytes;
+	}
+	if (tileBytes > m_budget)
+	{
+		return true;
+	}
+
+	m_order.push_front(key);
+	Entry& entry = m_tiles[key];
+	entry.used = m_order.begin();
+	entry.ahead = ahead;
+	CachedTile& tile = entry.tile;
+	tile.bands.resize(cacheTileWidth * cacheTileHeight);
+	tile.fractions.resize(cacheTileWidth * cacheTileHeight);
+	for (int y = 0; y < cacheTileHeight; ++y)
+	{
+		std::copy(bands + y * stride, bands + y * stride + cacheTileWidth, tile.bands.begin() + y * cacheTileWidth);
+		std::copy(fractions + y * stride, fractions + y * stride + cacheTileWidth, tile.fractions.begin() + y * cacheTileWidth);
+	}
+	m_bytes += tileBytes;
+	return true;
+}
+
+/** Returns the lookups that hit and missed and the memory taken for display*/
+std::string TileCache::getStats()
+{
+	long long hits = m_hits;
+	long long misses = m_misses;
+	std::stringstream ss;
+	ss << std::fixed;
+	ss.precision(1);
+	ss << "Tile cache: " << hits << " hits, " << misses << " misses (" << (hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0) << "%), "
+	   << m_bytes / 1048576.0 << " of " << m_budget / 1048576.0 << " MB\n";
+	return ss.str();
+}
+
+/** Finds the view of the lattice nearest a view of the window's shape,
+	the power of two of the home view nearest its width, centred to under
+	half a pixel from its centre, and gives its level and the lattice pixel
+	of its top left corner. Returns false for views wider than the home
+	view or deeper than the lattice goes*/
+bool TileCache::findNearestView(const DoubleDouble& centreRe, const DoubleDouble& centreIm, double width, int& level, long long& x, long long& y)
+{
+	double nearest = std::floor(std::log2(latticeWidth / width) + 0.5);
+	if (!(nearest >= 0.0 && nearest <= maxCacheLevel))
+	{
+		return false;
+	}
+	level = (int)nearest;
+	x = roundToLattice((centreRe - DoubleDouble(latticeLeft)) / getPixelWidth(level) - DoubleDouble(VIEW_WIDTH / 2.0));
+	y = roundToLattice((centreIm - DoubleDouble(latticeTop)) / getPixelHeight(level) - DoubleDouble(VIEW_HEIGHT / 2.0));
+	return true;
+}
+
+/** Returns the width of a pixel at a level of the lattice*/
+DoubleDouble TileCache::getPixelWidth(int level)
+{
+	DoubleDouble width = DoubleDouble(latticeWidth) / DoubleDouble((double)VIEW_WIDTH);
+	return DoubleDouble(std::ldexp(width.hi, -level), std::ldexp(width.lo, -level));
+}
+
+/** Returns the height of a pixel at a level of the lattice*/
+DoubleDouble TileCache::getPixelHeight(int level)
+{
+	DoubleDouble height = DoubleDouble(latticeHeight) / DoubleDouble((double)VIEW_HEIGHT);
+	return DoubleDouble(std::ldexp(height.hi, -level), std::ldexp(height.lo, -level));
+}
+
+/** Returns a lattice pixel number exactly, whatever its size*/
+DoubleDouble TileCache::toDoubleDouble(long long n)
+{
+	double hi = (double)n;
+	return DoubleDouble(hi, (double)(n - (long long)hi));
+}
+
+/** Returns the lattice pixel number nearest a value, exactly even where a
+	double alone cannot hold it*/
+long long TileCache::roundToLattice(const DoubleDouble& value)
+{
+	double whole = std::floor(value.hi);
+	return (long long)whole + std::llround((value.hi - whole) + value.lo);
+}
+
+/** Returns the tile a lattice pixel falls in along one axis, rounding
+	down for pixels left of or above the lattice's origin*/
+long long TileCache::findTile(long long pixel, int tileSize)
+{
+	return pixel >= 0 ? pixel / tileSize : -((-pixel + tileSize - 1) / tileSize);
+}
+
+/** Checks that lattice pixels are square, and that zooming in, back out
+	and in again about the same point with a rectangle of another size
+	lands on the same view and finds every tile of it cached. Adds a line
+	to report for each that fails. Returns true if all pass*/
+bool TileCache::check(std::string& report)
+{
+	bool passed = true;
+	auto fail = [&](const std::string& what)
+	{
+		report += "TileCache: " + what + "\n";
+		passed = false;
+	};
+
+	if (std::abs((getPixelWidth(0) - getPixelHeight(0)).hi) > getPixelHeight(0).hi * 1e-12)
+	{
+		fail("lattice pixels are not square");
+	}
+
+	//Stores or looks up every tile of a lattice view, counting the misses
+	TileCache cache;
+	std::vector<uint32_t> bands(cacheTileWidth * cacheTileHeight);
+	std::vector<uint16_t> fractions(cacheTileWidth * cacheTileHeight);
+	auto visit = [&](int level, long long x, long long y, bool store)
+	{
+		int missed = 0;
+		for (long long tileY = findTile(y, cacheTileHeight); tileY <= findTile(y + VIEW_HEIGHT - 1, cacheTileHeight); ++tileY)
+		{
+			for (long long tileX = findTile(x, cacheTileWidth); tileX <= findTile(x + VIEW_WIDTH - 1, cacheTileWidth); ++tileX)
+			{
+				TileKey key = { level, tileX, tileY, 500, KernelPrecision::Double, KernelIsa::Scalar };
+				if (store)
+				{
+					cache.store(key, bands.data(), fractions.data(), cacheTileWidth, false);
+				}
+				else if (!cache.find(key))
+				{
+					++missed;
+				}
+			}
+		}
+		return missed;
+	};
+
+	DoubleDouble centreRe(-0.7453);
+	DoubleDouble centreIm(0.1127);
+	int level, homeLevel, againLevel;
+	long long x, y, homeX, homeY, againX, againY;
+	if (findNearestView(DoubleDouble(-0.75), DoubleDouble(0.0), latticeWidth * 1.5, level, x, y))
+	{
+		fail("a view wider than the home view is on the lattice");
+	}
+	if (!findNearestView(centreRe, centreIm, 0.011, level, x, y) || !findNearestView(DoubleDouble(-0.75), DoubleDouble(0.0), latticeWidth, homeLevel, homeX, homeY) ||
+		!findNearestView(centreRe, centreIm, 0.0085, againLevel, againX, againY))
+	{
+		fail("a zoom is not on the lattice");
+		return false;
+	}
+	if (homeLevel != 0 || homeX != 0 || homeY != 0)
+	{
+		fail("the home view is not the lattice's origin");
+	}
+	visit(level, x, y, true);
+	visit(homeLevel, homeX, homeY, true);
+	if (againLevel != level || againX != x || againY != y || visit(againLevel, againX, againY, false) != 0)
+	{
+		fail("zooming back in with another rectangle misses the cache");
+	}
+	return passed;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include "Constants.h"
+#include "DoubleDouble.h"
+#include "Kernel.h"
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Views that can share pixels sit on a lattice anchored at the home view.
+//Level 0 is the home view's pixel grid and each level halves the pixel
+//size, so a view on the lattice is a level and the lattice pixel of its
+//top left corner, and its tiles line up with every other view's there.
+//The home view is centred on -0.75 and as wide as square pixels make it
+const double latticeTop = -1.15;
+const double latticeHeight = 2.3;
+const double latticeWidth = latticeHeight * VIEW_WIDTH / VIEW_HEIGHT;
+const double latticeLeft = -0.75 - latticeWidth / 2.0;
+
+//Pixels of a cached tile, on the lattice of its level
+const int cacheTileWidth = 64;
+const int cacheTileHeight = 32;
+
+//Deepest level tiles are cached for. Past it lattice pixel numbers near
+//the edge of the set would not fit in 64 bits
+const int maxCacheLevel = 48;
+
+//A tile's place in the quadtree, tile (x, y) of its level, and the
+//settings its pixels depend on
+struct TileKey
+{
+	int level;
+	long long x, y;
+	long long maxIterations;
+	KernelPrecision precision;
+	KernelIsa isa;
+
+	bool operator==(const TileKey& other) const
+	{
+		return level == other.level && x == other.x && y == other.y && maxIterations == other.maxIterations && precision == other.precision &&
+			   isa == other.isa;
+	};
+};
+
+struct TileKeyHash
+{
+	size_t operator()(const TileKey& key) const
+	{
+		size_t hash = (size_t)key.level * 0x9E3779B97F4A7C15ull;
+		hash ^= (size_t)key.x * 0xC2B2AE3D27D4EB4Full + (hash << 6) + (hash >> 2);
+		hash ^= (size_t)key.y * 0x165667B19E3779F9ull + (hash << 6) + (hash >> 2);
+		hash ^= (size_t)key.maxIterations + ((size_t)key.precision << 8) + ((size_t)key.isa << 12) + (hash << 6) + (hash >> 2);
+		return hash;
+	};
+};
+
+//Bands and mu fractions of a tile's pixels, row after row
+struct CachedTile
+{
+	std::vector<uint32_t> bands;
+	std::vector<uint16_t> fractions;
+};
+
+//Tiles of the lattice, from renders and worked out ahead of being asked
+//for, looked up by renders of views on the lattice. Holds as many as fit
+//in its budget and evicts the least recently used first. Only the render
+//thread looks tiles up and stores them, the budget and counts may be used
+//from any thread
+class TileCache
+{
+
+public:
+	TileCache();
+	~TileCache();
+
+	const CachedTile* find(const TileKey& key);
+	bool contains(const TileKey& key) { return m_tiles.count(key) > 0; };
+	bool store(const TileKey& key, const uint32_t* bands, const uint16_t* fractions, int stride, bool ahead);
+	void setBudget(size_t bytes) { m_budget = bytes; };
+
+	size_t getTileCount() { return m_tiles.size(); };
+	size_t getBytes() { return m_bytes; };
+	long long getAheadUsed() { return m_aheadUsed; };
+	std::string getStats();
+
+	static bool findNearestView(const DoubleDouble& centreRe, const DoubleDouble& centreIm, double width, int& level, long long& x, long long& y);
+	static DoubleDouble getPixelWidth(int level);
+	static DoubleDouble getPixelHeight(int level);
+	static DoubleDouble toDoubleDouble(long long n);
+	static long long roundToLattice(const DoubleDouble& value);
+	static long long findTile(long long pixel, int tileSize);
+	static bool check(std::string& report);
+
+private:
+	//A tile, its place in the order of use, and whether it was worked out
+	//ahead and no render has used it yet
+	struct Entry
+	{
+		CachedTile tile;
+		std::list<TileKey>::iterator used;
+		bool ahead;
+	};
+
+	//Tiles, and their keys from the most recently used to the least
+	std::unordered_map<TileKey, Entry, TileKeyHash> m_tiles;
+	std::list<TileKey> m_order;
+
+	//Bytes of pixels the tiles may take and take, and lookups that found
+	//their tile and did not, and tiles worked out ahead that a render used
+	std::atomic<size_t> m_budget;
+	std::atomic<size_t> m_bytes;
+	std::atomic<long long> m_hits, m_misses, m_aheadUsed;
+
+};
@@ -0,0 +1,314 @@
+#include "TilePipeline.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+//Finished tiles the colouring queue holds, enough for every pass of every
+//tile at the smallest tile size tuning tries
+static const size_t computedCapacity = 16384;
+
+//Packing slots, the most tiles that can wait to be uploaded. Colouring
+//waits for the upload once they are all in use
+static const int packingSlots = 256;
+
+TilePipeline::TilePipeline() : m_computed(computedCapacity), m_packed(packingSlots), m_free(packingSlots)
+{
+	m_frame = nullptr;
+	m_maxIterations = 0;
+	m_firstRow = 0;
+	m_height = 0;
+	m_axis = -1;
+	m_tiles = 0;
+	m_pushed = 0;
+	m_processed = 0;
+	m_finalTiles = 0;
+	m_slotWaits = 0;
+	m_dropping = false;
+	m_busyTime = 0;
+	m_quit = false;
+
+	m_slots.resize(packingSlots);
+	for (int i = 0; i < packingSlots; ++i)
+	{
+		m_free.push(i);
+	}
+	m_free.resetStats();
+	m_thread = std::thread(&TilePipeline::colourWorker, this);
+}
+
+TilePipeline::~TilePipeline()
+{
+	cancel();
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+	m_thread.join();
+}
+
+/** Gets ready to stream a render of height rows from firstRow down into a
+	frame, coloured with a copy of a palette. Call only while idle, with
+	nothing pushed since the last render was finished or cancelled*/
+void TilePipeline::begin(FrameBuffer* frame, const Palette& palette, long long maxIterations, int firstRow, int height, int axis)
+{
+	m_frame = frame;
+	m_palette = palette;
+	m_maxIterations = (uint32_t)maxIterations;
+	m_firstRow = firstRow;
+	m_height = height;
+	m_axis = axis;
+	m_tiles = ThreadPool::countTiles(VIEW_WIDTH, height);
+	m_finalTiles = 0;
+	m_slotWaits = 0;
+	m_busyTime = 0;
+	m_computed.resetStats();
+	m_packed.resetStats();
+	m_free.resetStats();
+
+	//Slots and sample rows fit the tile size in use
+	const size_t tileSize = (size_t)ThreadPool::getTileWidth() * ThreadPool::getTileHeight() * 4;
+	for (PackedTile& slot : m_slots)
+	{
+		slot.rgba.resize(tileSize);
+	}
+	m_bands.resize(ThreadPool::getTileWidth());
+	m_fractions.resize(ThreadPool::getTileWidth());
+	m_colours.resize(ThreadPool::getTileWidth());
+}
+
+/** Hands a tile over to be coloured once a pass has finished it. Called
+	from the render's threads*/
+void TilePipeline::pushTile(int tile, int step)
+{
+	while (!m_computed.push({ tile, step }))
+	{
+		std::this_thread::yield();
+	}
+	m_pushed.fetch_add(1, std::memory_order_release);
+	wake();
+}
+
+/** Returns the next packed tile to upload, or nullptr if there is none yet.
+	Hand it back with release once uploaded*/
+PackedTile* TilePipeline::takePacked()
+{
+	int slot;
+	return m_packed.pop(slot) ? &m_slots[slot] : nullptr;
+}
+
+/** Frees a packed tile's slot for colouring to pack into again*/
+void TilePipeline::release(PackedTile* packed)
+{
+	m_free.push((int)(packed - m_slots.data()));
+	wake();
+}
+
+/** Wakes the colouring thread if it sleeps on an empty queue or a full
+	upload. Taking the lock first means it cannot be between looking for
+	work and going to sleep, so no wake is missed*/
+void TilePipeline::wake()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+	}
+	m_wake.notify_one();
+}
+
+/** Returns whether every tile pushed so far has been coloured. The packed
+	ones may still be waiting to be uploaded*/
+bool TilePipeline::isIdle()
+{
+	return m_processed.load(std::memory_order_acquire) == m_pushed.load(std::memory_order_acquire);
+}
+
+/** Returns whether every tile of the render has been coloured at full
+	resolution, mirrored rows included, so the frame needs no colouring of
+	its own*/
+bool TilePipeline::isComplete()
+{
+	return isIdle() && m_finalTiles == m_tiles;
+}
+
+/** Throws away the tiles of a render that was cancelled, waiting for the
+	colouring thread to get through the ones it has. The render's threads
+	must have stopped pushing*/
+void TilePipeline::cancel()
+{
+	m_dropping = true;
+	wake();
+	while (!isIdle())
+	{
+		std::this_thread::yield();
+	}
+	PackedTile* packed;
+	while ((packed = takePacked()) != nullptr)
+	{
+		release(packed);
+	}
+	m_pushed = 0;
+	m_processed = 0;
+	m_dropping = false;
+}
+
+/** Runs on the colouring thread, colouring tiles as they are pushed until
+	the pipeline is destroyed*/
+void TilePipeline::colourWorker()
+{
+	std::unique_lock<std::mutex> guard(m_lock);
+	while (!m_quit)
+	{
+		m_wake.wait(guard, [this] { return m_quit || m_computed.getSize() > 0; });
+		guard.unlock();
+
+		TileUpdate update;
+		while (m_computed.pop(update))
+		{
+			if (!m_dropping)
+			{
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				colourTile(update);
+				m_busyTime += (long long)std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+			}
+			m_processed.fetch_add(1, std::memory_order_release);
+		}
+		guard.lock();
+	}
+}
+
+/** Colours a tile and packs it, and the rows mirroring it, for upload. At
+	full resolution the colours go into the frame as well, otherwise only
+	the pixels on the grid are coloured and every pixel takes the colour of
+	the nearest one up and left of it, as the preview of a pass does*/
+void TilePipeline::colourTile(const TileUpdate& update)
+{
+	PackedTile* packed = takeSlot();
+	if (packed == nullptr)
+	{
+		return;
+	}
+	FrameTile area = ThreadPool::getTile(update.tile, VIEW_WIDTH, m_height);
+	const int width = area.right - area.left;
+	const int step = update.step;
+	packed->left = area.left;
+	packed->top = m_firstRow + area.top;
+	packed->width = width;
+	packed->height = area.bottom - area.top;
+
+	const uint32_t* bands = m_frame->getIterations();
+	const uint16_t* fractions = m_frame->getFractions();
+	uint32_t* out = (uint32_t*)packed->rgba.data();
+	for (int y = area.top; y < area.bottom; y += step)
+	{
+		size_t start = (size_t)(m_firstRow + y) * VIEW_WIDTH + area.left;
+		uint32_t* row = out + (y - area.top) * width;
+		if (step == 1)
+		{
+			uint8_t* rgba = m_frame->getRgba() + start * 4;
+			m_palette.colourPixels(bands + start, fractions + start, width, m_maxIterations, rgba);
+			std::copy(rgba, rgba + width * 4, (uint8_t*)row);
+			continue;
+		}
+
+		//Tiles start on every grid, so the samples are every step-th pixel
+		//of the row from the tile's left
+		const int samples = (width + step - 1) / step;
+		for (int i = 0; i < samples; ++i)
+		{
+			m_bands[i] = bands[start + i * step];
+			m_fractions[i] = fractions[start + i * step];
+		}
+		m_palette.colourPixels(m_bands.data(), m_fractions.data(), samples, m_maxIterations, (uint8_t*)m_colours.data());
+		for (int x = 0; x < width; ++x)
+		{
+			row[x] = m_colours[x / step];
+		}
+		for (int below = y + 1; below < std::min(y + step, area.bottom); ++below)
+		{
+			std::copy(row, row + width, out + (below - area.top) * width);
+		}
+	}
+
+	if (m_axis >= 0)
+	{
+		packMirror(*packed, step == 1);
+	}
+	m_packed.push((int)(packed - m_slots.data()));
+	if (step == 1)
+	{
+		++m_finalTiles;
+	}
+}
+
+/** Packs the rows that mirror a packed tile in the real axis, its own rows
+	in reverse, and copies them into the frame as well if asked. Rows of the
+	view outside the worked out ones are all mirrored*/
+void TilePipeline::packMirror(const PackedTile& source, bool toFrame)
+{
+	int top = VIEW_HEIGHT, bottom = 0;
+	for (int y = source.top; y < source.top + source.height; ++y)
+	{
+		int mirror = m_axis - y;
+		if (mirror >= 0 && mirror < VIEW_HEIGHT && (mirror < m_firstRow || mirror >= m_firstRow + m_height))
+		{
+			top = std::min(top, mirror);
+			bottom = std::max(bottom, mirror + 1);
+		}
+	}
+	if (top >= bottom)
+	{
+		return;
+	}
+
+	PackedTile* packed = takeSlot();
+	if (packed == nullptr)
+	{
+		return;
+	}
+	const int rowBytes = source.width * 4;
+	packed->left = source.left;
+	packed->top = top;
+	packed->width = source.width;
+	packed->height = bottom - top;
+	for (int mirror = top; mirror < bottom; ++mirror)
+	{
+		const uint8_t* row = source.rgba.data() + (m_axis - mirror - source.top) * rowBytes;
+		std::copy(row, row + rowBytes, packed->rgba.data() + (mirror - top) * rowBytes);
+		if (toFrame)
+		{
+			std::copy(row, row + rowBytes, m_frame->getRgba() + ((size_t)mirror * VIEW_WIDTH + source.left) * 4);
+		}
+	}
+	m_packed.push((int)(packed - m_slots.data()));
+}
+
+/** Takes a free packing slot, waiting for the upload to free one if they
+	are all in use. Returns nullptr if the render is cancelled meanwhile*/
+PackedTile* TilePipeline::takeSlot()
+{
+	int slot;
+	bool waited = false;
+	while (!m_free.pop(slot))
+	{
+		if (m_dropping)
+		{
+			return nullptr;
+		}
+		waited = true;
+		std::unique_lock<std::mutex> guard(m_lock);
+		m_wake.wait(guard, [this] { return m_dropping || m_free.getSize() > 0; });
+	}
+	m_slotWaits += waited ? 1 : 0;
+	return &m_slots[slot];
+}
+
+/** Returns how full each queue between the stages has been this render,
+	for display*/
+std::string TilePipeline::getStats()
+{
+	std::stringstream ss;
+	ss << "Pipeline: colour queue peak " << m_computed.getPeak() << "/" << m_computed.getCapacity() << ", upload queue peak " << m_packed.getPeak() << "/"
+	   << m_packed.getCapacity() << ", " << m_slotWaits << " waits for upload, colouring busy " << m_busyTime / 1000 << " ms\n";
+	return ss.str();
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "Constants.h"
+#include "BoundedQueue.h"
+#include "FrameBuffer.h"
+#include "Palette.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//A tile of the view finished down to a grid step pixels apart
+struct TileUpdate
+{
+	int tile;
+	int step;
+};
+
+//Colours of a rectangle of the view packed row after row, ready to upload
+struct PackedTile
+{
+	int left, top, width, height;
+	std::vector<uint8_t> rgba;
+};
+
+//Colours and packs the tiles of a progressive render while the rest of it
+//is still being worked out. The render's threads push each tile as a pass
+//finishes it, a thread of its own colours and packs them, and whoever
+//draws the view uploads the packed tiles, so the picture is on screen
+//moments after the last pixel rather than after a pass over the whole
+//frame. The stages hand over through lock-free queues of fixed size: one
+//of finished tiles, one of packed tiles and one of free packing slots.
+//Only colouring by the palette streams, histogram colours are not known
+//before the last pixel
+class TilePipeline
+{
+
+public:
+	TilePipeline();
+	~TilePipeline();
+
+	void begin(FrameBuffer* frame, const Palette& palette, long long maxIterations, int firstRow, int height, int axis);
+	void pushTile(int tile, int step);
+	PackedTile* takePacked();
+	void release(PackedTile* packed);
+	bool isIdle();
+	bool isComplete();
+	void cancel();
+	std::string getStats();
+
+private:
+	void colourWorker();
+	void wake();
+	void colourTile(const TileUpdate& update);
+	PackedTile* takeSlot();
+	void packMirror(const PackedTile& source, bool toFrame);
+
+	//The render being streamed: the frame it writes, the rows of the view
+	//it works out and the axis the rest are mirrored in, -1 for none. The
+	//palette is a copy, so the view can rebuild its own meanwhile
+	FrameBuffer* m_frame;
+	Palette m_palette;
+	uint32_t m_maxIterations;
+	int m_firstRow, m_height;
+	int m_axis;
+	int m_tiles;
+
+	//Finished tiles waiting to be coloured, and how many have been pushed
+	//and dealt with. The render's threads never wait on colouring, the
+	//queue holds every pass of every tile
+	BoundedQueue<TileUpdate> m_computed;
+	std::atomic<int> m_pushed;
+	std::atomic<int> m_processed;
+
+	//Tiles coloured at full resolution, into the frame itself
+	std::atomic<int> m_finalTiles;
+
+	//Packing slots, the ones packed and waiting to be uploaded, the ones
+	//free, and the times colouring waited on the upload for one
+	std::vector<PackedTile> m_slots;
+	BoundedQueue<int> m_packed;
+	BoundedQueue<int> m_free;
+	std::atomic<int> m_slotWaits;
+
+	//Set while a cancelled render's tiles are thrown away
+	std::atomic<bool> m_dropping;
+
+	//Bands, mu and colours of a row of samples for the coarse passes
+	std::vector<uint32_t> m_bands;
+	std::vector<uint16_t> m_fractions;
+	std::vector<uint32_t> m_colours;
+
+	//Microseconds the colouring thread spent on tiles
+	std::atomic<long long> m_busyTime;
+
+	//The colouring thread sleeps on m_wake when there is nothing to do or
+	//nowhere to pack, and pushes, releases and cancelling wake it
+	std::thread m_thread;
+	std::mutex m_lock;
+	std::condition_variable m_wake;
+	bool m_quit;
+
+};
@@ -0,0 +1,567 @@
+#include "TileStore.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+//Marks a store file, and the layout it was written with
+static const char storeMagic[8] = { 'M', 'B', 'T', 'I', 'L', 'E', 'S', '\0' };
+static const uint32_t storeFormat = 2;
+
+//Slots a tile may go in, the least recently used of them is replaced
+static const int storeWays = 8;
+
+//Milliseconds a slot may stay odd before it is taken as left by a process
+//that died writing it, far longer than writing a tile takes
+static const int64_t staleWriteMilliseconds = 10000;
+
+//Bytes before the first slot, a page so the slots start page aligned
+static const size_t headerBytes = 4096;
+
+//Bytes of a tile's bands, and of its bands and fractions after them
+static const size_t bandBytes = cacheTileWidth * cacheTileHeight * sizeof(uint32_t);
+static const size_t pixelBytes = bandBytes + cacheTileWidth * cacheTileHeight * sizeof(uint16_t);
+
+//Bytes of a slot, its key and state then its pixels
+static const size_t slotHeaderBytes = 64;
+static const size_t slotBytes = slotHeaderBytes + pixelBytes;
+
+//Describes the store, written once when it is made. The clock goes up
+//with every tile read or written, for finding the least recently used
+struct TileStore::Header
+{
+	char magic[8];
+	uint32_t format;
+	uint32_t slotBytes;
+	int32_t tileWidth, tileHeight;
+	double latticeLeft, latticeTop, latticeWidth, latticeHeight;
+	uint64_t slots;
+	std::atomic<uint64_t> clock;
+};
+
+//Key and state of a slot, followed by its tile's pixels. The sequence is
+//0 for a slot never written, odd while a process writes it and even once
+//it is done. Claimed is when the last writer took it, in milliseconds
+struct TileStore::Slot
+{
+	std::atomic<uint32_t> sequence;
+	uint32_t checksum;
+	std::atomic<uint64_t> used;
+	std::atomic<int64_t> claimed;
+	int64_t x, y, maxIterations;
+	int32_t level;
+	uint8_t precision, isa;
+	uint8_t padding[10];
+};
+
+TileStore::TileStore()
+{
+	m_header = nullptr;
+	m_sets = 0;
+	m_hits = 0;
+	m_bad = 0;
+	m_written = 0;
+}
+
+TileStore::~TileStore()
+{
+	close();
+}
+
+/** Opens a store, making it bytes long if it does not exist. Returns
+	false, leaving the store closed, if it cannot be mapped or was written
+	with another layout*/
+bool TileStore::open(const std::string& path, size_t bytes)
+{
+	static_assert(sizeof(Slot) == slotHeaderBytes, "store slots must keep their pixels 64 byte aligned");
+	close();
+	if (bytes < headerBytes + storeWays * slotBytes || !m_file.open(path, bytes) || m_file.getSize() < headerBytes + storeWays * slotBytes)
+	{
+		m_file.close();
+		return false;
+	}
+
+	//A new file is all zeros, and gets its header. Processes making it at
+	//once write the same one
+	Header* header = (Header*)m_file.getData();
+	uint64_t slots = (m_file.getSize() - headerBytes) / slotBytes / storeWays * storeWays;
+	if (header->magic[0] == 0)
+	{
+		header->format = storeFormat;
+		header->slotBytes = (uint32_t)slotBytes;
+		header->tileWidth = cacheTileWidth;
+		header->tileHeight = cacheTileHeight;
+		header->latticeLeft = latticeLeft;
+		header->latticeTop = latticeTop;
+		header->latticeWidth = latticeWidth;
+		header->latticeHeight = latticeHeight;
+		header->slots = slots;
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy(header->magic, storeMagic, sizeof(storeMagic));
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	if (std::memcmp(header->magic, storeMagic, sizeof(storeMagic)) != 0 || header->format != storeFormat || header->slotBytes != slotBytes ||
+		header->tileWidth != cacheTileWidth || header->tileHeight != cacheTileHeight || header->latticeLeft != latticeLeft ||
+		header->latticeTop != latticeTop || header->latticeWidth != latticeWidth || header->latticeHeight != latticeHeight || header->slots != slots)
+	{
+		std::clog << "Tile store " << path << " was written with another layout, run --store-gc to start it again\n";
+		m_file.close();
+		return false;
+	}
+	m_header = header;
+	m_sets = slots / storeWays;
+	return true;
+}
+
+/** Closes the store, if it is open*/
+void TileStore::close()
+{
+	m_header = nullptr;
+	m_sets = 0;
+	m_file.close();
+}
+
+/** Reads a tile into tile. Returns false if the store does not have it
+	whole and undamaged*/
+bool TileStore::load(const TileKey& key, CachedTile& tile)
+{
+	if (!isOpen())
+	{
+		return false;
+	}
+	Slot* set = findSet(key);
+	for (int way = 0; way < storeWays; ++way)
+	{
+		Slot* slot = getWay(set, way);
+		uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+		if (sequence & 1)
+		{
+			reclaim(slot, sequence);
+			continue;
+		}
+		if (sequence == 0 || !isKey(slot, key))
+		{
+			continue;
+		}
+
+		const uint8_t* pixels = getPixels(slot);
+		tile.bands.resize(cacheTileWidth * cacheTileHeight);
+		tile.fractions.resize(cacheTileWidth * cacheTileHeight);
+		std::memcpy(tile.bands.data(), pixels, bandBytes);
+		std::memcpy(tile.fractions.data(), pixels + bandBytes, pixelBytes - bandBytes);
+
+		//Another process writing it meanwhile makes the copy worthless
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot->sequence.load(std::memory_order_relaxed) != sequence || !isKey(slot, key))
+		{
+			return false;
+		}
+
+		//The checksum is of the copy, so whatever was read is what is checked
+		if (getChecksum(key, (const uint8_t*)tile.bands.data(), (const uint8_t*)tile.fractions.data()) != slot->checksum)
+		{
+			++m_bad;
+			return false;
+		}
+		slot->used.store(m_header->clock++, std::memory_order_relaxed);
+		++m_hits;
+		return true;
+	}
+	return false;
+}
+
+/** Writes a tile's pixels, taken from rows stride pixels apart, over the
+	slot that has it or else the least recently used of its set. Gives up
+	if another process is writing that slot*/
+void TileStore::save(const TileKey& key, const uint32_t* bands, const uint16_t* fractions, int stride)
+{
+	if (!isOpen())
+	{
+		return;
+	}
+	uint32_t sequence;
+	Slot* slot = claim(key, true, sequence);
+	if (!slot)
+	{
+		return;
+	}
+
+	uint8_t* pixels = getPixels(slot);
+	uint32_t* slotBands = (uint32_t*)pixels;
+	uint16_t* slotFractions = (uint16_t*)(pixels + bandBytes);
+	for (int y = 0; y < cacheTileHeight; ++y)
+	{
+		std::memcpy(slotBands + y * cacheTileWidth, bands + y * stride, cacheTileWidth * sizeof(uint32_t));
+		std::memcpy(slotFractions + y * cacheTileWidth, fractions + y * stride, cacheTileWidth * sizeof(uint16_t));
+	}
+	slot->checksum = getChecksum(key, pixels, pixels + bandBytes);
+	slot->used.store(m_header->clock++, std::memory_order_relaxed);
+
+	//A process that took so long the slot was taken back leaves it be
+	uint32_t written = sequence + 1;
+	if (slot->sequence.compare_exchange_strong(written, sequence + 2, std::memory_order_release))
+	{
+		++m_written;
+	}
+}
+
+/** Returns what the store has done this session and its size for display*/
+std::string TileStore::getStats()
+{
+	std::stringstream ss;
+	if (!isOpen())
+	{
+		ss << "Tile store: closed\n";
+		return ss.str();
+	}
+	ss << "Tile store: " << m_hits << " read, " << m_written << " written, " << m_bad << " damaged, " << (m_file.getSize() >> 20) << " MB\n";
+	return ss.str();
+}
+
+/** Rewrites a store into a new file megabytes long, or as long as it was
+	for 0, keeping the most recently used tiles that are whole and
+	undamaged and dropping the rest, then puts it in place of the old one.
+	A store that cannot be read starts again empty, one that does not
+	exist is not made. Viewers should be closed meanwhile, one still open
+	keeps the old file. Returns false if the new file cannot be made*/
+bool TileStore::compact(const std::string& path, long long megabytes, std::string& report)
+{
+	std::FILE* existing = std::fopen(path.c_str(), "rb");
+	if (!existing)
+	{
+		report = "No tile store at " + path + "\n";
+		return true;
+	}
+	std::fclose(existing);
+
+	//The file exists, so opening it keeps its size
+	TileStore source;
+	source.open(path, (size_t)defaultStoreMegabytes << 20);
+
+	//Intact tiles, the most recently used first
+	std::vector<std::pair<uint64_t, uint64_t>> intact;
+	long long damaged = 0;
+	uint64_t slots = source.isOpen() ? source.m_header->slots : 0;
+	for (uint64_t i = 0; i < slots; ++i)
+	{
+		Slot* slot = source.getSlot(i);
+		uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+		if (sequence == 0)
+		{
+			continue;
+		}
+		if (!(sequence & 1) && getChecksum(getKey(slot), getPixels(slot), getPixels(slot) + bandBytes) == slot->checksum)
+		{
+			intact.push_back(std::make_pair(slot->used.load(std::memory_order_relaxed), i));
+		}
+		else
+		{
+			++damaged;
+		}
+	}
+	std::sort(intact.begin(), intact.end(), [](const std::pair<uint64_t, uint64_t>& a, const std::pair<uint64_t, uint64_t>& b) { return a.first > b.first; });
+
+	size_t bytes = megabytes > 0 ? (size_t)megabytes << 20 : source.isOpen() ? source.m_file.getSize() : (size_t)defaultStoreMegabytes << 20;
+	std::string temporary = path + ".new";
+	std::remove(temporary.c_str());
+	TileStore target;
+	if (!target.open(temporary, bytes))
+	{
+		report = "Could not make " + temporary + "\n";
+		return false;
+	}
+
+	//Tiles that no longer fit their set are evicted, oldest last in
+	long long kept = 0;
+	for (const auto& tile : intact)
+	{
+		Slot* from = source.getSlot(tile.second);
+		TileKey key = getKey(from);
+		uint32_t sequence;
+		Slot* to = target.claim(key, false, sequence);
+		if (!to)
+		{
+			continue;
+		}
+		std::memcpy(getPixels(to), getPixels(from), pixelBytes);
+		to->checksum = from->checksum;
+		to->used.store(tile.first, std::memory_order_relaxed);
+		to->sequence.store(sequence + 2, std::memory_order_release);
+		++kept;
+	}
+	target.m_header->clock = intact.empty() ? 0 : intact.front().first + 1;
+	source.close();
+	target.close();
+
+	std::remove(path.c_str());
+	if (std::rename(temporary.c_str(), path.c_str()) != 0)
+	{
+		report = "Could not replace " + path + "\n";
+		return false;
+	}
+
+	std::stringstream ss;
+	ss << "Kept " << kept << " tiles, dropped " << damaged << " damaged and " << (long long)intact.size() - kept << " that no longer fit, "
+	   << (bytes >> 20) << " MB\n";
+	report = ss.str();
+	return true;
+}
+
+/** Checks, in a small store of its own beside the real one, that a tile
+	written reads back the same, that one with a bit flipped in its slot
+	or left half written reads as missing, the first counted as damaged,
+	that writing it again mends it and that a slot left half written long
+	ago is taken back. Checks as well that keys differing in any field
+	have their own checksums and that compacting a store that does not
+	exist does not make one. Adds a line to report for each that fails.
+	Returns true if all pass*/
+bool TileStore::check(std::string& report)
+{
+	bool passed = true;
+	auto fail = [&](const std::string& what)
+	{
+		report += "TileStore: " + what + "\n";
+		passed = false;
+	};
+
+	std::string path = std::string(tileStorePath) + ".check";
+	std::remove(path.c_str());
+	TileStore store;
+	if (!store.open(path, headerBytes + 2 * storeWays * slotBytes))
+	{
+		fail("could not make " + path);
+		return false;
+	}
+
+	std::vector<uint32_t> bands(cacheTileWidth * cacheTileHeight);
+	std::vector<uint16_t> fractions(cacheTileWidth * cacheTileHeight);
+	for (size_t i = 0; i < bands.size(); ++i)
+	{
+		bands[i] = (uint32_t)(i * 7 % 500);
+		fractions[i] = (uint16_t)(i * 40503);
+	}
+	TileKey key = { 3, -5, 9, 500, KernelPrecision::Double, KernelIsa::Scalar };
+	CachedTile tile;
+	store.save(key, bands.data(), fractions.data(), cacheTileWidth);
+	if (!store.load(key, tile) || tile.bands != bands || tile.fractions != fractions)
+	{
+		fail("a tile written does not read back the same");
+	}
+
+	Slot* slot = nullptr;
+	for (int way = 0; way < storeWays && !slot; ++way)
+	{
+		Slot* candidate = getWay(store.findSet(key), way);
+		slot = candidate->sequence.load() != 0 && isKey(candidate, key) ? candidate : nullptr;
+	}
+	if (slot)
+	{
+		getPixels(slot)[pixelBytes / 2] ^= 1;
+		if (store.load(key, tile) || store.m_bad != 1)
+		{
+			fail("a tile with a bit flipped is not read as damaged");
+		}
+		store.save(key, bands.data(), fractions.data(), cacheTileWidth);
+		if (!store.load(key, tile) || tile.bands != bands)
+		{
+			fail("a damaged tile written again does not read back");
+		}
+
+		slot->sequence.fetch_add(1);
+		if (store.load(key, tile))
+		{
+			fail("a tile half written reads as whole");
+		}
+
+		//As if the process writing it died long ago
+		slot->claimed = 0;
+		store.load(key, tile);
+		store.save(key, bands.data(), fractions.data(), cacheTileWidth);
+		if ((slot->sequence.load() & 1) || !store.load(key, tile) || tile.bands != bands)
+		{
+			fail("a slot left half written long ago is not taken back");
+		}
+	}
+	else
+	{
+		fail("a tile written has no slot");
+	}
+
+	//Keys that differ in any one field, or only in the bits a shift would
+	//overlap, must not share a checksum
+	const uint8_t* tileBands = (const uint8_t*)bands.data();
+	const uint8_t* tileFractions = (const uint8_t*)fractions.data();
+	TileKey others[] = { { 4, -5, 9, 500, KernelPrecision::Double, KernelIsa::Scalar },
+						 { 3, -5, 9, 500, KernelPrecision::Float, KernelIsa::Scalar },
+						 { 3, -5, 9, 500, KernelPrecision::Double, KernelIsa::AVX2 },
+						 { 3, -5, 9, 501, KernelPrecision::Double, KernelIsa::Scalar },
+						 { 3, -5 ^ (1 << 8), 9 ^ 1, 500, KernelPrecision::Double, KernelIsa::Scalar } };
+	for (const TileKey& other : others)
+	{
+		if (getChecksum(other, tileBands, tileFractions) == getChecksum(key, tileBands, tileFractions))
+		{
+			fail("two keys share a checksum");
+		}
+	}
+
+	store.close();
+	std::remove(path.c_str());
+
+	std::string missing = path + ".missing";
+	std::string compacted;
+	std::FILE* made = compact(missing, 0, compacted) ? std::fopen(missing.c_str(), "rb") : nullptr;
+	if (made)
+	{
+		std::fclose(made);
+		std::remove(missing.c_str());
+		fail("compacting a store that does not exist makes one");
+	}
+	return passed;
+}
+
+/** Returns a slot by its number*/
+TileStore::Slot* TileStore::getSlot(uint64_t index)
+{
+	return (Slot*)(m_file.getData() + headerBytes + index * slotBytes);
+}
+
+/** Returns one of the slots of a set*/
+TileStore::Slot* TileStore::getWay(Slot* set, int way)
+{
+	return (Slot*)((uint8_t*)set + way * slotBytes);
+}
+
+/** Returns where a slot's pixels start*/
+uint8_t* TileStore::getPixels(Slot* slot)
+{
+	return (uint8_t*)slot + slotHeaderBytes;
+}
+
+/** Returns the first slot of the set a tile goes in. The set comes from a
+	hash of the key that is the same on every build*/
+TileStore::Slot* TileStore::findSet(const TileKey& key)
+{
+	uint64_t hash = (uint64_t)key.level * 0x9E3779B97F4A7C15ull;
+	hash = (hash ^ (uint64_t)key.x) * 0xC2B2AE3D27D4EB4Full;
+	hash = (hash ^ (uint64_t)key.y) * 0x165667B19E3779F9ull;
+	hash = (hash ^ (uint64_t)key.maxIterations ^ ((uint64_t)key.precision << 48) ^ ((uint64_t)key.isa << 56)) * 0x9E3779B97F4A7C15ull;
+	return getSlot((hash >> 17) % m_sets * storeWays);
+}
+
+/** Takes the slot of a tile's set to write it in, making its sequence odd,
+	and gives the even sequence it had. That is the slot with the tile,
+	else an empty one, else if asked the least recently used. Returns
+	nullptr if there is none or another process has it*/
+TileStore::Slot* TileStore::claim(const TileKey& key, bool evict, uint32_t& sequence)
+{
+	Slot* set = findSet(key);
+	Slot* chosen = nullptr;
+	uint64_t oldest = UINT64_MAX;
+	for (int way = 0; way < storeWays; ++way)
+	{
+		Slot* slot = getWay(set, way);
+		uint32_t current = slot->sequence.load(std::memory_order_acquire);
+		if ((current & 1) && !reclaim(slot, current))
+		{
+			continue;
+		}
+		if (current != 0 && isKey(slot, key))
+		{
+			chosen = slot;
+			break;
+		}
+		uint64_t used = current == 0 ? 0 : slot->used.load(std::memory_order_relaxed) + 1;
+		if ((current == 0 || evict) && used < oldest)
+		{
+			chosen = slot;
+			oldest = used;
+		}
+	}
+	if (!chosen)
+	{
+		return nullptr;
+	}
+
+	//The time goes in before the sequence turns odd, so whoever sees it odd
+	//sees when it did
+	sequence = chosen->sequence.load(std::memory_order_acquire);
+	chosen->claimed.store(getMilliseconds(), std::memory_order_relaxed);
+	if ((sequence & 1) || !chosen->sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acq_rel))
+	{
+		return nullptr;
+	}
+	chosen->x = key.x;
+	chosen->y = key.y;
+	chosen->maxIterations = key.maxIterations;
+	chosen->level = key.level;
+	chosen->precision = (uint8_t)key.precision;
+	chosen->isa = (uint8_t)key.isa;
+	return chosen;
+}
+
+/** Takes back a slot left odd longer than any write takes by a process
+	that died writing it, moving it on to the next even sequence so it
+	reads as damaged and can be written again. Returns whether the slot is
+	now even, with sequence its new sequence*/
+bool TileStore::reclaim(Slot* slot, uint32_t& sequence)
+{
+	if (getMilliseconds() - slot->claimed.load(std::memory_order_relaxed) < staleWriteMilliseconds)
+	{
+		return false;
+	}
+	if (!slot->sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acq_rel))
+	{
+		return !(sequence & 1);
+	}
+	++sequence;
+	return true;
+}
+
+/** Returns the milliseconds since the epoch, the same in every process*/
+int64_t TileStore::getMilliseconds()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/** Returns true if a slot is keyed for a tile*/
+bool TileStore::isKey(const Slot* slot, const TileKey& key)
+{
+	return slot->x == key.x && slot->y == key.y && slot->maxIterations == key.maxIterations && slot->level == key.level &&
+		   slot->precision == (uint8_t)key.precision && slot->isa == (uint8_t)key.isa;
+}
+
+/** Returns the key a slot is written with*/
+TileKey TileStore::getKey(const Slot* slot)
+{
+	return { slot->level, slot->x, slot->y, slot->maxIterations, (KernelPrecision)slot->precision, (KernelIsa)slot->isa };
+}
+
+/** Returns a checksum of a tile's key, a field at a time, and its pixels,
+	eight bytes at a time*/
+uint32_t TileStore::getChecksum(const TileKey& key, const uint8_t* bands, const uint8_t* fractions)
+{
+	uint64_t fields[] = { (uint64_t)key.level, (uint64_t)key.x, (uint64_t)key.y, (uint64_t)key.maxIterations, (uint64_t)key.precision, (uint64_t)key.isa };
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (uint64_t field : fields)
+	{
+		hash = mixChecksum(hash, field);
+	}
+	for (size_t i = 0; i < pixelBytes; i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		std::memcpy(&word, i < bandBytes ? bands + i : fractions + i - bandBytes, sizeof(word));
+		hash = mixChecksum(hash, word);
+	}
+	return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/** Returns a checksum with eight more bytes taken in*/
+uint64_t TileStore::mixChecksum(uint64_t hash, uint64_t word)
+{
+	hash = (hash ^ word) * 0x100000001B3ull;
+	return hash ^ (hash >> 29);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "MappedFile.h"
+#include "TileCache.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+//File the tiles computed in every session are kept in, and its size in
+//MB when it is first made
+const char* const tileStorePath = "tiles.store";
+const long long defaultStoreMegabytes = 256;
+
+//Tiles of the lattice kept on disk from one session to the next, in a
+//memory mapped file any number of viewers on the machine can share. The
+//file is a fixed number of slots in sets of a few, a tile's key picks its
+//set and a new tile takes the least recently used slot there, so the file
+//never grows. Every slot carries a checksum and a sequence number that is
+//odd while a process writes it, so a tile read half written, or damaged
+//on disk, reads as missing and is worked out again. A slot left odd by a
+//process that died writing it is taken back once it has been for longer
+//than any write takes
+class TileStore
+{
+
+public:
+	TileStore();
+	~TileStore();
+
+	bool open(const std::string& path, size_t bytes);
+	void close();
+	bool isOpen() { return m_header != nullptr; };
+
+	bool load(const TileKey& key, CachedTile& tile);
+	void save(const TileKey& key, const uint32_t* bands, const uint16_t* fractions, int stride);
+
+	std::string getStats();
+
+	static bool compact(const std::string& path, long long megabytes, std::string& report);
+	static bool check(std::string& report);
+
+private:
+	struct Header;
+	struct Slot;
+
+	Slot* getSlot(uint64_t index);
+	static Slot* getWay(Slot* set, int way);
+	static uint8_t* getPixels(Slot* slot);
+	Slot* findSet(const TileKey& key);
+	Slot* claim(const TileKey& key, bool evict, uint32_t& sequence);
+	bool isIntact(Slot* slot, const TileKey& key);
+	static bool reclaim(Slot* slot, uint32_t& sequence);
+	static int64_t getMilliseconds();
+	static bool isKey(const Slot* slot, const TileKey& key);
+	static TileKey getKey(const Slot* slot);
+	static uint32_t getChecksum(const TileKey& key, const uint8_t* bands, const uint8_t* fractions);
+	static uint64_t mixChecksum(uint64_t hash, uint64_t word);
+
+	MappedFile m_file;
+	Header* m_header;
+	uint64_t m_sets;
+
+	//Tiles read, tiles read back damaged, and tiles written this session
+	std::atomic<long long> m_hits, m_bad, m_written;
+
+};
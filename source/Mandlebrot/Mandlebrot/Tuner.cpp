@@ -0,0 +1,271 @@
+#include "Tuner.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+
+//A calibration view, quick to render but with a slow boundary region
+struct TuningView
+{
+	double centreRe, centreIm;
+	double width;
+	int maxIterations;
+};
+
+static const TuningView tuningViews[] = {
+	{ -0.75, 0.0, 4.6, 500 },
+	{ -0.7453, 0.1127, 0.01, 500 },
+	{ 0.2501, 0.0, 0.001, 1000 }
+};
+
+//Tile sizes tried, whole cache lines wide and multiples of 8 high
+static const int tileSizes[][2] = { { 32, 16 }, { 64, 16 }, { 64, 32 }, { 128, 32 }, { 64, 64 }, { 128, 64 }, { 256, 32 } };
+
+//Times the calibration views are rendered with each setting, the fastest
+//counting
+static const int tuningRuns = 2;
+
+//A setting must beat the best so far by this much to replace it, so the
+//noise of a busy machine does not move the profile off the defaults
+static const double tuningMargin = 0.97;
+
+//Timing a setting stops once it has taken this many times the best, it
+//will not be picked
+static const double tuningCutoff = 2.0;
+
+Tuner::Tuner()
+{
+	m_cancelled = false;
+	m_frame.create(VIEW_WIDTH, VIEW_HEIGHT);
+}
+
+Tuner::~Tuner()
+{
+}
+
+/** Times the settings one after another, starting from the defaults:
+	every vector instruction set, then every tile size, then thread counts
+	in powers of two up to the number of cores. The scalar kernel is only
+	there to check the others by. Leaves the kernel on the instruction set
+	and the pool on the tile size picked. Cancelling the kernel stops the
+	tune, leaving both as they were and wasCancelled true*/
+TuningProfile Tuner::tune(Kernel& kernel, ThreadPool& pool)
+{
+	KernelPrecision precision = kernel.getPrecision();
+	KernelIsa isa = kernel.getIsa();
+	int tileWidth = ThreadPool::getTileWidth();
+	int tileHeight = ThreadPool::getTileHeight();
+	kernel.setPrecision(KernelPrecision::Double);
+	m_cancelled = false;
+
+	TuningProfile best = getDefaults();
+	m_report.str("");
+	m_report << std::fixed << std::setprecision(1);
+	m_report << "Tuning for " << best.cpu << ", " << best.cores << " cores, ms for the calibration views\n";
+
+	//Warms the caches and clocks up before anything is timed
+	timeSettings(kernel, pool, best, 0.0);
+	double bestTime = timeSettings(kernel, pool, best, 0.0);
+	m_report << std::left << std::setw(20) << "Defaults" << std::right << std::setw(10) << bestTime << "\n";
+
+	auto consider = [&](const TuningProfile& trial, const std::string& label)
+	{
+		if (m_cancelled)
+		{
+			return;
+		}
+		double time = timeSettings(kernel, pool, trial, bestTime * tuningCutoff);
+		if (m_cancelled)
+		{
+			return;
+		}
+		m_report << std::left << std::setw(20) << label << std::right << std::setw(10) << time << "\n";
+		if (time < bestTime * tuningMargin)
+		{
+			bestTime = time;
+			best = trial;
+		}
+	};
+
+	for (int isa = (int)KernelIsa::SSE2; isa <= (int)Kernel::detectIsa(); ++isa)
+	{
+		TuningProfile trial = best;
+		trial.isa = (KernelIsa)isa;
+		consider(trial, std::string("Kernel ") + Kernel::getIsaName(trial.isa));
+	}
+
+	for (const int* size : tileSizes)
+	{
+		TuningProfile trial = best;
+		trial.tileWidth = size[0];
+		trial.tileHeight = size[1];
+		consider(trial, "Tiles " + std::to_string(size[0]) + "x" + std::to_string(size[1]));
+	}
+
+	const int cores = std::min(best.cores, pool.getSize());
+	for (int threads = 1; threads <= cores; threads = threads < cores && threads * 2 > cores ? cores : threads * 2)
+	{
+		TuningProfile trial = best;
+		trial.threads = threads;
+		consider(trial, "Threads " + std::to_string(threads));
+	}
+
+	if (m_cancelled)
+	{
+		m_report << "Cancelled\n";
+		kernel.setIsa(isa);
+		ThreadPool::setTileSize(tileWidth, tileHeight);
+		kernel.setPrecision(precision);
+		return best;
+	}
+
+	m_report << "Picked kernel " << Kernel::getIsaName(best.isa) << ", tiles " << best.tileWidth << "x" << best.tileHeight << ", " << best.threads
+			 << " threads, " << bestTime << " ms\n";
+
+	kernel.setIsa(best.isa);
+	ThreadPool::setTileSize(best.tileWidth, best.tileHeight);
+	kernel.setPrecision(precision);
+	return best;
+}
+
+/** Renders every calibration view from scratch with some settings and
+	returns the fastest of tuningRuns goes, in ms. Gives up as soon as a go
+	has taken longer than limit ms, if limit is above 0, or the kernel is
+	cancelled*/
+double Tuner::timeSettings(Kernel& kernel, ThreadPool& pool, const TuningProfile& settings, double limit)
+{
+	kernel.setIsa(settings.isa);
+	ThreadPool::setTileSize(settings.tileWidth, settings.tileHeight);
+
+	double fastest = 0.0;
+	for (int run = 0; run < tuningRuns; ++run)
+	{
+		double total = 0.0;
+		for (const TuningView& view : tuningViews)
+		{
+			double pixelSize = view.width / (double)VIEW_WIDTH;
+			DoubleDouble left = DoubleDouble(view.centreRe) - DoubleDouble(view.width / 2.0);
+			DoubleDouble top = DoubleDouble(view.centreIm) - DoubleDouble(pixelSize * VIEW_HEIGHT / 2.0);
+
+			m_frame.resetStates();
+			PixelRenderer pixels;
+			pixels.setOutput(&m_frame, 0, VIEW_HEIGHT, view.maxIterations);
+			pixels.setKernel(&kernel, left, top, pixelSize, pixelSize);
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			pixels.computeTiles(pool, settings.threads, nullptr);
+			total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (kernel.isCancelled())
+			{
+				m_cancelled = true;
+				return total;
+			}
+			if (limit > 0.0 && total > limit)
+			{
+				return total;
+			}
+		}
+		fastest = run == 0 ? total : std::min(fastest, total);
+	}
+	return fastest;
+}
+
+/** Returns the settings used on a machine that has not been tuned*/
+TuningProfile Tuner::getDefaults()
+{
+	TuningProfile profile;
+	profile.cpu = Kernel::getCpuName();
+	profile.cores = std::max(1, (int)std::thread::hardware_concurrency());
+	profile.threads = profile.cores;
+	profile.isa = Kernel::detectIsa();
+	profile.tileWidth = 64;
+	profile.tileHeight = 32;
+	return profile;
+}
+
+/** Returns true if a profile was tuned on a machine with this processor
+	and number of cores, otherwise it wants tuning again*/
+bool Tuner::isForThisMachine(const TuningProfile& profile)
+{
+	TuningProfile machine = getDefaults();
+	return profile.cpu == machine.cpu && profile.cores == machine.cores;
+}
+
+/** Reads a profile written by save. Returns false if there is none or it
+	is missing a setting*/
+bool Tuner::load(const std::string& path, TuningProfile& profile)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+
+	//One key=value a line, anything else is ignored
+	TuningProfile loaded;
+	int found = 0;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		size_t equals = line.find('=');
+		if (equals == std::string::npos)
+		{
+			continue;
+		}
+		std::string key = line.substr(0, equals);
+		std::string value = line.substr(equals + 1);
+		std::istringstream in(value);
+		char by;
+
+		if (key == "cpu")
+		{
+			loaded.cpu = value;
+			found |= 1;
+		}
+		else if (key == "cores" && in >> loaded.cores)
+		{
+			found |= 2;
+		}
+		else if (key == "threads" && in >> loaded.threads)
+		{
+			found |= 4;
+		}
+		else if (key == "tile" && in >> loaded.tileWidth >> by >> loaded.tileHeight)
+		{
+			found |= 8;
+		}
+		else if (key == "kernel")
+		{
+			for (int isa = 0; isa <= (int)KernelIsa::AVX512; ++isa)
+			{
+				if (value == Kernel::getIsaName((KernelIsa)isa))
+				{
+					loaded.isa = (KernelIsa)isa;
+					found |= 16;
+				}
+			}
+		}
+	}
+
+	if (found != 31)
+	{
+		return false;
+	}
+	profile = loaded;
+	return true;
+}
+
+/** Writes a profile for later runs to load. Returns false if it could not
+	be written*/
+bool Tuner::save(const std::string& path, const TuningProfile& profile)
+{
+	std::ofstream file(path);
+	file << "# Scheduling tuned for this machine, delete to go back to the defaults\n";
+	file << "cpu=" << profile.cpu << "\n";
+	file << "cores=" << profile.cores << "\n";
+	file << "threads=" << profile.threads << "\n";
+	file << "kernel=" << Kernel::getIsaName(profile.isa) << "\n";
+	file << "tile=" << profile.tileWidth << "x" << profile.tileHeight << "\n";
+	return (bool)file;
+}
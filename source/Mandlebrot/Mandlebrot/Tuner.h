@@ -0,0 +1,57 @@
+#pragma once
+#include "Constants.h"
+#include "Kernel.h"
+#include "FrameBuffer.h"
+#include "PixelRenderer.h"
+#include "ThreadPool.h"
+#include <string>
+#include <sstream>
+
+//File the tuned settings are kept in, beside the benchmark report
+const char* const tuningProfilePath = "tuning.txt";
+
+//Scheduling settings picked for one machine, and the machine they were
+//picked on
+struct TuningProfile
+{
+	std::string cpu;
+	int cores;
+
+	int threads;
+	KernelIsa isa;
+	int tileWidth, tileHeight;
+};
+
+//Finds the thread count, instruction set and tile size that render a
+//short set of calibration views fastest on this machine, one setting at
+//a time with the others at their best so far, and keeps them in a profile
+//for later runs. Precision tiers are left alone, where they switch
+//decides whether pixels come out right rather than how fast
+class Tuner
+{
+
+public:
+	Tuner();
+	~Tuner();
+
+	TuningProfile tune(Kernel& kernel, ThreadPool& pool);
+	std::string getReport() { return m_report.str(); };
+	bool wasCancelled() { return m_cancelled; };
+
+	static TuningProfile getDefaults();
+	static bool isForThisMachine(const TuningProfile& profile);
+	static bool load(const std::string& path, TuningProfile& profile);
+	static bool save(const std::string& path, const TuningProfile& profile);
+
+private:
+	double timeSettings(Kernel& kernel, ThreadPool& pool, const TuningProfile& settings, double limit);
+
+	//What each setting tried took, and whether the kernel was cancelled
+	//before the tune was done
+	std::stringstream m_report;
+	bool m_cancelled;
+
+	//Frame the calibration views are rendered into
+	FrameBuffer m_frame;
+
+};
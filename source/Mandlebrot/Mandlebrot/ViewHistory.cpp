@@ -0,0 +1,328 @@
+#include "ViewHistory.h"
+#include <algorithm>
+#include <sstream>
+
+//Most bytes the history may take before the oldest views are evicted
+static const size_t historyBudget = 64 << 20;
+
+//Entries at most this many steps from the current one are kept as they
+//are, so stepping back and forth over them costs a copy
+static const size_t uncompressedReach = 1;
+
+/** Appends v to a buffer seven bits a byte, low bits first, with the top
+	bit set on every byte but the last*/
+static void putVarint(std::vector<uint8_t>& out, uint64_t v)
+{
+	while (v >= 0x80)
+	{
+		out.push_back((uint8_t)(v | 0x80));
+		v >>= 7;
+	}
+	out.push_back((uint8_t)v);
+}
+
+/** Reads a value putVarint wrote, moving past it*/
+static uint64_t getVarint(const uint8_t*& in)
+{
+	uint64_t v = 0;
+	for (int shift = 0;; shift += 7)
+	{
+		uint8_t byte = *in++;
+		v |= (uint64_t)(byte & 0x7F) << shift;
+		if (byte < 0x80)
+		{
+			return v;
+		}
+	}
+}
+
+ViewHistory::ViewHistory()
+{
+	m_position = 0;
+	m_bytes = 0;
+}
+
+ViewHistory::~ViewHistory()
+{
+}
+
+/** Records a frame that has just gone on screen. A frame of the view
+	already current, at another limit say, takes its place. Any other view
+	becomes the current one and the views ahead of the old one are
+	dropped. Its colours are kept for reuse with the same colour version,
+	-1 for colours that cannot be reused*/
+void ViewHistory::record(const HistoryView& view, FrameBuffer& frame, int colourVersion)
+{
+	if (m_entries.empty() || !isSameView(m_entries[m_position].view, view))
+	{
+		while (!m_entries.empty() && m_entries.size() > m_position + 1)
+		{
+			m_bytes -= getBytes(m_entries.back());
+			m_entries.pop_back();
+		}
+		m_entries.emplace_back();
+		m_position = m_entries.size() - 1;
+	}
+	else
+	{
+		m_bytes -= getBytes(m_entries[m_position]);
+	}
+
+	size_t pixels = (size_t)frame.getWidth() * frame.getHeight();
+	Entry& entry = m_entries[m_position];
+	entry.view = view;
+	entry.colourVersion = colourVersion;
+	entry.bands.assign(frame.getIterations(), frame.getIterations() + pixels);
+	entry.fractions.assign(frame.getFractions(), frame.getFractions() + pixels);
+	if (colourVersion >= 0)
+	{
+		entry.rgba.assign(frame.getRgba(), frame.getRgba() + pixels * 4);
+	}
+	else
+	{
+		std::vector<uint8_t>().swap(entry.rgba);
+	}
+	std::vector<uint8_t>().swap(entry.packed);
+	m_bytes += getBytes(entry);
+	settle();
+}
+
+/** Returns true if there is a view step places from the current one*/
+bool ViewHistory::canMove(int step)
+{
+	long long position = (long long)m_position + step;
+	return !m_entries.empty() && position >= 0 && position < (long long)m_entries.size();
+}
+
+/** Makes the view step places from the current one current, which
+	canMove must allow, and gives it and its frame's bands and mu. Its
+	colours are given too if they were kept with this colour version*/
+void ViewHistory::move(int step, int colourVersion, HistoryView& view, FrameBuffer& frame, bool& coloured)
+{
+	m_position = (size_t)((long long)m_position + step);
+	const Entry& entry = m_entries[m_position];
+	view = entry.view;
+	expand(entry, frame);
+
+	coloured = !entry.rgba.empty() && colourVersion >= 0 && entry.colourVersion == colourVersion;
+	if (coloured)
+	{
+		std::copy(entry.rgba.begin(), entry.rgba.end(), frame.getRgba());
+	}
+	settle();
+}
+
+/** Returns the views kept and the memory they take for display*/
+std::string ViewHistory::getStats()
+{
+	int compressed = 0;
+	for (const Entry& entry : m_entries)
+	{
+		compressed += entry.packed.empty() ? 0 : 1;
+	}
+	std::stringstream ss;
+	ss << std::fixed;
+	ss.precision(1);
+	ss << "History: view " << (m_entries.empty() ? 0 : m_position + 1) << " of " << m_entries.size() << ", " << compressed << " compressed, "
+	   << m_bytes / 1048576.0 << " MB\n";
+	return ss.str();
+}
+
+/** Checks that a frame compressed and expanded again comes back pixel for
+	pixel, bands that rise and fall and pixels inside the set included,
+	and that going back to a view compressed for being out of reach gives
+	its frame. Adds a line to report for each that fails. Returns true if
+	all pass*/
+bool ViewHistory::check(std::string& report)
+{
+	bool passed = true;
+	auto fail = [&](const std::string& what)
+	{
+		report += "ViewHistory: " + what + "\n";
+		passed = false;
+	};
+
+	//Runs of every length, falling as well as rising, with a run inside
+	const long long limit = 5000;
+	const int width = 97;
+	const int height = 31;
+	FrameBuffer frames[3];
+	for (int f = 0; f < 3; ++f)
+	{
+		frames[f].create(width, height);
+		uint32_t band = 1;
+		for (int i = 0; i < width * height; ++i)
+		{
+			if (i % (1 + (i / 7 + f) % 13) == 0)
+			{
+				band = (i / 11) % 9 == 0 ? (uint32_t)limit : (uint32_t)((band * 2654435761u + f) % 4000 + 1);
+			}
+			frames[f].getIterations()[i] = band;
+			frames[f].getFractions()[i] = band == limit ? 0 : (uint16_t)(i * 40503 + f);
+		}
+	}
+	auto differs = [width, height](FrameBuffer& a, FrameBuffer& b)
+	{
+		return !std::equal(a.getIterations(), a.getIterations() + width * height, b.getIterations()) ||
+			   !std::equal(a.getFractions(), a.getFractions() + width * height, b.getFractions());
+	};
+
+	Entry entry;
+	entry.view.maxIterations = limit;
+	entry.bands.assign(frames[0].getIterations(), frames[0].getIterations() + width * height);
+	entry.fractions.assign(frames[0].getFractions(), frames[0].getFractions() + width * height);
+	compress(entry);
+	FrameBuffer expanded;
+	expanded.create(width, height);
+	expand(entry, expanded);
+	if (entry.packed.empty() || !entry.bands.empty() || differs(frames[0], expanded))
+	{
+		fail("a frame compressed and expanded does not come back the same");
+	}
+
+	//The first view is two steps back by the time the third is recorded
+	ViewHistory history;
+	HistoryView views[3];
+	for (int f = 0; f < 3; ++f)
+	{
+		views[f] = { BigFixed(-2.0 + f), BigFixed(0.5), BigFixed(-1.0), BigFixed(1.0), limit, -1 };
+		history.record(views[f], frames[f], -1);
+	}
+	HistoryView view;
+	bool coloured = false;
+	bool back = history.canMove(-2);
+	if (back)
+	{
+		history.move(-2, 0, view, expanded, coloured);
+	}
+	if (!back || !isSameView(view, views[0]) || differs(frames[0], expanded))
+	{
+		fail("going back to a compressed view does not give its frame");
+	}
+	return passed;
+}
+
+/** Returns true if two views cover the same part of the plane*/
+bool ViewHistory::isSameView(const HistoryView& a, const HistoryView& b)
+{
+	return !(a.left < b.left) && !(b.left < a.left) && !(a.right < b.right) && !(b.right < a.right) && !(a.top < b.top) && !(b.top < a.top) &&
+		   !(a.bottom < b.bottom) && !(b.bottom < a.bottom);
+}
+
+/** Returns the memory an entry's frame takes*/
+size_t ViewHistory::getBytes(const Entry& entry)
+{
+	return entry.bands.size() * sizeof(uint32_t) + entry.fractions.size() * sizeof(uint16_t) + entry.rgba.size() + entry.packed.size();
+}
+
+/** Compresses an entry's frame into packed and lets go of its planes. The
+	colours can be worked out again, so they go. Bands come in long runs,
+	kept as the change from the last run's band and the run's length. The
+	fractions look like noise, so they are kept whole but only for the
+	pixels that escaped, since the rest are always 0*/
+void ViewHistory::compress(Entry& entry)
+{
+	const std::vector<uint32_t>& bands = entry.bands;
+	size_t pixels = bands.size();
+	std::vector<uint8_t>& packed = entry.packed;
+	packed.clear();
+	putVarint(packed, pixels);
+
+	uint32_t last = 0;
+	for (size_t i = 0; i < pixels;)
+	{
+		size_t end = i + 1;
+		while (end < pixels && bands[end] == bands[i])
+		{
+			++end;
+		}
+		//Zigzag keeps small changes either way small
+		int64_t change = (int64_t)bands[i] - last;
+		putVarint(packed, change >= 0 ? (uint64_t)change << 1 : ((uint64_t)-change << 1) - 1);
+		putVarint(packed, end - i - 1);
+		last = bands[i];
+		i = end;
+	}
+	for (size_t i = 0; i < pixels; ++i)
+	{
+		if (bands[i] != entry.view.maxIterations)
+		{
+			packed.push_back((uint8_t)entry.fractions[i]);
+			packed.push_back((uint8_t)(entry.fractions[i] >> 8));
+		}
+	}
+	packed.shrink_to_fit();
+
+	std::vector<uint32_t>().swap(entry.bands);
+	std::vector<uint16_t>().swap(entry.fractions);
+	std::vector<uint8_t>().swap(entry.rgba);
+}
+
+/** Writes an entry's bands and mu into a frame of its size*/
+void ViewHistory::expand(const Entry& entry, FrameBuffer& frame)
+{
+	uint32_t* bands = frame.getIterations();
+	uint16_t* fractions = frame.getFractions();
+	if (entry.packed.empty())
+	{
+		std::copy(entry.bands.begin(), entry.bands.end(), bands);
+		std::copy(entry.fractions.begin(), entry.fractions.end(), fractions);
+		return;
+	}
+
+	const uint8_t* in = entry.packed.data();
+	size_t pixels = (size_t)getVarint(in);
+	uint32_t last = 0;
+	for (size_t i = 0; i < pixels;)
+	{
+		uint64_t change = getVarint(in);
+		last += (uint32_t)(change & 1 ? -(int64_t)((change + 1) >> 1) : (int64_t)(change >> 1));
+		size_t end = i + 1 + (size_t)getVarint(in);
+		std::fill(bands + i, bands + end, last);
+		i = end;
+	}
+	for (size_t i = 0; i < pixels; ++i)
+	{
+		if (bands[i] != entry.view.maxIterations)
+		{
+			fractions[i] = (uint16_t)(in[0] | in[1] << 8);
+			in += 2;
+		}
+		else
+		{
+			fractions[i] = 0;
+		}
+	}
+}
+
+/** Compresses the entries out of reach of the current one, then evicts
+	the views furthest from it, the oldest first, until the history fits
+	its budget. The current view always stays*/
+void ViewHistory::settle()
+{
+	for (size_t i = 0; i < m_entries.size(); ++i)
+	{
+		size_t distance = i > m_position ? i - m_position : m_position - i;
+		if (distance > uncompressedReach && m_entries[i].packed.empty())
+		{
+			m_bytes -= getBytes(m_entries[i]);
+			compress(m_entries[i]);
+			m_bytes += getBytes(m_entries[i]);
+		}
+	}
+
+	while (m_bytes > historyBudget && m_entries.size() > 1)
+	{
+		if (m_position >= m_entries.size() - 1 - m_position)
+		{
+			m_bytes -= getBytes(m_entries.front());
+			m_entries.pop_front();
+			--m_position;
+		}
+		else
+		{
+			m_bytes -= getBytes(m_entries.back());
+			m_entries.pop_back();
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "BigFixed.h"
+#include "FrameBuffer.h"
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+//A view that was on screen, where it was and how it was rendered
+struct HistoryView
+{
+	BigFixed left, right, top, bottom;
+	long long maxIterations;
+	int mirrorAxis;
+};
+
+//The views that have been on screen in the order they were visited, with
+//the bands and mu of each frame so going back or forward puts it on
+//screen again without rendering it. Frames are kept as they are, colours
+//included, until they are more than a step from the current view, then
+//compressed for good, and the furthest evicted once the history outgrows
+//its budget
+class ViewHistory
+{
+
+public:
+	ViewHistory();
+	~ViewHistory();
+
+	void record(const HistoryView& view, FrameBuffer& frame, int colourVersion);
+	bool canMove(int step);
+	void move(int step, int colourVersion, HistoryView& view, FrameBuffer& frame, bool& coloured);
+
+	std::string getStats();
+
+	static bool check(std::string& report);
+
+private:
+	//A view and its frame, as planes or compressed into packed
+	struct Entry
+	{
+		HistoryView view;
+		int colourVersion;
+		std::vector<uint32_t> bands;
+		std::vector<uint16_t> fractions;
+		std::vector<uint8_t> rgba;
+		std::vector<uint8_t> packed;
+	};
+
+	static bool isSameView(const HistoryView& a, const HistoryView& b);
+	static size_t getBytes(const Entry& entry);
+	static void compress(Entry& entry);
+	static void expand(const Entry& entry, FrameBuffer& frame);
+	void settle();
+
+	std::deque<Entry> m_entries;
+	size_t m_position;
+	size_t m_bytes;
+
+};